@@ -0,0 +1,69 @@
+# Summarises the GCC -fstack-usage files under STACK_USAGE_DIR: the largest frames first.
+#
+#   cmake -DSTACK_USAGE_DIR=<object dir> [-DSTACK_USAGE_TOP=<n>] -P StackUsageReport.cmake
+
+if(NOT STACK_USAGE_DIR)
+    message(FATAL_ERROR "STACK_USAGE_DIR is not set")
+endif()
+if(NOT STACK_USAGE_TOP)
+    set(STACK_USAGE_TOP 15)
+endif()
+
+file(GLOB_RECURSE su_files "${STACK_USAGE_DIR}/*.su")
+if(NOT su_files)
+    message(FATAL_ERROR "no .su files under ${STACK_USAGE_DIR}; was it built with -fstack-usage?")
+endif()
+
+# Each line reads "file:line:col:function<TAB>bytes<TAB>static|dynamic|dynamic,bounded".
+# Entries are keyed by a zero-padded size so that a plain sort orders them. Brackets and
+# semicolons in template signatures would confuse CMake's list handling, so they are swapped
+# out before the file is split into lines.
+set(entries)
+set(dynamic 0)
+foreach(su_file IN LISTS su_files)
+    file(READ "${su_file}" content)
+    string(REPLACE "[" "<" content "${content}")
+    string(REPLACE "]" ">" content "${content}")
+    string(REPLACE ";" "," content "${content}")
+    string(REPLACE "\n" ";" lines "${content}")
+    foreach(line IN LISTS lines)
+        if(NOT line MATCHES "^[^\t]*:[0-9]+:[0-9]+:([^\t]*)\t([0-9]+)\t(.*)$")
+            continue()
+        endif()
+        set(function "${CMAKE_MATCH_1}")
+        set(bytes "${CMAKE_MATCH_2}")
+        set(kind "${CMAKE_MATCH_3}")
+        string(REPLACE "fujitsu::airstage::" "" function "${function}")
+        if(NOT kind STREQUAL "static")
+            math(EXPR dynamic "${dynamic} + 1")
+            set(function "${function} (${kind})")
+        endif()
+        string(LENGTH "${bytes}" width)
+        set(padded "${bytes}")
+        while(width LESS 8)
+            string(PREPEND padded "0")
+            math(EXPR width "${width} + 1")
+        endwhile()
+        list(APPEND entries "${padded}|${bytes}|${function}")
+    endforeach()
+endforeach()
+
+list(SORT entries ORDER DESCENDING)
+list(LENGTH entries total)
+message("stack usage: ${total} functions, ${dynamic} not static")
+set(shown 0)
+foreach(entry IN LISTS entries)
+    if(shown EQUAL STACK_USAGE_TOP)
+        break()
+    endif()
+    string(REPLACE "|" ";" parts "${entry}")
+    list(GET parts 1 bytes)
+    list(GET parts 2 function)
+    string(LENGTH "${bytes}" width)
+    while(width LESS 6)
+        string(PREPEND bytes " ")
+        math(EXPR width "${width} + 1")
+    endwhile()
+    message("${bytes}  ${function}")
+    math(EXPR shown "${shown} + 1")
+endforeach()
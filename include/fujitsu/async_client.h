@@ -0,0 +1,239 @@
+#pragma once
+
+#include "fujitsu/encoder.h"
+#include "fujitsu/framer.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/task.h"
+#include "fujitsu/transport.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+enum class RequestOutcome {
+  kOk,
+  kTimedOut,   // no answer before the deadline or within the allowed attempts
+  kCorrupted,  // the last attempt was answered with a frame that failed validation
+  kCancelled,  // the request's stop token was triggered
+};
+
+[[nodiscard]] const char* ToString(RequestOutcome outcome);
+
+struct RequestOptions {
+  // Seconds from the co_await until the request fails with kTimedOut, time spent queued behind
+  // other requests included. Without one, only the client's attempt limit applies.
+  std::optional<double> timeout;
+  // Cancels the request while it is queued or awaiting its response.
+  std::stop_token stop;
+};
+
+struct ReadResult {
+  RequestOutcome outcome = RequestOutcome::kTimedOut;
+  uint8_t status = 0;                 // status byte of the response
+  std::vector<RegisterValue> values;  // in request order
+  std::size_t attempts = 0;           // frames sent
+
+  [[nodiscard]] bool ok() const { return outcome == RequestOutcome::kOk; }
+};
+
+struct WriteResult {
+  RequestOutcome outcome = RequestOutcome::kTimedOut;
+  uint8_t status = 0;
+  std::size_t attempts = 0;
+
+  [[nodiscard]] bool ok() const { return outcome == RequestOutcome::kOk; }
+};
+
+struct AsyncClientOptions {
+  double response_timeout = 0.25;  // per attempt
+  std::size_t max_attempts = 3;    // including the first
+  // Idle time after a corrupt answer before re-sending, so that the rest of it has passed.
+  double retry_delay = 0.01;
+};
+
+struct AsyncClientStats {
+  std::size_t requests = 0;
+  std::size_t frames_sent = 0;
+  std::size_t retries = 0;            // frames re-sent after a lost or corrupted response
+  std::size_t corrupt_responses = 0;  // attempts answered with frames that failed validation
+  std::size_t stray_frames = 0;       // valid frames that answer no outstanding request
+  std::size_t failures = 0;           // requests that ran out of time or attempts
+  std::size_t cancelled = 0;
+};
+
+// Coroutine client for the module side of the bus. Read and Write return awaitables:
+//
+//   Task<> Refresh(AsyncClient& client) {
+//     static constexpr uint16_t kState[] = {0x1000, 0x1001};
+//     ReadResult state = co_await client.Read(kState);
+//     if (state.ok()) { ... }
+//   }
+//
+// The bus is half duplex, so requests from any number of coroutines queue up and go out one
+// at a time, oldest first; a response is matched to the outstanding request by its command id
+// and shape (a read response must list the requested addresses in order). An attempt that
+// draws a frame failing validation is re-sent once the line has settled, one that draws
+// nothing is re-sent after `response_timeout`, up to `max_attempts` frames in all.
+//
+// The client does no I/O itself. Frames go out through the send callback, response frames come
+// in through Receive, and Advance fires timeouts and resumes the coroutines whose requests
+// have finished; RunClientLoop does all of this over a SerialPort. Times are in seconds on one
+// monotonic clock (MonotonicSeconds for RunClientLoop). Everything runs on the thread calling
+// Receive and Advance, and coroutines are only ever resumed from Advance.
+class AsyncClient {
+ public:
+  using SendCallback = std::function<void(std::span<const uint8_t> frame)>;
+
+ private:
+  enum class State { kNew, kQueued, kReady, kResumed };
+
+  struct Operation {
+    CommandId command = CommandId::kReadRegisters;
+    FrameBuffer frame{};
+    std::size_t length = 0;
+    std::optional<double> timeout;
+    std::stop_token stop;
+
+    State state = State::kNew;
+    std::coroutine_handle<> waiter;
+    std::optional<double> deadline;
+    double sent_at = 0.0;
+    std::optional<double> retry_at;  // set once the current attempt draws a corrupt answer
+
+    RequestOutcome outcome = RequestOutcome::kTimedOut;
+    uint8_t status = 0;
+    std::vector<RegisterValue> values;
+    std::size_t attempts = 0;
+  };
+
+ public:
+  // Awaitable request. Holds the encoded frame, so awaiting it allocates nothing beyond a
+  // queue slot; the request is queued when awaited, not when created.
+  template <typename Result>
+  class Request {
+   public:
+    Request(const Request&) = delete;
+    Request& operator=(const Request&) = delete;
+    ~Request() { client_->Forget(&operation_); }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> waiter) { client_->Enqueue(&operation_, waiter); }
+    Result await_resume();
+
+   private:
+    friend class AsyncClient;
+    // `encode` writes the frame into a FrameBuffer and returns its length, 0 if it does not fit.
+    template <typename Encode>
+    Request(AsyncClient* client, CommandId command, const RequestOptions& options, Encode&& encode)
+        : client_(client) {
+      operation_.command = command;
+      operation_.length = encode(std::span<uint8_t>(operation_.frame));
+      if (operation_.length == 0) {
+        throw std::invalid_argument("request does not fit one frame");
+      }
+      operation_.timeout = options.timeout;
+      operation_.stop = options.stop;
+    }
+
+    AsyncClient* client_;
+    Operation operation_;
+  };
+
+  explicit AsyncClient(SendCallback send, const AsyncClientOptions& options = {});
+
+  AsyncClient(const AsyncClient&) = delete;
+  AsyncClient& operator=(const AsyncClient&) = delete;
+
+  // Reads up to kMaxReadAddresses registers. Throws std::invalid_argument if the addresses do
+  // not fit one request.
+  [[nodiscard]] Request<ReadResult> Read(std::span<const uint16_t> addresses,
+                                         const RequestOptions& options = {});
+  // GCC 12 rejects a braced list inside a co_await expression ("array used as initializer"),
+  // so there the request must be created in a statement of its own before awaiting it.
+  [[nodiscard]] Request<ReadResult> Read(std::initializer_list<uint16_t> addresses,
+                                         const RequestOptions& options = {}) {
+    return Read(std::span<const uint16_t>(addresses.begin(), addresses.size()), options);
+  }
+
+  // Writes registers with one of the write commands (see EncodeWriteRequest). Throws
+  // std::invalid_argument if the values do not fit one frame.
+  [[nodiscard]] Request<WriteResult> Write(CommandId command, std::span<const RegisterValue> values,
+                                           const RequestOptions& options = {});
+  [[nodiscard]] Request<WriteResult> Write(CommandId command,
+                                           std::initializer_list<RegisterValue> values,
+                                           const RequestOptions& options = {}) {
+    return Write(command, std::span<const RegisterValue>(values.begin(), values.size()), options);
+  }
+
+  // Hands the client a frame read from the unit (TX direction; other frames are ignored).
+  void Receive(const Frame& frame, double now);
+
+  // Expires and cancels requests, re-sends or sends the next frame and resumes the coroutines
+  // whose requests finished.
+  void Advance(double now);
+
+  // Latest time by which Advance must next be called, or std::nullopt if no request is
+  // pending. Stop tokens are not covered: cancellation is noticed on the next Advance.
+  [[nodiscard]] std::optional<double> NextWakeup() const;
+
+  [[nodiscard]] bool idle() const { return queue_.empty() && ready_.empty(); }
+  [[nodiscard]] const AsyncClientStats& stats() const { return stats_; }
+
+ private:
+  void Enqueue(Operation* operation, std::coroutine_handle<> waiter);
+  void Forget(Operation* operation);
+  void Send(Operation* operation);
+  void Complete(Operation* operation, RequestOutcome outcome);
+  [[nodiscard]] bool AcceptResponse(Operation* operation, const PacketView& packet);
+
+  SendCallback send_;
+  AsyncClientOptions options_;
+  double now_ = 0.0;
+  std::deque<Operation*> queue_;  // front is in flight once sent
+  bool in_flight_ = false;
+  // After a request is abandoned mid-exchange its late answer could be taken for the next
+  // request's, so nothing is sent until the answer would have timed out.
+  double quiet_until_ = 0.0;
+  std::deque<Operation*> ready_;  // finished, awaiting resumption
+  AsyncClientStats stats_;
+};
+
+template <typename Result>
+Result AsyncClient::Request<Result>::await_resume() {
+  Result result;
+  result.outcome = operation_.outcome;
+  result.status = operation_.status;
+  result.attempts = operation_.attempts;
+  if constexpr (std::is_same_v<Result, ReadResult>) {
+    result.values = std::move(operation_.values);
+  }
+  return result;
+}
+
+// Runs `client`, whose send callback writes to `port`, until `done` returns true: frames what
+// the port receives into Receive and calls Advance whenever something arrives or falls due,
+// and at least every 50 ms so that stop tokens take effect within that. Throws
+// std::runtime_error if the port closes or fails.
+void RunClientLoop(AsyncClient& client, SerialPort& port, const std::function<bool()>& done);
+
+// Starts `task` and runs the client until it finishes; returns its result.
+template <typename T>
+T RunClientLoop(AsyncClient& client, SerialPort& port, Task<T> task) {
+  task.Start();
+  RunClientLoop(client, port, [&task] { return task.done(); });
+  return task.result();
+}
+
+}  // namespace fujitsu::airstage
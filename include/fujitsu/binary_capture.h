@@ -0,0 +1,90 @@
+#pragma once
+
+#include "fujitsu/capture_reader.h"
+#include "fujitsu/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Compact columnar capture format. All integers are little-endian.
+//
+//   header      32 bytes: magic "FJBC", u16 version, u16 reserved, u64 event count,
+//               u64 ticks per second, i64 tick of the first event
+//   values      one byte per event
+//   directions  bitset, one bit per event (1 = TX)
+//   errors      bitset, one bit per event (1 = framing/parity error)
+//   deltas      LEB128 varint per event: ticks since the previous event
+//
+// Timestamps are stored at nanosecond resolution. Saleae exports carry at most nine fractional
+// digits, so converted CSV timestamps decode to exactly the same doubles.
+inline constexpr char kBinaryCaptureMagic[4] = {'F', 'J', 'B', 'C'};
+inline constexpr uint16_t kBinaryCaptureVersion = 1;
+inline constexpr std::size_t kBinaryCaptureHeaderBytes = 32;
+inline constexpr uint64_t kBinaryCaptureTicksPerSecond = 1'000'000'000;
+
+// Returns true if `bytes` starts with the binary capture magic.
+[[nodiscard]] bool IsBinaryCapture(std::span<const uint8_t> bytes);
+
+// Accumulates byte events column by column and writes them out as a binary capture.
+class BinaryCaptureWriter {
+ public:
+  // Events must be appended in non-decreasing time order.
+  void Append(const ByteEvent& event);
+
+  // Throws std::runtime_error if the file cannot be written.
+  void Write(const std::filesystem::path& path) const;
+
+  [[nodiscard]] std::size_t size() const { return values_.size(); }
+
+ private:
+  std::vector<uint8_t> values_;
+  std::vector<uint8_t> directions_;
+  std::vector<uint8_t> errors_;
+  std::vector<uint8_t> deltas_;
+  int64_t first_tick_ = 0;
+  int64_t last_tick_ = 0;
+};
+
+// Memory-mapped binary capture. The columns are validated up front; events are then decoded
+// sequentially straight from the mapping.
+class BinaryCapture {
+ public:
+  // Throws std::runtime_error if the file is not a well-formed binary capture.
+  explicit BinaryCapture(const std::filesystem::path& path);
+  explicit BinaryCapture(MappedFile file);
+
+  class Cursor {
+   public:
+    // Decodes the next event into `event`; returns false once all events were read.
+    bool Next(ByteEvent* event);
+
+   private:
+    friend class BinaryCapture;
+    explicit Cursor(const BinaryCapture& capture);
+
+    const BinaryCapture* capture_;
+    std::size_t index_ = 0;
+    const uint8_t* delta_pos_;
+    int64_t tick_;
+  };
+
+  [[nodiscard]] Cursor cursor() const { return Cursor(*this); }
+  [[nodiscard]] std::size_t size() const { return static_cast<std::size_t>(event_count_); }
+
+ private:
+  MappedFile file_;
+  uint64_t event_count_ = 0;
+  double ticks_per_second_ = 0.0;
+  int64_t first_tick_ = 0;
+  std::span<const uint8_t> values_;
+  std::span<const uint8_t> directions_;
+  std::span<const uint8_t> errors_;
+  std::span<const uint8_t> deltas_;
+};
+
+}  // namespace fujitsu::airstage
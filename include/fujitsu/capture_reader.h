@@ -1,39 +1,91 @@
 #pragma once
 
-#include "fujitsu/packet.h"
+#include "fujitsu/framer.h"
 
+#include <array>
+#include <cstdint>
 #include <filesystem>
-#include <string>
+#include <functional>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace fujitsu::airstage {
 
-enum class BusDirection {
-  Rx,  // Captured as "RX" by the Saleae trace (indoor unit -> module)
-  Tx,  // Captured as "TX" (module -> indoor unit)
+struct FrameSet {
+  std::vector<Frame> frames;
+};
+
+// A single byte observed on the bus.
+struct ByteEvent {
+  BusDirection direction = BusDirection::Rx;
+  double time = 0.0;  // seconds from start of capture
+  uint8_t value = 0;
+  bool has_error = false;  // framing/parity error reported by the decoder
 };
 
-inline constexpr const char* ToString(BusDirection dir) {
-  return dir == BusDirection::Rx ? "RX" : "TX";
-}
+using ByteEventCallback = std::function<void(const ByteEvent&)>;
+
+// Incrementally frames a time-ordered byte stream covering both bus directions. Frames are
+// delivered to the callback in start-time order as soon as neither direction can still produce
+// an earlier one, so memory stays bounded by the in-flight frames rather than the stream length.
+class FrameSequencer {
+ public:
+  explicit FrameSequencer(FrameCallback on_frame, double gap_threshold = 0.004);
+  FrameSequencer(const FrameSequencer&) = delete;
+  FrameSequencer& operator=(const FrameSequencer&) = delete;
+
+  // Bytes must be pushed in non-decreasing time order.
+  void Push(const ByteEvent& event);
+
+  // Declares that no byte earlier than `now` will be pushed any more: expires idle partial
+  // frames and delivers everything that can no longer be preceded by a new frame.
+  void Advance(double now);
+
+  // Flushes partial frames from both directions and delivers everything still queued.
+  void Finish();
 
-struct Frame {
-  enum class Type {
-    Packet,
-    Break,   // 0xFF 0xFF 0x00 0x00 idle signalling
-    Raw,     // bytes that could not be interpreted as a packet
+  // Oldest timestamp among bytes not yet assigned to a frame, if any.
+  [[nodiscard]] std::optional<double> pending_since() const;
+
+ private:
+  struct QueuedFrame {
+    Frame frame;
+    uint64_t sequence = 0;  // tie-breaker so equal timestamps keep production order
   };
 
-  Type type = Type::Raw;
-  BusDirection direction = BusDirection::Rx;
-  double start_time = 0.0;  // seconds from start of capture
-  std::vector<uint8_t> bytes;  // raw bytes as captured (including header for packets)
-};
+  void Enqueue(Frame&& frame);
+  void Release(std::optional<double> watermark);
+  void ReleaseUpTo(double now);
 
-struct FrameSet {
-  std::vector<Frame> frames;
+  FrameCallback on_frame_;
+  std::array<Framer, 2> framers_;
+  std::vector<QueuedFrame> ready_;  // min-heap ordered by (start_time, sequence)
+  uint64_t next_sequence_ = 0;
 };
 
+// Read the byte events of a capture in time order without framing them. Accepts Saleae CSV
+// exports, binary captures (see fujitsu/binary_capture.h) and raw Saleae .sal captures, which
+// are UART-decoded in software (see fujitsu/logic_capture.h); the format is detected from the
+// file contents.
+// Throws std::runtime_error on I/O failures or malformed input.
+void ReadCaptureEvents(const std::filesystem::path& path, const ByteEventCallback& on_event);
+
+// Splits a time-ordered event sequence into consecutive chunks of roughly `chunk_seconds`.
+// Chunks only break where the bus has been silent for longer than `gap_threshold`, which
+// flushes both framers, so framing each chunk independently with the same threshold and
+// concatenating the results yields exactly the frames of the whole sequence.
+[[nodiscard]] std::vector<std::span<const ByteEvent>> SplitAtIdle(
+    std::span<const ByteEvent> events, double chunk_seconds, double gap_threshold = 0.004);
+
+// Stream a Saleae CSV capture, invoking `on_frame` for every frame in start-time order as soon
+// as it is complete. The file is memory-mapped and tokenized in place; column positions come
+// from the header line. CSV rows are merged through a bounded reorder window, so slightly
+// out-of-order exports are tolerated without buffering the whole file. Binary and .sal captures
+// are accepted as well. Throws std::runtime_error on I/O failures.
+void StreamCapture(const std::filesystem::path& path, const FrameCallback& on_frame,
+                   double gap_threshold = 0.004);
+
 // Parse a Saleae CSV capture into frames grouped by packets. `gap_threshold` controls the
 // maximum time between consecutive bytes that are considered part of the same frame.
 // Returns all parsed frames (including raw/break frames if present). Throws std::runtime_error
@@ -41,4 +93,3 @@ struct FrameSet {
 [[nodiscard]] FrameSet LoadCapture(const std::filesystem::path& path, double gap_threshold = 0.004);
 
 }  // namespace fujitsu::airstage
-
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if !FUJITSU_EMBEDDED
+#include <vector>
+#endif
+
+namespace fujitsu::airstage {
+
+// Implementations of the byte sum behind ComputeChecksum. The widest one the CPU supports is
+// picked at first use; the others stay callable for comparison.
+enum class ChecksumBackend {
+  kScalar,
+  kSse2,  // 16 bytes per step with PSADBW
+  kAvx2,  // 32 bytes per step with VPSADBW
+};
+
+[[nodiscard]] const char* ToString(ChecksumBackend backend);
+[[nodiscard]] bool IsSupported(ChecksumBackend backend);
+[[nodiscard]] ChecksumBackend ActiveChecksumBackend();
+
+#if !FUJITSU_EMBEDDED
+// ComputeChecksum with an explicit backend, which must be supported.
+[[nodiscard]] uint16_t ComputeChecksum(std::span<const uint8_t> bytes, ChecksumBackend backend);
+#endif
+
+// Fills `sums` (bytes.size() + 1 entries) with running 16-bit sums: sums[i] is the sum of
+// bytes[0, i) modulo 2^16, so the checksum of any range [a, b) is 0xFFFF - (sums[b] - sums[a]).
+void PrefixSums16(std::span<const uint8_t> bytes, std::span<uint16_t> sums);
+
+// Returns, in ascending order, every offset of `bytes` at which a complete packet with a
+// matching checksum begins. One prefix-sum pass makes each candidate O(1) to check, so
+// resynchronising through corrupted data never re-sums the same bytes.
+#if !FUJITSU_EMBEDDED
+[[nodiscard]] std::vector<std::size_t> FindPacketStarts(std::span<const uint8_t> bytes);
+#endif
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "fujitsu/framer.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+
+#include <optional>
+#include <variant>
+
+#if !FUJITSU_EMBEDDED
+#include <string>
+#endif
+
+namespace fujitsu::airstage {
+
+// A valid packet whose command, direction and payload length match no decoded message shape
+// (handshakes, unknown commands, unexpected payload sizes).
+struct OpaqueMessage {
+  PacketView packet;
+};
+
+// Typed result of classifying one packet. The views borrow from the bytes the packet was
+// parsed from, so the frame must outlive the message.
+using Message = std::variant<ReadRequestView, ReadResponseView, WriteRequestView, WriteResponse,
+                             OpaqueMessage>;
+
+// Selects the single decoder for a packet from its command id and bus direction with one table
+// lookup; the decoder then checks the payload length. Requests only ever decode from RX
+// (indoor unit) traffic and responses from TX, so e.g. a read response can never be mistaken
+// for a read request.
+[[nodiscard]] Message Classify(const PacketView& packet, BusDirection direction);
+
+// Parses and classifies a packet frame. Returns std::nullopt for break/raw frames and for
+// packet frames that fail validation.
+[[nodiscard]] std::optional<Message> Classify(const FrameView& frame);
+
+#if !FUJITSU_EMBEDDED
+// As above; `error`, if provided, receives the reason a packet frame failed validation.
+[[nodiscard]] std::optional<Message> Classify(const Frame& frame, std::string* error = nullptr);
+#endif
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "fujitsu/framer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Log-linear latency histogram in the style of HdrHistogram: values are recorded in whole
+// microseconds into buckets whose width grows with magnitude, keeping the relative error of
+// every reported percentile below 1% at a few kilobytes per histogram.
+class LatencyHistogram {
+ public:
+  void Record(double seconds);
+  void Merge(const LatencyHistogram& other);
+
+  [[nodiscard]] std::size_t count() const { return count_; }
+  [[nodiscard]] double max_seconds() const { return max_us_ * 1e-6; }
+  [[nodiscard]] double mean_seconds() const { return count_ ? total_us_ * 1e-6 / count_ : 0.0; }
+
+  // Smallest recorded latency (to histogram precision) such that `percentile` percent of the
+  // recorded values are at or below it. Returns 0 for an empty histogram.
+  [[nodiscard]] double ValueAtPercentile(double percentile) const;
+
+ private:
+  static constexpr unsigned kSubBucketBits = 8;
+  static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+  static constexpr uint64_t kHalfSubBuckets = kSubBuckets / 2;
+
+  [[nodiscard]] static std::size_t IndexOf(uint64_t value);
+  [[nodiscard]] static uint64_t HighestEquivalent(std::size_t index);
+
+  std::vector<uint64_t> counts_;
+  std::size_t count_ = 0;
+  uint64_t max_us_ = 0;
+  double total_us_ = 0.0;
+};
+
+// Round-trip accounting for one command id.
+struct CommandStats {
+  std::size_t requests = 0;
+  std::size_t answered = 0;
+  std::size_t timeouts = 0;  // requests with no response within the timeout
+  std::size_t orphans = 0;   // responses with no outstanding request for the command
+  LatencyHistogram latency;  // from the end of the request to the start of its response
+
+  void Merge(const CommandStats& other);
+};
+
+// One completed request/response pair.
+struct Transaction {
+  uint32_t command_id = 0;
+  double request_time = 0.0;   // start of the request frame
+  double response_time = 0.0;  // start of the response frame
+  double latency = 0.0;        // response start minus request end
+};
+
+using TransactionCallback = std::function<void(const Transaction&)>;
+
+// Pairs requests with responses. The bus is strictly request/response: the indoor unit (RX)
+// sends a request and the module (TX) answers with the same command id before the next
+// request. A response with no matching outstanding request is an orphan; a request that is
+// superseded, not answered within the timeout, or still open at Finish() is a timeout.
+// Frames must be pushed in time order, as FrameSequencer delivers them.
+class TransactionCorrelator {
+ public:
+  explicit TransactionCorrelator(double timeout = 0.5, TransactionCallback on_transaction = {});
+
+  void Push(const Frame& frame);
+
+  // Times out the outstanding request, if any.
+  void Finish();
+
+  // Per-command statistics keyed by command id.
+  [[nodiscard]] const std::map<uint32_t, CommandStats>& stats() const { return stats_; }
+  [[nodiscard]] std::size_t invalid_packets() const { return invalid_packets_; }
+
+ private:
+  struct Outstanding {
+    uint32_t command_id = 0;
+    double start_time = 0.0;
+    double end_time = 0.0;
+  };
+
+  void ExpireBefore(double time);
+  void TimeOut();
+
+  double timeout_;
+  TransactionCallback on_transaction_;
+  std::optional<Outstanding> outstanding_;
+  std::map<uint32_t, CommandStats> stats_;
+  std::size_t invalid_packets_ = 0;
+};
+
+}  // namespace fujitsu::airstage
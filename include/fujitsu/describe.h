@@ -0,0 +1,28 @@
+#pragma once
+
+#include "fujitsu/framer.h"
+#include "fujitsu/register_mirror.h"
+#include "fujitsu/text_buffer.h"
+
+#include <ostream>
+
+namespace fujitsu::airstage {
+
+// Writes the one-line text form of a frame used by fujitsu_dump (without a trailing newline):
+// timestamp, direction, and either BREAK, RAW bytes, or the decoded packet with known
+// registers named and their values interpreted.
+void DescribeFrame(const Frame& frame, std::ostream& os);
+
+// Appends the same text to `out`. Prefer this form for bulk output: it does not touch
+// iostreams and does not allocate once `out` has grown to its working size.
+void DescribeFrame(const Frame& frame, TextBuffer& out);
+
+// Writes the one-line text form of a register change (without a trailing newline).
+void DescribeChange(const RegisterChange& change, std::ostream& os);
+void DescribeChange(const RegisterChange& change, TextBuffer& out);
+
+// Appends `address=value` as it appears in frame descriptions, e.g.
+// `0x1002(TemperatureSetpoint)=0x00C8(200)[20.0 C]`.
+void DescribeRegisterValue(uint16_t address, uint16_t value, TextBuffer& out);
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace fujitsu::airstage {
+
+// Stack buffer large enough for any frame.
+using FrameBuffer = std::array<uint8_t, kMaxPacketBytes>;
+
+// Largest read that fits in one exchange. The request would allow 127 addresses in its
+// 255-byte payload, but the response spends 4 bytes per register plus a status byte.
+inline constexpr std::size_t kMaxReadAddresses = (kMaxPayloadBytes - 1) / 4;
+
+// Most address/value pairs one write frame can carry (4 bytes each in a 255-byte payload).
+inline constexpr std::size_t kMaxWriteValues = kMaxPayloadBytes / 4;
+
+// Typed request builders. Each writes a complete frame into `out` without allocating and
+// returns its length, or 0 if the arguments do not fit one frame (more than kMaxReadAddresses
+// addresses or kMaxWriteValues values, or an empty list) or `out` is too small.
+
+std::size_t EncodeReadRequest(std::span<const uint16_t> addresses, std::span<uint8_t> out);
+
+// Write frame for one of the write commands (kSetpoint, kControlRegister, kBulkWrite).
+std::size_t EncodeWriteRequest(CommandId command, std::span<const RegisterValue> values,
+                               std::span<uint8_t> out);
+
+// The adapter writes the setpoint register with kSetpoint, single control registers (power,
+// mode, fan speed, ...) with kControlRegister and groups of registers with kBulkWrite.
+std::size_t EncodeSetpoint(uint16_t tenths_celsius, std::span<uint8_t> out);
+std::size_t EncodeControlWrite(RegisterValue value, std::span<uint8_t> out);
+std::size_t EncodeBulkWrite(std::span<const RegisterValue> values, std::span<uint8_t> out);
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "fujitsu/packet.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+
+#if !FUJITSU_EMBEDDED
+#include <vector>
+#endif
+
+namespace fujitsu::airstage {
+
+enum class BusDirection {
+  Rx,  // Captured as "RX" by the Saleae trace (indoor unit -> module)
+  Tx,  // Captured as "TX" (module -> indoor unit)
+};
+
+inline constexpr const char* ToString(BusDirection dir) {
+  return dir == BusDirection::Rx ? "RX" : "TX";
+}
+
+enum class FrameType {
+  Packet,
+  Break,   // 0xFF 0xFF 0x00 0x00 idle signalling
+  Raw,     // bytes that could not be interpreted as a packet
+};
+
+// Frame whose bytes belong to the framer. Valid only for the duration of the callback.
+struct FrameView {
+  FrameType type = FrameType::Raw;
+  BusDirection direction = BusDirection::Rx;
+  double start_time = 0.0;
+  double end_time = 0.0;
+  std::span<const uint8_t> bytes;
+};
+
+// A capturing lambda no larger than two pointers is stored without allocating.
+using FrameViewCallback = std::function<void(const FrameView&)>;
+
+#if !FUJITSU_EMBEDDED
+
+struct Frame {
+  using Type = FrameType;
+
+  Type type = Type::Raw;
+  BusDirection direction = BusDirection::Rx;
+  double start_time = 0.0;  // seconds from start of capture
+  double end_time = 0.0;    // time of the last byte
+  std::vector<uint8_t> bytes;  // raw bytes as captured (including header for packets)
+};
+
+using FrameCallback = std::function<void(Frame&&)>;
+
+#endif
+
+// Largest frame the length byte can describe: header, 255 payload bytes and the checksum.
+inline constexpr std::size_t kMaxFrameBytes = kMaxPacketBytes;
+
+// Incremental framer for one bus direction. Bytes are held in a fixed-capacity ring alongside
+// a running 16-bit sum, so checking a candidate packet at the head is O(1) and dropping a byte
+// while resynchronising never shifts or copies the pending data.
+class Framer {
+ public:
+  // Frames never exceed kMaxFrameBytes, so the ring holds at most that many pending bytes.
+  static constexpr std::size_t kCapacity = 512;
+
+  // Hands out frames as views of a buffer inside the framer; never allocates.
+  Framer(BusDirection direction, FrameViewCallback on_frame, double gap_threshold = 0.004);
+#if !FUJITSU_EMBEDDED
+  Framer(BusDirection direction, FrameCallback on_frame, double gap_threshold = 0.004);
+#endif
+
+  // Appends a byte observed at `time` seconds. A gap longer than the threshold since the
+  // previous byte first flushes whatever is pending as raw data.
+  void Push(uint8_t value, double time);
+
+  // Emits any pending bytes that do not form a complete frame as a raw frame.
+  void Flush();
+
+  // Flushes pending bytes if the line has been idle past the gap threshold at `now`. Live
+  // sources call this while waiting so partial frames do not wait for the next byte.
+  void Expire(double now);
+
+  [[nodiscard]] BusDirection direction() const { return direction_; }
+  [[nodiscard]] std::size_t pending() const { return tail_ - head_; }
+
+  // Timestamp of the oldest pending byte; any frame emitted later starts at or after it.
+  [[nodiscard]] std::optional<double> pending_since() const {
+    if (pending() == 0) {
+      return std::nullopt;
+    }
+    return times_[head_ % kCapacity];
+  }
+
+ private:
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "ring capacity must be a power of two");
+  static_assert(kCapacity > kMaxFrameBytes, "ring must hold the largest frame");
+
+  [[nodiscard]] uint8_t At(std::size_t offset) const { return values_[(head_ + offset) % kCapacity]; }
+  [[nodiscard]] uint16_t SumBefore(std::size_t offset) const;
+  [[nodiscard]] bool HeadChecksumMatches(std::size_t total_length) const;
+
+  void ParseAvailable(bool final_flush);
+  void Emit(FrameType type, std::size_t length);
+
+  BusDirection direction_;
+  FrameViewCallback on_frame_view_;
+#if !FUJITSU_EMBEDDED
+  FrameCallback on_frame_;  // when set, used instead of on_frame_view_
+#endif
+  double gap_threshold_;
+  std::optional<double> last_time_;
+
+  std::array<uint8_t, kCapacity> values_{};
+  std::array<double, kCapacity> times_{};
+  std::array<uint16_t, kCapacity> sums_before_{};  // running sum of all bytes prior to the slot
+  uint16_t running_sum_ = 0;
+  std::size_t head_ = 0;  // absolute index of the oldest pending byte
+  std::size_t tail_ = 0;  // absolute index one past the newest byte
+  std::array<uint8_t, kMaxFrameBytes> view_bytes_{};  // the ring unwrapped for FrameView
+};
+
+}  // namespace fujitsu::airstage
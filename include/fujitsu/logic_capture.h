@@ -0,0 +1,94 @@
+#pragma once
+
+#include "fujitsu/capture_reader.h"
+#include "fujitsu/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Transitions of one digital logic-analyzer channel. The line is stored as run lengths: the
+// level at sample 0 plus the sample index of every edge, so a quiet line costs nothing however
+// long the recording is.
+struct DigitalChannel {
+  double sample_rate = 0.0;  // samples per second
+  bool initial_level = true;
+  uint64_t end_sample = 0;      // one past the last recorded sample
+  std::vector<uint64_t> edges;  // ascending; each one toggles the level
+};
+
+// Parses one `digital-N.bin` member of a Saleae Logic 2 capture (binary format version 2):
+//
+//   header   "<SALEAE>", i32 version, i32 type (100 = digital), u8, f64 sample rate,
+//            u64 start time (Unix ms), f64 fractional ms, u16, u64 chunk count
+//   chunks   u64 first sample, u64 end sample, u8 level after the first interval, u8,
+//            u64 byte count, interval codes
+//
+// Interval codes are big-endian base-128 varints: the first byte holds six value bits below a
+// continuation bit, later bytes seven bits below one. Each code is one less than the number of
+// samples until the next edge; the last interval of the last chunk runs to the end of the
+// capture. Throws std::runtime_error on malformed input.
+[[nodiscard]] DigitalChannel ParseSaleaeDigital(std::span<const uint8_t> bytes);
+
+// Returns every `digital-N.bin` channel of a Saleae Logic 2 `.sal` capture, keyed by channel
+// number. Throws std::runtime_error on I/O failures or malformed input.
+[[nodiscard]] std::map<int, DigitalChannel> ReadSaleaeChannels(const std::filesystem::path& path);
+[[nodiscard]] std::map<int, DigitalChannel> ReadSaleaeChannels(MappedFile file);
+
+enum class UartParity { kNone, kEven, kOdd };
+
+struct UartSettings {
+  double baud = 0.0;  // 0 detects the rate from the line
+  int data_bits = 8;  // 5 to 8, sent LSB first
+  UartParity parity = UartParity::kNone;
+  bool inverted = false;  // idle low instead of idle high
+};
+
+// Estimates the bit rate from the spans between edges of the same polarity: the candidate bit
+// time that the most spans are a whole multiple of wins. Glitches such as those seen while the
+// bus powers up fit no candidate and are outvoted. The result is snapped to the nearest
+// standard rate when within 3%. Returns std::nullopt if the line carries too few transitions
+// to tell.
+[[nodiscard]] std::optional<double> DetectBaudRate(const DigitalChannel& channel);
+
+// Software UART receiver over a DigitalChannel. Each start bit is taken from an edge to the
+// space level; data, parity and stop bits are sampled at their centres and the search for the
+// next start bit resumes after the centre of the stop bit, the way Saleae's async serial
+// analyzer does. Bytes with a bad parity or stop bit are reported with `has_error` set. Level
+// lookups move a cursor forward through the edges, so a whole channel decodes in time linear
+// in its edge count.
+class UartDecoder {
+ public:
+  // Throws std::runtime_error if the settings are invalid or the baud rate cannot be detected.
+  UartDecoder(const DigitalChannel& channel, BusDirection direction, const UartSettings& settings);
+
+  // Decodes the next byte into `event`; returns false once the channel is exhausted.
+  bool Next(ByteEvent* event);
+
+  [[nodiscard]] double baud() const { return baud_; }
+
+ private:
+  [[nodiscard]] bool LevelAt(double sample);
+
+  const DigitalChannel* channel_;
+  BusDirection direction_;
+  UartSettings settings_;
+  double baud_ = 0.0;
+  double bit_samples_ = 0.0;
+  std::size_t next_edge_ = 0;  // where the search for the next start bit resumes
+  std::size_t cursor_ = 0;     // number of edges at or before the last sampled position
+};
+
+// Decodes a Saleae `.sal` capture with the bus wiring used in captures/: channel 0 carries RX,
+// channel 1 carries TX, both 8N1 at an auto-detected rate; a line with too few transitions to
+// tell uses the other line's rate. Bytes from both lines are delivered in time order. Throws
+// std::runtime_error on I/O failures or malformed input.
+void ReadSaleaeEvents(MappedFile file, const ByteEventCallback& on_event);
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace fujitsu::airstage {
+
+// Read-only memory mapping of a whole file. Files smaller than kReadThreshold are read into a
+// heap buffer instead, which costs less than setting up, faulting in and tearing down a
+// mapping. Throws std::runtime_error if the file cannot be opened, mapped or read. Empty files
+// map to an empty span.
+class MappedFile {
+ public:
+  static constexpr std::size_t kReadThreshold = std::size_t{256} << 10;
+
+  explicit MappedFile(const std::filesystem::path& path);
+  ~MappedFile();
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]] std::span<const uint8_t> bytes() const {
+    return {static_cast<const uint8_t*>(data_), size_};
+  }
+  [[nodiscard]] std::string_view text() const { return {static_cast<const char*>(data_), size_}; }
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+ private:
+  void Reset();
+
+  void* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::unique_ptr<uint8_t[]> buffer_;  // owns `data_` when the file was read, not mapped
+};
+
+}  // namespace fujitsu::airstage
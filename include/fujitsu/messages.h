@@ -2,10 +2,17 @@
 
 #include "fujitsu/packet.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <optional>
+#include <span>
+#include <type_traits>
+
+#if !FUJITSU_EMBEDDED
 #include <string>
 #include <vector>
+#endif
 
 namespace fujitsu::airstage {
 
@@ -23,6 +30,88 @@ struct RegisterValue {
   uint16_t value = 0;
 };
 
+// Lazily decoded sequence of fixed-size big-endian records packed back to back in a payload.
+// Elements are decoded on access, so iterating never allocates. Supported element types are
+// uint16_t (register addresses) and RegisterValue (address/value pairs).
+template <typename T>
+class PackedRange {
+ public:
+  static constexpr std::size_t kStride = std::is_same_v<T, RegisterValue> ? 4 : 2;
+
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = T;
+
+    iterator() = default;
+    explicit iterator(const uint8_t* pos) : pos_(pos) {}
+
+    T operator*() const { return Decode(pos_); }
+    iterator& operator++() {
+      pos_ += kStride;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator copy = *this;
+      ++*this;
+      return copy;
+    }
+    bool operator==(const iterator& other) const = default;
+
+   private:
+    const uint8_t* pos_ = nullptr;
+  };
+
+  PackedRange() = default;
+  // `bytes.size()` must be a multiple of kStride.
+  explicit PackedRange(std::span<const uint8_t> bytes) : bytes_(bytes) {}
+
+  [[nodiscard]] iterator begin() const { return iterator(bytes_.data()); }
+  [[nodiscard]] iterator end() const { return iterator(bytes_.data() + bytes_.size()); }
+  [[nodiscard]] std::size_t size() const { return bytes_.size() / kStride; }
+  [[nodiscard]] bool empty() const { return bytes_.empty(); }
+  [[nodiscard]] T operator[](std::size_t index) const { return Decode(bytes_.data() + index * kStride); }
+
+ private:
+  static T Decode(const uint8_t* p) {
+    auto first = static_cast<uint16_t>(p[0] << 8 | p[1]);
+    if constexpr (std::is_same_v<T, RegisterValue>) {
+      return RegisterValue{first, static_cast<uint16_t>(p[2] << 8 | p[3])};
+    } else {
+      return first;
+    }
+  }
+
+  std::span<const uint8_t> bytes_;
+};
+
+using AddressRange = PackedRange<uint16_t>;
+using RegisterValueRange = PackedRange<RegisterValue>;
+
+// Non-owning counterparts of the message structs below. They reference the payload of the
+// PacketView they were decoded from and decode entries only when iterated.
+struct ReadRequestView {
+  AddressRange addresses;
+};
+
+struct ReadResponseView {
+  uint8_t status = 0;
+  RegisterValueRange values;
+};
+
+struct WriteRequestView {
+  RegisterValueRange values;
+};
+
+struct WriteResponse {
+  uint8_t status = 0;
+};
+
+#if !FUJITSU_EMBEDDED
+
 struct ReadRequest {
   std::vector<uint16_t> addresses;
 };
@@ -36,9 +125,16 @@ struct WriteRequest {
   std::vector<RegisterValue> values;
 };
 
-struct WriteResponse {
-  uint8_t status = 0;
-};
+#endif
+
+// Allocation-free decoders operating on a packet view. Each accepts exactly the payloads the
+// owning variants below accept.
+[[nodiscard]] std::optional<ReadRequestView> DecodeReadRequestView(const PacketView& packet);
+[[nodiscard]] std::optional<ReadResponseView> DecodeReadResponseView(const PacketView& packet);
+[[nodiscard]] std::optional<WriteRequestView> DecodeWriteRequestView(const PacketView& packet);
+[[nodiscard]] std::optional<WriteResponse> DecodeWriteResponse(const PacketView& packet);
+
+#if !FUJITSU_EMBEDDED
 
 // Attempt to interpret the provided packet as a read request originating from the indoor unit.
 [[nodiscard]] std::optional<ReadRequest> DecodeReadRequest(const Packet& packet);
@@ -55,5 +151,7 @@ struct WriteResponse {
 // Helper to stringify known command identifiers; unknown ids return an empty string.
 [[nodiscard]] std::string CommandToString(uint32_t command_id);
 
+#endif
+
 }  // namespace fujitsu::airstage
 
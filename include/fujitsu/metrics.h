@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Pipeline instrumentation. Building with FUJITSU_METRICS=0 (CMake option FUJITSU_METRICS=OFF)
+// turns every recording call below into an empty inline function, so the decoder pays nothing.
+#ifndef FUJITSU_METRICS
+#define FUJITSU_METRICS 1
+#endif
+
+namespace fujitsu::airstage {
+
+inline constexpr bool kMetricsEnabled = FUJITSU_METRICS != 0;
+
+enum class MetricCounter : std::size_t {
+  kCaptureBytes,          // capture file bytes read
+  kByteEvents,            // bytes decoded from captures
+  kByteEventErrors,       // of which flagged with a framing/parity error
+  kCaptureMicroseconds,   // capture time covered by the byte events
+  kPacketFrames,          // frames emitted by the framers, by type
+  kBreakFrames,
+  kRawFrames,
+  kRawBytes,              // bytes discarded as raw data
+  kResyncChecksumMisses,  // candidate packets rejected by the framer's checksum check
+  kValidateTooShort,      // ValidateFrame failures, by reason
+  kValidateLengthMismatch,
+  kValidateChecksumMismatch,
+  kMessagesDecoded,       // message decoders that accepted their payload
+  kMessageDecodeFailures,
+  kCount,
+};
+
+// Stages with timing histograms. Cheap, frequent stages time a sample of their calls; every
+// call is still counted along with the bytes it processed.
+enum class MetricTimer : std::size_t {
+  kCapture,   // ReadCaptureEvents, including the consumer of the events; every call timed
+  kValidate,  // ValidateFrame; one call in kMetricTimerSampleInterval timed
+  kDecode,    // message decoders; one call in kMetricTimerSampleInterval timed
+  kCount,
+};
+
+inline constexpr std::size_t kMetricCounterCount = static_cast<std::size_t>(MetricCounter::kCount);
+inline constexpr std::size_t kMetricTimerCount = static_cast<std::size_t>(MetricTimer::kCount);
+// Packet frames are also counted per command id: one slot per known command, then "other".
+inline constexpr std::size_t kMetricCommandSlots = 7;
+// Bucket i counts durations in [2^i, 2^(i+1)) nanoseconds.
+inline constexpr std::size_t kMetricHistogramBuckets = 40;
+inline constexpr uint64_t kMetricTimerSampleInterval = 64;
+
+[[nodiscard]] const char* ToString(MetricCounter counter);
+[[nodiscard]] const char* ToString(MetricTimer timer);
+
+struct TimerSnapshot {
+  uint64_t calls = 0;
+  uint64_t samples = 0;  // calls that were timed
+  uint64_t sampled_nanoseconds = 0;
+  uint64_t bytes = 0;
+  std::array<uint64_t, kMetricHistogramBuckets> buckets{};
+
+  [[nodiscard]] double mean_nanoseconds() const;
+  // Upper bound of the histogram bucket holding quantile `q` of the sampled durations.
+  [[nodiscard]] double percentile_nanoseconds(double q) const;
+  // Throughput extrapolated from the sampled durations to all calls.
+  [[nodiscard]] double bytes_per_second() const;
+};
+
+// Totals across all threads, including threads that have already exited.
+struct MetricsSnapshot {
+  std::array<uint64_t, kMetricCounterCount> counters{};
+  std::array<uint64_t, kMetricCommandSlots> packet_frames_by_command{};
+  std::array<TimerSnapshot, kMetricTimerCount> timers{};
+
+  [[nodiscard]] uint64_t counter(MetricCounter which) const {
+    return counters[static_cast<std::size_t>(which)];
+  }
+  [[nodiscard]] const TimerSnapshot& timer(MetricTimer which) const {
+    return timers[static_cast<std::size_t>(which)];
+  }
+};
+
+// Recording goes to per-thread cells without synchronisation; a snapshot sums the cells of all
+// threads under a lock. Returns an empty snapshot when metrics are compiled out.
+[[nodiscard]] MetricsSnapshot SnapshotMetrics();
+
+// Zeroes all metrics. Updates made concurrently by other threads may be lost.
+void ResetMetrics();
+
+#if FUJITSU_METRICS
+
+void CountMetric(MetricCounter counter, uint64_t amount = 1);
+void CountPacketFrame(uint32_t command_id);
+
+// Counts the call and returns its start time in nanoseconds if it is to be timed, else 0.
+[[nodiscard]] int64_t StartMetricTimer(MetricTimer timer, uint64_t bytes);
+void StopMetricTimer(MetricTimer timer, int64_t start);
+
+#else
+
+inline void CountMetric(MetricCounter, uint64_t = 1) {}
+inline void CountPacketFrame(uint32_t) {}
+[[nodiscard]] inline int64_t StartMetricTimer(MetricTimer, uint64_t) { return 0; }
+inline void StopMetricTimer(MetricTimer, int64_t) {}
+
+#endif
+
+// Times the enclosing scope into `timer`.
+class ScopedMetricTimer {
+ public:
+  explicit ScopedMetricTimer(MetricTimer timer, uint64_t bytes = 0)
+      : timer_(timer), start_(StartMetricTimer(timer, bytes)) {}
+  ~ScopedMetricTimer() {
+    if (start_ != 0) {
+      StopMetricTimer(timer_, start_);
+    }
+  }
+  ScopedMetricTimer(const ScopedMetricTimer&) = delete;
+  ScopedMetricTimer& operator=(const ScopedMetricTimer&) = delete;
+
+ private:
+  MetricTimer timer_;
+  int64_t start_;
+};
+
+}  // namespace fujitsu::airstage
@@ -1,16 +1,50 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <span>
+
+// Embedded profile (CMake option FUJITSU_EMBEDDED=ON). The core - packet parsing, framing,
+// encoding and decoding - is built with -fno-exceptions -fno-rtti, and every declaration that
+// allocates or throws is left out, so code that compiles against these headers works in
+// caller-provided storage only.
+#ifndef FUJITSU_EMBEDDED
+#define FUJITSU_EMBEDDED 0
+#endif
+
+#if !FUJITSU_EMBEDDED
 #include <string>
 #include <vector>
+#endif
 
 namespace fujitsu::airstage {
 
 inline constexpr std::size_t kPacketHeaderBytes = 5;  // 4-byte command + 1-byte length
 inline constexpr std::size_t kPacketTrailerBytes = 2; // 16-bit checksum
+inline constexpr std::size_t kMaxPayloadBytes = 255;  // limit of the length byte
+inline constexpr std::size_t kMaxPacketBytes = kPacketHeaderBytes + kMaxPayloadBytes + kPacketTrailerBytes;
+
+#if !FUJITSU_EMBEDDED
+struct Packet;
+#endif
+
+// Non-owning view of a packet, typically pointing into the frame it was parsed from. The
+// referenced bytes must outlive the view.
+struct PacketView {
+  uint32_t command_id = 0;
+  std::span<const uint8_t> payload;
+  uint16_t checksum = 0;
 
+  [[nodiscard]] std::size_t payload_length() const { return payload.size(); }
+  [[nodiscard]] std::size_t frame_length() const { return kPacketHeaderBytes + payload.size() + kPacketTrailerBytes; }
+
+#if !FUJITSU_EMBEDDED
+  [[nodiscard]] Packet ToPacket() const;
+#endif
+};
+
+#if !FUJITSU_EMBEDDED
 struct Packet {
   uint32_t command_id = 0;
   std::vector<uint8_t> payload;
@@ -19,18 +53,47 @@ struct Packet {
   [[nodiscard]] std::size_t payload_length() const { return payload.size(); }
   [[nodiscard]] std::size_t frame_length() const { return kPacketHeaderBytes + payload.size() + kPacketTrailerBytes; }
 
+  [[nodiscard]] PacketView view() const { return PacketView{command_id, payload, checksum}; }
+
   [[nodiscard]] std::vector<uint8_t> Serialize() const;
 };
+#endif
 
+// 0xFFFF minus the 16-bit sum of `bytes`, computed with the fastest implementation the CPU
+// supports (see fujitsu/checksum.h).
 [[nodiscard]] uint16_t ComputeChecksum(std::span<const uint8_t> bytes);
 
+// Writes a complete frame for `command_id` and `payload` into `out` without allocating.
+// Returns the frame length, or 0 if the payload exceeds kMaxPayloadBytes or `out` is too
+// small.
+std::size_t EncodePacket(uint32_t command_id, std::span<const uint8_t> payload,
+                         std::span<uint8_t> out);
+
+// Why `frame` is not a valid packet ("frame too short", "payload length does not match frame
+// size" or "checksum mismatch"), or nullptr if it is one.
+[[nodiscard]] const char* FrameError(std::span<const uint8_t> frame);
+
+#if FUJITSU_EMBEDDED
+
+[[nodiscard]] std::optional<PacketView> ParsePacketView(std::span<const uint8_t> frame);
+[[nodiscard]] bool ValidateFrame(std::span<const uint8_t> frame);
+
+#else
+
 // Returns a parsed packet if the frame is well-formed and checksum matches.
 // The frame must contain the full header (command id + payload length), payload, and checksum.
 [[nodiscard]] std::optional<Packet> ParsePacket(std::span<const uint8_t> frame, std::string* error = nullptr);
 
+// Same as ParsePacket, but the returned view borrows the payload from `frame` instead of
+// copying it.
+[[nodiscard]] std::optional<PacketView> ParsePacketView(std::span<const uint8_t> frame,
+                                                       std::string* error = nullptr);
+
 // Validates a raw frame without building a Packet structure. Returns true if the frame
 // has coherent sizing and checksum. On failure, `error` (if provided) receives a message.
 [[nodiscard]] bool ValidateFrame(std::span<const uint8_t> frame, std::string* error = nullptr);
 
+#endif
+
 }  // namespace fujitsu::airstage
 
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "fujitsu/capture_reader.h"
+#include "fujitsu/classifier.h"
+#include "fujitsu/framer.h"
+#include "fujitsu/spsc_queue.h"
+#include "fujitsu/transport.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Receives each frame with its classified message (std::nullopt for break/raw frames and
+// packets that fail validation). The message borrows from the frame; both are valid only for
+// the duration of the call.
+using DecodedFrameCallback = std::function<void(const Frame&, const std::optional<Message>&)>;
+
+struct PipelineOptions {
+  double gap_threshold = 0.004;
+  std::size_t byte_queue_capacity = 1 << 16;  // rounded up to a power of two
+  std::size_t frame_queue_capacity = 1 << 10;
+  std::size_t batch_size = 256;  // most entries a stage takes from its queue at once
+};
+
+// Traffic through one queue. `full_waits` counts how often the producing stage found the queue
+// full and had to wait for the next stage: the backpressure a slow consumer exerts.
+struct StageQueueStats {
+  uint64_t pushed = 0;
+  uint64_t full_waits = 0;
+  uint64_t batches = 0;  // non-empty batches taken by the consuming stage
+};
+
+struct PipelineStats {
+  StageQueueStats bytes;
+  StageQueueStats frames;
+  // Wall-clock time from the last byte of a frame being pushed to the callback receiving the
+  // frame, including the idle gap that ends frames which are expired rather than completed.
+  LatencyStats latency;
+};
+
+// Three-stage decoder for live traffic. The thread calling Push only copies timestamped bytes
+// into a bounded lock-free queue, so reading the bus never waits on framing or decoding unless
+// the queue is full. A framer thread turns the bytes into frames (a FrameSequencer, as in
+// StreamCapture) and hands them over a second queue to a decoder thread, which validates and
+// classifies each frame and invokes the callback. Stages take their input in batches and sleep
+// when idle.
+class StagedPipeline {
+ public:
+  // Starts the framer and decoder threads. The callback runs on the decoder thread; if it
+  // throws, later frames are dropped and Finish rethrows the exception.
+  explicit StagedPipeline(DecodedFrameCallback on_frame, const PipelineOptions& options = {});
+  ~StagedPipeline();
+
+  StagedPipeline(const StagedPipeline&) = delete;
+  StagedPipeline& operator=(const StagedPipeline&) = delete;
+
+  // Push, Advance and Finish must all be called from one thread. Byte times must not decrease.
+  void Push(std::span<const ByteEvent> events);
+  void Push(const ByteEvent& event) { Push(std::span<const ByteEvent>(&event, 1)); }
+
+  // Declares that no byte earlier than `now` will follow, so idle partial frames can be
+  // expired (see FrameSequencer::Advance).
+  void Advance(double now);
+
+  // Flushes partial frames, waits until the callback has seen every frame and stops the
+  // threads. Idempotent; rethrows an exception thrown by the callback.
+  void Finish();
+
+  // Complete once Finish has returned.
+  [[nodiscard]] const PipelineStats& stats() const { return stats_; }
+
+ private:
+  enum class InputKind : uint8_t { kByte, kAdvance, kFinish };
+
+  struct Input {
+    double time = 0.0;
+    double ingress = 0.0;  // MonotonicSeconds() when pushed; bytes only
+    uint8_t value = 0;
+    bool has_error = false;
+    BusDirection direction = BusDirection::Rx;
+    InputKind kind = InputKind::kByte;
+  };
+
+  struct StagedFrame {
+    Frame frame;
+    double ingress = 0.0;  // of the frame's last byte
+    bool last = false;
+  };
+
+  void PushInputs(std::span<const Input> inputs);
+  void PushFrame(StagedFrame&& staged);
+  void RunFramer();
+  void RunDecoder();
+
+  DecodedFrameCallback on_frame_;
+  PipelineOptions options_;
+  SpscQueue<Input> inputs_;
+  SpscQueue<StagedFrame> frames_;
+  std::vector<Input> scratch_;  // producer-side conversion buffer
+  PipelineStats stats_;         // each field is written by one stage only
+  std::exception_ptr callback_error_;
+  std::thread framer_;
+  std::thread decoder_;
+  bool finished_ = false;
+};
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "fujitsu/encoder.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+struct PollSchedulerStats {
+  std::size_t requests = 0;
+  std::size_t responses = 0;
+  std::size_t timeouts = 0;
+  std::size_t registers_read = 0;
+};
+
+// Client-side polling plan. Each watched register has a desired refresh interval; NextRequest
+// packs every due register, plus registers that would fall due within one round trip, into a
+// single kReadRegisters request (most overdue first, up to kMaxReadAddresses). The round-trip
+// estimate is a smoothed average of observed response latency, so a slower unit widens the
+// look-ahead and the scheduler trades slightly early refreshes for fewer frames. Only one
+// request is outstanding at a time, as on the real bus.
+class PollScheduler {
+ public:
+  // `max_addresses` caps the registers per request; 1 gives one-register-per-request polling.
+  explicit PollScheduler(double initial_latency = 0.02,
+                         std::size_t max_addresses = kMaxReadAddresses);
+
+  // Adds a register (or changes its interval). It is first due immediately.
+  void Watch(uint16_t address, double interval, double now = 0.0);
+  void Unwatch(uint16_t address);
+
+  // Returns the next request to send at `now`, or std::nullopt if nothing is due yet or a
+  // request is still awaiting its response.
+  [[nodiscard]] std::optional<Packet> NextRequest(double now);
+
+  // Earliest time a register falls due, or std::nullopt if none are watched.
+  [[nodiscard]] std::optional<double> NextDue() const;
+
+  // Accounts for the response to the outstanding request and reschedules the registers it
+  // covered. Returns the decoded response, or std::nullopt if `response` is not a read
+  // response (the request stays outstanding).
+  std::optional<ReadResponse> OnResponse(const Packet& response, double now);
+
+  // Abandons the outstanding request; its registers stay due and the latency estimate backs
+  // off.
+  void OnTimeout(double now);
+
+  [[nodiscard]] bool awaiting_response() const { return outstanding_.has_value(); }
+
+  // How long to wait for a response before calling OnTimeout.
+  [[nodiscard]] double response_timeout() const;
+  [[nodiscard]] double smoothed_latency() const { return smoothed_latency_; }
+  [[nodiscard]] const PollSchedulerStats& stats() const { return stats_; }
+
+ private:
+  struct Watched {
+    uint16_t address = 0;
+    double interval = 0.0;
+    double next_due = 0.0;
+  };
+
+  struct Outstanding {
+    double sent_at = 0.0;
+    std::vector<std::size_t> entries;  // indices into watched_
+  };
+
+  void RecordLatency(double sample);
+
+  std::vector<Watched> watched_;
+  std::optional<Outstanding> outstanding_;
+  std::vector<std::size_t> candidates_;
+  std::size_t max_addresses_;
+  double smoothed_latency_;
+  double latency_variance_;
+  PollSchedulerStats stats_;
+};
+
+}  // namespace fujitsu::airstage
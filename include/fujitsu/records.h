@@ -0,0 +1,110 @@
+#pragma once
+
+#include "fujitsu/correlator.h"
+#include "fujitsu/framer.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/text_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Machine-readable forms of decoded traffic, built straight from the decoded messages so that
+// consumers never have to parse the text produced by DescribeFrame.
+//
+// NDJSON: one object per line. Every frame record has
+//   "t"        frame start in seconds (shortest round-trip form)
+//   "dir"      "RX" or "TX"
+//   "type"     "packet", "break", "raw" or "invalid" (packet framing that failed validation)
+// packets add
+//   "command", "command_name", "message" ("ReadRequest", "ReadResponse", "WriteRequest",
+//   "WriteResponse" or "Opaque"), "status" for responses, and
+//   "registers": [{"address", "value", "name", "decoded", "unit"}] with the last three present
+//   only for known registers (read requests list addresses only);
+// responses matched to their request add "request_t" (the request record's "t") and "latency"
+// (seconds from the end of the request to the start of the response); raw, invalid and opaque
+// frames add "bytes" as a hex string and invalid frames the validation "error". A
+// {"type":"capture","path":...} record precedes the frames of each capture file.
+//
+// Binary: the stream header (magic "FJRS", u16 version, u16 reserved) followed by records. All
+// integers are little-endian; times are IEEE-754 doubles.
+//
+//   u32 size            bytes in the record after this field
+//   f64 time            frame start
+//   u8  direction       0 = RX, 1 = TX
+//   u8  type            RecordType
+//   u8  message         RecordMessage
+//   u8  status          response status byte, 0 otherwise
+//   u32 command         command id, 0 for non-packets
+//   f64 request_time    start of the matched request, NaN if none
+//   f64 latency         response latency, NaN if none
+//   u16 register count  followed by {u16 address, u16 value} per register (value 0 for read
+//                       requests)
+//   u32 byte count      followed by the raw bytes (raw, invalid and opaque frames) or the path
+//                       (capture records)
+//
+// Register values are stored raw; LookupRegister and DecodeValue interpret them.
+inline constexpr char kRecordStreamMagic[4] = {'F', 'J', 'R', 'S'};
+inline constexpr uint16_t kRecordStreamVersion = 1;
+inline constexpr std::size_t kRecordStreamHeaderBytes = 8;
+
+enum class RecordType : uint8_t {
+  kPacket = 0,
+  kBreak = 1,
+  kRaw = 2,
+  kInvalid = 3,
+  kCapture = 4,
+};
+
+enum class RecordMessage : uint8_t {
+  kNone = 0,
+  kReadRequest = 1,
+  kReadResponse = 2,
+  kWriteRequest = 3,
+  kWriteResponse = 4,
+  kOpaque = 5,
+};
+
+// Owning form of one binary record, as returned by BinaryRecordReader.
+struct Record {
+  double time = 0.0;
+  BusDirection direction = BusDirection::Rx;
+  RecordType type = RecordType::kRaw;
+  RecordMessage message = RecordMessage::kNone;
+  uint8_t status = 0;
+  uint32_t command_id = 0;
+  std::optional<Transaction> transaction;  // responses matched to a request
+  std::vector<RegisterValue> registers;
+  std::vector<uint8_t> bytes;
+};
+
+// Appends one NDJSON line (with trailing newline) for `frame`. `transaction` is the
+// request/response pair the frame completed, if any (see TransactionCorrelator).
+void AppendNdjsonRecord(const Frame& frame, const Transaction* transaction, TextBuffer& out);
+void AppendNdjsonCaptureRecord(const std::string& path, TextBuffer& out);
+
+void AppendRecordStreamHeader(std::vector<uint8_t>& out);
+void AppendBinaryRecord(const Frame& frame, const Transaction* transaction,
+                        std::vector<uint8_t>& out);
+void AppendBinaryCaptureRecord(const std::string& path, std::vector<uint8_t>& out);
+
+// Sequential reader over a binary record stream held in memory.
+class BinaryRecordReader {
+ public:
+  // Throws std::runtime_error if `bytes` does not start with a record stream header.
+  explicit BinaryRecordReader(std::span<const uint8_t> bytes);
+
+  // Returns the next record, or std::nullopt at the end of the stream. Throws
+  // std::runtime_error on a truncated or malformed record.
+  [[nodiscard]] std::optional<Record> Next();
+
+ private:
+  std::span<const uint8_t> remaining_;
+};
+
+}  // namespace fujitsu::airstage
@@ -2,17 +2,119 @@
 
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
 
 namespace fujitsu::airstage {
 
+enum class OperationMode : uint16_t {
+  kAuto = 0,
+  kCool = 1,
+  kDry = 2,
+  kFan = 3,
+  kHeat = 4,
+};
+
+enum class FanSpeed : uint16_t {
+  kAuto = 0,
+  kQuiet = 2,
+  kLow = 5,
+  kMedium = 8,
+  kHigh = 11,
+};
+
+[[nodiscard]] const char* ToString(OperationMode mode);
+[[nodiscard]] const char* ToString(FanSpeed speed);
+
+// Typed decoders for the registers with known meanings. They return std::nullopt for values
+// outside the observed range (e.g. 0xFFFF, which the unit reports for unavailable registers).
+[[nodiscard]] constexpr std::optional<OperationMode> DecodeOperationMode(uint16_t raw) {
+  if (raw > static_cast<uint16_t>(OperationMode::kHeat)) {
+    return std::nullopt;
+  }
+  return static_cast<OperationMode>(raw);
+}
+
+[[nodiscard]] constexpr std::optional<FanSpeed> DecodeFanSpeed(uint16_t raw) {
+  switch (static_cast<FanSpeed>(raw)) {
+    case FanSpeed::kAuto:
+    case FanSpeed::kQuiet:
+    case FanSpeed::kLow:
+    case FanSpeed::kMedium:
+    case FanSpeed::kHigh:
+      return static_cast<FanSpeed>(raw);
+  }
+  return std::nullopt;
+}
+
+// The setpoint is transferred in tenths of a degree Celsius (0x00C8 = 20.0 C = 68 F).
+[[nodiscard]] constexpr std::optional<double> DecodeSetpointCelsius(uint16_t raw) {
+  if (raw == 0xFFFF) {
+    return std::nullopt;
+  }
+  return raw / 10.0;
+}
+
+[[nodiscard]] constexpr std::optional<bool> DecodeFlag(uint16_t raw) {
+  if (raw > 1) {
+    return std::nullopt;
+  }
+  return raw == 1;
+}
+
+// How a register's raw value maps to a meaning.
+enum class ValueKind : uint8_t {
+  kRaw,      // no known interpretation
+  kEnum,     // one of `labels`
+  kScaled,   // raw * scale, in `unit`
+  kBoolean,  // 0 = off, 1 = on
+};
+
+struct EnumLabel {
+  uint16_t value = 0;
+  const char* label = nullptr;
+};
+
+// Data-driven description of a register value, so one decoder serves every register and the
+// lookup never branches on the address.
+struct RegisterCodec {
+  ValueKind kind = ValueKind::kRaw;
+  std::span<const EnumLabel> labels{};
+  double scale = 1.0;
+  const char* unit = "";
+  std::optional<uint16_t> invalid{};  // raw value meaning "not available"
+};
+
+struct DecodedValue {
+  ValueKind kind = ValueKind::kRaw;
+  const char* label = nullptr;  // kEnum and kBoolean
+  double number = 0.0;          // kScaled
+  const char* unit = "";        // kScaled
+};
+
+// Interprets `raw` with `codec`. Returns std::nullopt for raw codecs and for values the codec
+// does not cover.
+[[nodiscard]] std::optional<DecodedValue> DecodeValue(const RegisterCodec& codec, uint16_t raw);
+
+enum class RegisterAccess : uint8_t {
+  kUnknown,
+  kReadOnly,
+  kWriteOnly,
+  kReadWrite,
+};
+
+[[nodiscard]] const char* ToString(RegisterAccess access);
+
 struct RegisterInfo {
   const char* name = nullptr;
   const char* description = nullptr;
+  const RegisterCodec* codec = nullptr;  // never null for registers returned by LookupRegister
+  RegisterAccess access = RegisterAccess::kUnknown;
 };
 
-// Returns metadata for a known register address, if available.
+// Returns metadata for a known register address, if available. Definitions from the active
+// runtime register map (see fujitsu/register_map.h) take precedence over the built-in table.
+// Both are laid out as two-level page tables, so a lookup is a few indexed loads.
 [[nodiscard]] std::optional<RegisterInfo> LookupRegister(uint16_t address);
 
 }  // namespace fujitsu::airstage
-
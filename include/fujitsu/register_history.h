@@ -0,0 +1,130 @@
+#pragma once
+
+#include "fujitsu/classifier.h"
+#include "fujitsu/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// A stretch of time during which a register kept one value: from the observation that first
+// showed `value` to the last observation before it changed (or the last one recorded).
+struct HistoryRun {
+  double start = 0.0;
+  double last_seen = 0.0;
+  uint16_t value = 0;
+};
+
+// Persistent per-register value history. Registers are polled constantly but rarely change, so
+// the history stores runs of equal values rather than observations.
+//
+// File layout (little-endian):
+//
+//   header      32 bytes: magic "FJRH", u16 version, u16 reserved, u32 register count,
+//               u64 run count, u64 ticks per second
+//   directory   32 bytes per register, sorted by address: u16 address, u16 reserved,
+//               u32 run count, u64 block index offset, u64 data offset, u64 data size
+//   per register
+//     index     16 bytes per block of kHistoryRunsPerBlock runs: i64 start tick of the
+//               block's first run, u32 offset of the block in the register's data, u32 reserved
+//     data      LEB128 varints per run: start ticks since the previous run in the block (0 for
+//               the first), ticks from start to last_seen, value
+//
+// Times are stored at nanosecond resolution. Lookups binary-search the directory and the block
+// index and decode at most one block per query endpoint, so range and as-of queries take
+// logarithmic time in the length of the history.
+inline constexpr char kHistoryMagic[4] = {'F', 'J', 'R', 'H'};
+inline constexpr uint16_t kHistoryVersion = 1;
+inline constexpr std::size_t kHistoryHeaderBytes = 32;
+inline constexpr std::size_t kHistoryDirectoryEntryBytes = 32;
+inline constexpr std::size_t kHistoryIndexEntryBytes = 16;
+inline constexpr std::size_t kHistoryRunsPerBlock = 64;
+inline constexpr uint64_t kHistoryTicksPerSecond = 1'000'000'000;
+
+class RegisterHistory;
+
+// Accumulates register observations in time order and writes them out as a history file.
+class RegisterHistoryWriter {
+ public:
+  RegisterHistoryWriter() = default;
+
+  // Continues an existing history; new observations must not predate what it already holds.
+  explicit RegisterHistoryWriter(const RegisterHistory& existing);
+
+  // Records the values carried by a read response or write request observed at `time`; other
+  // messages are ignored.
+  void Apply(const Message& message, double time);
+
+  // Records one observation. Throws std::runtime_error if `time` is earlier than the last
+  // observation of the same register.
+  void Record(uint16_t address, uint16_t value, double time);
+
+  // Throws std::runtime_error if the file cannot be written.
+  void Write(const std::filesystem::path& path) const;
+
+  // Time of the latest observation of any register, if any were recorded.
+  [[nodiscard]] std::optional<double> end_time() const;
+
+ private:
+  struct TickRun {
+    int64_t start = 0;
+    int64_t last_seen = 0;
+    uint16_t value = 0;
+  };
+
+  std::map<uint16_t, std::vector<TickRun>> runs_;
+};
+
+// Memory-mapped history file. The header, directory and block indexes are validated up front;
+// run data is decoded on demand straight from the mapping.
+class RegisterHistory {
+ public:
+  // Throws std::runtime_error if the file is not a well-formed history.
+  explicit RegisterHistory(const std::filesystem::path& path);
+  explicit RegisterHistory(MappedFile file);
+
+  // Addresses with at least one run, ascending.
+  [[nodiscard]] std::vector<uint16_t> addresses() const;
+
+  [[nodiscard]] std::size_t run_count(uint16_t address) const;
+  [[nodiscard]] std::size_t run_count() const { return total_runs_; }
+
+  // Runs overlapping [from, to]: the run in effect at `from` (if any) and every run starting no
+  // later than `to`.
+  [[nodiscard]] std::vector<HistoryRun> Range(uint16_t address, double from, double to) const;
+
+  // The run in effect at `time`: the latest one starting at or before it.
+  [[nodiscard]] std::optional<HistoryRun> AsOf(uint16_t address, double time) const;
+
+  // Every run of `address`, oldest first.
+  [[nodiscard]] std::vector<HistoryRun> All(uint16_t address) const;
+
+ private:
+  friend class RegisterHistoryWriter;
+
+  struct Entry {
+    uint16_t address = 0;
+    uint32_t runs = 0;
+    std::span<const uint8_t> index;
+    std::span<const uint8_t> data;
+  };
+
+  [[nodiscard]] const Entry* Find(uint16_t address) const;
+  // Decodes runs of `entry` starting with block `block` until `visit` returns false.
+  template <typename Visit>
+  void Scan(const Entry& entry, std::size_t block, Visit&& visit) const;
+  // Last block whose first run starts at or before `tick`, or std::nullopt if none does.
+  [[nodiscard]] std::optional<std::size_t> BlockAtOrBefore(const Entry& entry, int64_t tick) const;
+
+  MappedFile file_;
+  std::vector<Entry> entries_;
+  std::size_t total_runs_ = 0;
+};
+
+}  // namespace fujitsu::airstage
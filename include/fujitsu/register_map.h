@@ -0,0 +1,102 @@
+#pragma once
+
+#include "fujitsu/register_db.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Register definitions loaded at runtime, so newly understood registers need no rebuild. One
+// definition per line; blank lines and lines starting with '#' are ignored:
+//
+//   <address> <name> <access> <codec> [codec arguments] [invalid=<raw>] [-- <description>]
+//
+//   0x1001 OperationMode rw enum 0=Auto 1=Cool 2=Dry 3=Fan 4=Heat
+//   0x1002 TemperatureSetpoint rw scale 0.1 C invalid=0xFFFF -- setpoint in tenths of a degree
+//   0x1108 EnergySavingFan rw bool
+//   0x1033 Unknown1033 ro raw
+//
+// Access is one of ro, wo, rw or '-' (unknown). Codecs are raw, bool, enum <value>=<label>...
+// and scale <factor> <unit>. Definitions are stored in the same two-level page table layout
+// as the built-in table. Maps are immutable once built and handed around by pointer, since
+// RegisterInfo points into their storage.
+class RegisterMap {
+ public:
+  // Throw std::runtime_error naming the file and line of the first invalid definition.
+  [[nodiscard]] static std::unique_ptr<const RegisterMap> Load(const std::filesystem::path& path);
+  [[nodiscard]] static std::unique_ptr<const RegisterMap> Parse(std::string_view text,
+                                                                const std::string& source);
+
+  RegisterMap(const RegisterMap&) = delete;
+  RegisterMap& operator=(const RegisterMap&) = delete;
+
+  [[nodiscard]] std::optional<RegisterInfo> Find(uint16_t address) const;
+  [[nodiscard]] std::size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    uint16_t address = 0;
+    std::string name;
+    std::string description;
+    std::vector<std::string> label_text;
+    std::vector<EnumLabel> labels;
+    std::string unit;
+    RegisterCodec codec;
+    RegisterAccess access = RegisterAccess::kUnknown;
+  };
+
+  RegisterMap() = default;
+  void Add(Entry entry);
+
+  std::array<uint16_t, 256> page_of_{};  // 0 = no page
+  std::vector<std::array<uint16_t, 256>> slots_;  // 1-based index into entries_, 0 = unknown
+  std::vector<std::unique_ptr<Entry>> entries_;
+};
+
+// Makes `map` the definitions LookupRegister consults before the built-in table (nullptr
+// reverts to the built-in table alone). Each thread keeps a reference to the map it last used
+// and checks an atomic generation counter on every lookup, taking a lock only on its first
+// lookup after an install. The map returned by ActiveRegisterMap, and any RegisterInfo taken
+// from it, therefore stay valid until the same thread's next ActiveRegisterMap or
+// LookupRegister call; a replaced map is freed once no thread refers to it.
+void InstallRegisterMap(std::unique_ptr<const RegisterMap> map);
+[[nodiscard]] const RegisterMap* ActiveRegisterMap();
+
+// Loads a register map file and installs it, then reinstalls it whenever the file changes.
+class RegisterMapWatcher {
+ public:
+  // Throws std::runtime_error if the initial load fails.
+  explicit RegisterMapWatcher(std::filesystem::path path);
+
+  // Reloads the file if its modification time or size changed since the last load. Returns
+  // true if a new map was installed. A file that is missing or fails to parse leaves the
+  // current map active and its error in `error` (if provided); a failure that persists across
+  // polls is reported only once.
+  bool Poll(std::string* error = nullptr);
+
+  [[nodiscard]] const std::filesystem::path& path() const { return path_; }
+
+ private:
+  struct Stamp {
+    std::filesystem::file_time_type modified;
+    std::uintmax_t size = 0;
+    bool operator==(const Stamp&) const = default;
+  };
+
+  [[nodiscard]] Stamp Current() const;
+  void Report(const std::string& what, std::string* error);
+
+  std::filesystem::path path_;
+  Stamp loaded_;
+  std::string reported_;  // last failure passed to the caller
+};
+
+}  // namespace fujitsu::airstage
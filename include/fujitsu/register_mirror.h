@@ -0,0 +1,83 @@
+#pragma once
+
+#include "fujitsu/classifier.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Which kind of traffic last set a register.
+enum class RegisterSource {
+  kRead,   // value reported by the unit in a read response
+  kWrite,  // value requested by a write
+};
+
+[[nodiscard]] const char* ToString(RegisterSource source);
+
+// Latest known state of one register.
+struct RegisterState {
+  uint16_t value = 0;
+  double updated = 0.0;  // time the value was last observed
+  double changed = 0.0;  // time the value last differed from the one before it
+  RegisterSource source = RegisterSource::kRead;
+};
+
+// Published whenever a register takes a value different from the one last seen (including the
+// first time it is seen at all).
+struct RegisterChange {
+  uint16_t address = 0;
+  std::optional<uint16_t> previous;  // std::nullopt on first sighting
+  uint16_t value = 0;
+  double time = 0.0;
+  RegisterSource source = RegisterSource::kRead;
+};
+
+using RegisterChangeCallback = std::function<void(const RegisterChange&)>;
+
+// Shadow copy of the unit's registers built from decoded traffic. State lives in a flat table
+// covering the whole 16-bit address space, so lookups and updates are a single index, and
+// subscribers hear about values only when they change.
+class RegisterMirror {
+ public:
+  using SubscriptionId = std::size_t;
+
+  RegisterMirror();
+
+  // Records the values carried by a read response or write request observed at `time`. Other
+  // messages are ignored. Returns the number of registers whose value changed.
+  std::size_t Apply(const Message& message, double time);
+
+  // Records one value. Returns true if it differs from the previously known value.
+  bool Update(uint16_t address, uint16_t value, double time, RegisterSource source);
+
+  [[nodiscard]] std::optional<RegisterState> Get(uint16_t address) const;
+
+  // Addresses seen so far, in the order they were first observed.
+  [[nodiscard]] std::span<const uint16_t> addresses() const { return addresses_; }
+  [[nodiscard]] std::size_t size() const { return addresses_.size(); }
+
+  // Callbacks run synchronously from Apply/Update and must not subscribe or unsubscribe.
+  SubscriptionId Subscribe(RegisterChangeCallback callback);
+  void Unsubscribe(SubscriptionId id);
+
+ private:
+  struct Slot {
+    RegisterState state;
+    bool known = false;
+  };
+
+  void Publish(const RegisterChange& change);
+
+  std::unique_ptr<Slot[]> slots_;
+  std::vector<uint16_t> addresses_;
+  std::vector<std::pair<SubscriptionId, RegisterChangeCallback>> subscribers_;
+  SubscriptionId next_subscription_ = 0;
+};
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace fujitsu::airstage {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. Head and tail
+// are free-running counters on separate cache lines; each side also caches the other side's
+// counter and only reloads it when the cached value says the queue is full (or empty), so a
+// transfer normally touches no shared cache line but the slot and its own counter. Batched push
+// and pop publish once per batch.
+//
+// Blocking waits spin briefly and then sleep on the counter with std::atomic::wait; the other
+// side notifies after every publish, which costs no system call unless someone is asleep.
+template <typename T>
+class SpscQueue {
+ public:
+  // `capacity` is rounded up to a power of two. Throws std::invalid_argument if it is zero.
+  explicit SpscQueue(std::size_t capacity)
+      : slots_(std::bit_ceil(capacity)), mask_(slots_.size() - 1) {
+    if (capacity == 0) {
+      throw std::invalid_argument("SpscQueue capacity must be positive");
+    }
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  [[nodiscard]] std::size_t capacity() const { return slots_.size(); }
+
+  // Approximate when called concurrently with the other side.
+  [[nodiscard]] std::size_t size() const {
+    return static_cast<std::size_t>(tail_.load(std::memory_order_acquire) -
+                                    head_.load(std::memory_order_acquire));
+  }
+
+  // Producer side. Returns false if the queue is full; `value` is then left untouched.
+  bool TryPush(T&& value) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == slots_.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == slots_.size()) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(value);
+    Publish(tail + 1);
+    return true;
+  }
+
+  // Producer side. Copies as many leading elements of `values` as fit and returns their count.
+  std::size_t TryPush(std::span<const T> values) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (slots_.size() - (tail - cached_head_) < values.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    std::size_t count = std::min<std::size_t>(values.size(), slots_.size() - (tail - cached_head_));
+    for (std::size_t i = 0; i < count; ++i) {
+      slots_[(tail + i) & mask_] = values[i];
+    }
+    if (count != 0) {
+      Publish(tail + count);
+    }
+    return count;
+  }
+
+  // Consumer side. Invokes `consume(T&)` on up to `max` queued elements in order and returns
+  // how many were consumed. The slots are released to the producer once the batch is done, so
+  // an element may be moved from or referenced until `consume` returns.
+  template <typename Consume>
+  std::size_t PopBatch(std::size_t max, Consume&& consume) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < max) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    std::size_t count = std::min<std::size_t>(max, cached_tail_ - head);
+    for (std::size_t i = 0; i < count; ++i) {
+      consume(slots_[(head + i) & mask_]);
+    }
+    if (count != 0) {
+      head_.store(head + count, std::memory_order_release);
+      head_.notify_one();
+    }
+    return count;
+  }
+
+  // Consumer side: blocks until at least one element is queued.
+  void WaitNotEmpty() {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    WaitWhileEqual(tail_, head);
+  }
+
+  // Producer side: blocks until at least one slot is free.
+  void WaitNotFull() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    WaitWhileEqual(head_, tail - slots_.size());
+  }
+
+ private:
+  // Checks before sleeping; relaxes the CPU between checks.
+  static constexpr int kSpinIterations = 256;
+
+  static void WaitWhileEqual(const std::atomic<uint64_t>& counter, uint64_t value) {
+    for (int i = 0; i < kSpinIterations; ++i) {
+      if (counter.load(std::memory_order_acquire) != value) {
+        return;
+      }
+#if defined(__SSE2__)
+      _mm_pause();
+#endif
+    }
+    counter.wait(value, std::memory_order_acquire);
+  }
+
+  void Publish(uint64_t tail) {
+    tail_.store(tail, std::memory_order_release);
+    tail_.notify_one();
+  }
+
+  static constexpr std::size_t kCacheLine = 64;
+
+  std::vector<T> slots_;
+  const std::size_t mask_;
+  alignas(kCacheLine) std::atomic<uint64_t> head_{0};  // written by the consumer
+  uint64_t cached_tail_ = 0;                           // consumer's view of tail_
+  alignas(kCacheLine) std::atomic<uint64_t> tail_{0};  // written by the producer
+  uint64_t cached_head_ = 0;                           // producer's view of head_
+};
+
+}  // namespace fujitsu::airstage
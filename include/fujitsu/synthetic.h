@@ -0,0 +1,26 @@
+#pragma once
+
+#include "fujitsu/capture_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+struct SyntheticTrafficOptions {
+  std::size_t bytes = 1 << 20;      // stop once at least this many bytes have been generated
+  double noise = 0.0;               // probability that a byte is replaced by a random value
+  double byte_seconds = 10.0 / 9600.0;
+  double response_latency = 0.015;  // gap between a request and its response
+  double poll_interval = 0.3;       // gap between transactions
+  uint32_t seed = 1;
+};
+
+// Generates bus traffic shaped like the captures: polling reads of the adapter's usual 18
+// registers answered by the unit, interleaved with control writes and their acknowledgements.
+// Corrupted bytes are also flagged with has_error, as the logic analyser would. The output is
+// deterministic for a given seed and ordered by time.
+[[nodiscard]] std::vector<ByteEvent> GenerateTraffic(const SyntheticTrafficOptions& options);
+
+}  // namespace fujitsu::airstage
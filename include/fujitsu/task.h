@@ -0,0 +1,138 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+// Lazily started coroutine returning T. A Task runs when it is first co_awaited, or when the
+// owner calls Start, and resumes its awaiter when it finishes (by symmetric transfer, so long
+// chains of awaits do not grow the stack). Exceptions escaping the coroutine are rethrown to
+// the awaiter or from result(). The Task owns the coroutine frame.
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+template <typename T>
+class TaskPromiseBase {
+ public:
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  auto final_suspend() noexcept {
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept {
+        return continuation ? continuation : std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+      std::coroutine_handle<> continuation;
+    };
+    return FinalAwaiter{continuation_};
+  }
+
+  void unhandled_exception() { error_ = std::current_exception(); }
+
+  void set_continuation(std::coroutine_handle<> continuation) { continuation_ = continuation; }
+
+ protected:
+  void RethrowIfFailed() const {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  std::coroutine_handle<> continuation_;
+  std::exception_ptr error_;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase<T> {
+ public:
+  Task<T> get_return_object();
+
+  void return_value(T value) { value_.emplace(std::move(value)); }
+
+  T TakeResult() {
+    this->RethrowIfFailed();
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase<void> {
+ public:
+  Task<void> get_return_object();
+
+  void return_void() {}
+
+  void TakeResult() { RethrowIfFailed(); }
+};
+
+}  // namespace detail
+
+template <typename T>
+class Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+
+  Task() = default;
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  // Runs the coroutine up to its first suspension point. For tasks nobody co_awaits.
+  void Start() { handle_.resume(); }
+
+  [[nodiscard]] bool done() const { return !handle_ || handle_.done(); }
+
+  // The value the finished coroutine returned; rethrows its exception. Call once, after done().
+  T result() { return handle_.promise().TakeResult(); }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+    handle_.promise().set_continuation(awaiter);
+    return handle_;
+  }
+  T await_resume() { return handle_.promise().TakeResult(); }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+}  // namespace detail
+
+}  // namespace fujitsu::airstage
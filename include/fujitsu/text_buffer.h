@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+// Growable character buffer for building text output without iostreams. Clearing keeps the
+// allocation, so a buffer reused across lines stops allocating once it has reached its
+// high-water mark.
+class TextBuffer {
+ public:
+  void Append(char c) { text_.push_back(c); }
+  void Append(std::string_view text) { text_.append(text); }
+
+  // Appends `value` as `digits` upper-case hex digits (2, 4 or 8), zero-padded.
+  void AppendHex(uint32_t value, int digits);
+
+  // Appends `value` in decimal.
+  void AppendDecimal(uint64_t value);
+
+  // Appends `value` in the shortest form that reads back as the same double.
+  void AppendDouble(double value);
+
+  // Appends `value` with `precision` fractional digits, right-aligned in at least `width`
+  // characters; matches `std::setw(width) << std::fixed << std::setprecision(precision)`.
+  void AppendFixed(double value, int precision, int width = 0);
+
+  [[nodiscard]] std::string_view view() const { return text_; }
+  [[nodiscard]] std::size_t size() const { return text_.size(); }
+  [[nodiscard]] bool empty() const { return text_.empty(); }
+  void clear() { text_.clear(); }
+
+  // Moves the contents out, leaving the buffer empty.
+  [[nodiscard]] std::string Take() { return std::exchange(text_, {}); }
+
+  // Writes the contents to `os` in one call and clears the buffer.
+  void WriteTo(std::ostream& os);
+
+ private:
+  std::string text_;
+};
+
+}  // namespace fujitsu::airstage
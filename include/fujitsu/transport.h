@@ -0,0 +1,146 @@
+#pragma once
+
+#include "fujitsu/capture_reader.h"
+#include "fujitsu/framer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+enum class Parity {
+  kNone,
+  kEven,
+  kOdd,
+};
+
+// Line settings of the indoor unit UART. The captures show 9600 baud with 8 data bits, no
+// parity and one stop bit (each byte spans ~9.5 bit times up to the middle of the stop bit).
+struct SerialSettings {
+  uint32_t baud = 9600;
+  Parity parity = Parity::kNone;
+
+  // Time one byte occupies on the wire: start bit, 8 data bits, optional parity, stop bit.
+  [[nodiscard]] double byte_seconds() const {
+    return (parity == Parity::kNone ? 10.0 : 11.0) / static_cast<double>(baud);
+  }
+};
+
+// Non-blocking serial device (or pseudo-terminal) in raw mode. Owns the file descriptor.
+class SerialPort {
+ public:
+  // Opens and configures `device`. Throws std::runtime_error on failure.
+  explicit SerialPort(const std::filesystem::path& device, const SerialSettings& settings = {});
+  // Takes ownership of an already open descriptor and configures it the same way.
+  explicit SerialPort(int fd, const SerialSettings& settings = {});
+  ~SerialPort();
+
+  SerialPort(SerialPort&& other) noexcept;
+  SerialPort& operator=(SerialPort&& other) noexcept;
+  SerialPort(const SerialPort&) = delete;
+  SerialPort& operator=(const SerialPort&) = delete;
+
+  [[nodiscard]] int fd() const { return fd_; }
+  [[nodiscard]] const SerialSettings& settings() const { return settings_; }
+
+  // Reads whatever is available without blocking. Returns the number of bytes read (0 if none
+  // are pending). Sets `closed` (if provided) when the read reports that the other end of a
+  // pseudo-terminal has gone away. Throws std::runtime_error on other I/O errors.
+  std::size_t Read(std::span<uint8_t> buffer, bool* closed = nullptr);
+
+  // Writes all bytes, waiting for the device to drain when its buffer is full. Throws
+  // std::runtime_error on I/O errors.
+  void WriteAll(std::span<const uint8_t> bytes);
+
+  // True while the other end of a pseudo-terminal is closed; for a master, while no process
+  // has the slave open (after it was first opened). Does not block.
+  [[nodiscard]] bool PeerClosed() const;
+
+ private:
+  void Configure();
+  void Close();
+
+  int fd_ = -1;
+  SerialSettings settings_;
+};
+
+// Master side of a freshly allocated pseudo-terminal plus the path of its slave device, which
+// can be opened like a serial port. Used to run the decoder against a local peer.
+struct PseudoTerminal {
+  SerialPort master;
+  std::string slave_path;
+};
+
+// Throws std::runtime_error if no pseudo-terminal can be allocated.
+[[nodiscard]] PseudoTerminal OpenPseudoTerminal(const SerialSettings& settings = {});
+
+// Seconds on CLOCK_MONOTONIC.
+[[nodiscard]] double MonotonicSeconds();
+
+// Delay between a frame's last byte being read and the frame reaching the callback.
+struct LatencyStats {
+  std::size_t frames = 0;
+  double total_seconds = 0.0;
+  double max_seconds = 0.0;
+
+  [[nodiscard]] double mean_seconds() const { return frames ? total_seconds / frames : 0.0; }
+};
+
+// Decodes live bus traffic. Each source is a serial port carrying one bus direction; bytes are
+// timestamped with the monotonic clock (seconds since construction), framed by a
+// FrameSequencer and delivered to the callback. Partial frames are expired once the line has
+// been idle past the gap threshold, so every frame is delivered within roughly the threshold
+// after its last byte arrives.
+class BusMonitor {
+ public:
+  // Receives the bytes read by one Poll (possibly none) and the time up to which the lines have
+  // been read, which can be passed on as an Advance.
+  using ByteBatchCallback = std::function<void(std::span<const ByteEvent> events, double now)>;
+
+  explicit BusMonitor(FrameCallback on_frame, double gap_threshold = 0.004);
+  // Only reads and timestamps bytes, leaving framing to the callback's consumer (for example a
+  // StagedPipeline). latency() stays empty in this mode.
+  explicit BusMonitor(ByteBatchCallback on_bytes, double gap_threshold = 0.004);
+
+  // The port must outlive the monitor.
+  void AddSource(SerialPort& port, BusDirection direction);
+
+  // Waits up to `timeout` for input (less if a partial frame is about to expire), reads all
+  // available bytes and delivers completed frames. Returns false once every source has closed.
+  bool Poll(std::chrono::milliseconds timeout);
+
+  // Flushes partial frames and delivers everything still queued.
+  void Finish();
+
+  [[nodiscard]] const LatencyStats& latency() const { return latency_; }
+
+ private:
+  struct Source {
+    SerialPort* port = nullptr;
+    BusDirection direction = BusDirection::Rx;
+    bool open = true;
+  };
+
+  [[nodiscard]] double Now() const { return MonotonicSeconds() - epoch_; }
+  void Deliver(Frame&& frame);
+
+  FrameCallback on_frame_;
+  ByteBatchCallback on_bytes_;
+  double gap_threshold_;
+  double epoch_;
+  double floor_time_ = 0.0;      // no byte is timestamped earlier than this
+  double last_byte_time_ = 0.0;
+  bool bytes_pending_ = false;  // bytes forwarded to on_bytes_ within the gap threshold
+  std::vector<ByteEvent> batch_;
+  FrameSequencer sequencer_;
+  std::vector<Source> sources_;
+  LatencyStats latency_;
+};
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "fujitsu/encoder.h"
+#include "fujitsu/messages.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+struct WriteQueueStats {
+  std::size_t writes = 0;     // Set calls
+  std::size_t coalesced = 0;  // Set calls that replaced a pending value for the same address
+  std::size_t frames = 0;     // frames produced by TakeFrame
+};
+
+// Pending register writes, merged before they reach the bus. Setting an address that is
+// already queued replaces its value in place, and the queue only releases writes once no new
+// value has arrived for `settle` seconds (or the oldest has waited `max_delay`), so a burst of
+// UI changes such as dragging the setpoint becomes one frame carrying the final value.
+// Several pending registers go out together in kBulkWrite frames; a lone register uses the
+// command given when it was set, matching the adapter's own traffic.
+class WriteQueue {
+ public:
+  explicit WriteQueue(double settle = 0.1, double max_delay = 0.5);
+
+  void Set(uint16_t address, uint16_t value, double now,
+           CommandId single_command = CommandId::kControlRegister);
+
+  // Time at which TakeFrame will next produce a frame, or std::nullopt if nothing is queued.
+  [[nodiscard]] std::optional<double> ReadyAt() const;
+
+  // Encodes up to kMaxWriteValues of the oldest pending writes into `out` (see FrameBuffer) and
+  // removes them from the queue. Returns the frame length, or 0 if nothing is ready at `now`.
+  std::size_t TakeFrame(double now, std::span<uint8_t> out);
+
+  [[nodiscard]] bool empty() const { return pending_.empty(); }
+  [[nodiscard]] std::size_t size() const { return pending_.size(); }
+  [[nodiscard]] const WriteQueueStats& stats() const { return stats_; }
+
+ private:
+  struct Pending {
+    RegisterValue value;
+    CommandId single_command = CommandId::kControlRegister;
+  };
+
+  double settle_;
+  double max_delay_;
+  std::vector<Pending> pending_;  // in order first queued
+  double first_queued_ = 0.0;
+  double last_changed_ = 0.0;
+  WriteQueueStats stats_;
+};
+
+}  // namespace fujitsu::airstage
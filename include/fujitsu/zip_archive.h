@@ -0,0 +1,46 @@
+#pragma once
+
+#include "fujitsu/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+// Returns true if `bytes` starts with a zip local file header.
+[[nodiscard]] bool IsZipArchive(std::span<const uint8_t> bytes);
+
+// Read-only access to the members of a memory-mapped zip archive (stored or deflated, no
+// encryption, no zip64), as written by Saleae Logic 2 for .sal captures.
+class ZipArchive {
+ public:
+  // Throws std::runtime_error if the central directory cannot be found or is malformed.
+  explicit ZipArchive(const std::filesystem::path& path);
+  explicit ZipArchive(MappedFile file);
+
+  [[nodiscard]] std::vector<std::string> names() const;
+
+  // Returns the uncompressed contents of `name`, or std::nullopt if there is no such member.
+  // Throws std::runtime_error if the member is corrupt or uses an unsupported compression.
+  [[nodiscard]] std::optional<std::vector<uint8_t>> Read(const std::string& name) const;
+
+ private:
+  struct Member {
+    std::string name;
+    uint16_t method = 0;
+    uint32_t crc = 0;
+    uint64_t compressed_size = 0;
+    uint64_t size = 0;
+    uint64_t local_header_offset = 0;
+  };
+
+  MappedFile file_;
+  std::vector<Member> members_;
+};
+
+}  // namespace fujitsu::airstage
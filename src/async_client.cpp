@@ -0,0 +1,244 @@
+#include "fujitsu/async_client.h"
+
+#include "fujitsu/packet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace fujitsu::airstage {
+
+const char* ToString(RequestOutcome outcome) {
+  switch (outcome) {
+    case RequestOutcome::kOk:
+      return "ok";
+    case RequestOutcome::kTimedOut:
+      return "timed out";
+    case RequestOutcome::kCorrupted:
+      return "corrupted";
+    case RequestOutcome::kCancelled:
+      return "cancelled";
+  }
+  return "unknown";
+}
+
+AsyncClient::AsyncClient(SendCallback send, const AsyncClientOptions& options)
+    : send_(std::move(send)), options_(options) {}
+
+AsyncClient::Request<ReadResult> AsyncClient::Read(std::span<const uint16_t> addresses,
+                                                   const RequestOptions& options) {
+  return Request<ReadResult>(this, CommandId::kReadRegisters, options,
+                             [addresses](std::span<uint8_t> out) {
+                               return EncodeReadRequest(addresses, out);
+                             });
+}
+
+AsyncClient::Request<WriteResult> AsyncClient::Write(CommandId command,
+                                                     std::span<const RegisterValue> values,
+                                                     const RequestOptions& options) {
+  if (command != CommandId::kSetpoint && command != CommandId::kControlRegister &&
+      command != CommandId::kBulkWrite) {
+    throw std::invalid_argument("not a write command: " +
+                                CommandToString(static_cast<uint32_t>(command)));
+  }
+  return Request<WriteResult>(this, command, options,
+                              [command, values](std::span<uint8_t> out) {
+                                return EncodeWriteRequest(command, values, out);
+                              });
+}
+
+void AsyncClient::Enqueue(Operation* operation, std::coroutine_handle<> waiter) {
+  operation->waiter = waiter;
+  operation->state = State::kQueued;
+  queue_.push_back(operation);
+  ++stats_.requests;
+}
+
+void AsyncClient::Forget(Operation* operation) {
+  // Only reached with the operation still pending when its coroutine is destroyed mid-await.
+  if (operation->state == State::kQueued) {
+    if (in_flight_ && queue_.front() == operation) {
+      in_flight_ = false;
+      if (!operation->retry_at) {
+        quiet_until_ = operation->sent_at + options_.response_timeout;
+      }
+    }
+    std::erase(queue_, operation);
+  } else if (operation->state == State::kReady) {
+    std::erase(ready_, operation);
+  }
+}
+
+void AsyncClient::Send(Operation* operation) {
+  ++operation->attempts;
+  operation->sent_at = now_;
+  operation->retry_at.reset();
+  in_flight_ = true;
+  ++stats_.frames_sent;
+  send_(std::span<const uint8_t>(operation->frame.data(), operation->length));
+}
+
+void AsyncClient::Complete(Operation* operation, RequestOutcome outcome) {
+  if (in_flight_ && queue_.front() == operation) {
+    in_flight_ = false;
+    // Unless the unit has already answered (if corruptly), its answer may still be coming.
+    if (outcome != RequestOutcome::kOk && !operation->retry_at) {
+      quiet_until_ = operation->sent_at + options_.response_timeout;
+    }
+  }
+  std::erase(queue_, operation);
+  operation->outcome = outcome;
+  operation->state = State::kReady;
+  ready_.push_back(operation);
+  if (outcome == RequestOutcome::kTimedOut || outcome == RequestOutcome::kCorrupted) {
+    ++stats_.failures;
+  } else if (outcome == RequestOutcome::kCancelled) {
+    ++stats_.cancelled;
+  }
+}
+
+bool AsyncClient::AcceptResponse(Operation* operation, const PacketView& packet) {
+  if (operation->command != CommandId::kReadRegisters) {
+    auto response = DecodeWriteResponse(packet);
+    if (!response) {
+      return false;
+    }
+    operation->status = response->status;
+    return true;
+  }
+  auto response = DecodeReadResponseView(packet);
+  // The request was encoded by Read, so it always parses back.
+  auto request = DecodeReadRequestView(
+      *ParsePacketView(std::span<const uint8_t>(operation->frame.data(), operation->length)));
+  if (!response || response->values.size() != request->addresses.size() ||
+      !std::equal(request->addresses.begin(), request->addresses.end(),
+                  response->values.begin(),
+                  [](uint16_t address, RegisterValue entry) { return address == entry.address; })) {
+    return false;
+  }
+  operation->status = response->status;
+  operation->values.assign(response->values.begin(), response->values.end());
+  return true;
+}
+
+void AsyncClient::Receive(const Frame& frame, double now) {
+  now_ = now;
+  if (frame.direction != BusDirection::Tx || frame.type == Frame::Type::Break) {
+    return;
+  }
+  auto packet = frame.type == Frame::Type::Packet ? ParsePacketView(frame.bytes) : std::nullopt;
+  if (!in_flight_) {
+    stats_.stray_frames += packet.has_value();
+    return;
+  }
+  Operation* operation = queue_.front();
+  if (packet && packet->command_id != static_cast<uint32_t>(operation->command)) {
+    ++stats_.stray_frames;
+    return;
+  }
+  if (packet && AcceptResponse(operation, *packet)) {
+    Complete(operation, RequestOutcome::kOk);
+    return;
+  }
+  // Re-send once the rest of the damaged answer has had time to pass.
+  if (!operation->retry_at) {
+    ++stats_.corrupt_responses;
+  }
+  operation->retry_at = now + options_.retry_delay;
+}
+
+void AsyncClient::Advance(double now) {
+  now_ = now;
+  do {
+    while (!ready_.empty()) {
+      Operation* operation = ready_.front();
+      ready_.pop_front();
+      operation->state = State::kResumed;
+      // May destroy the operation, or queue new ones.
+      operation->waiter.resume();
+    }
+
+    for (std::size_t i = 0; i < queue_.size();) {
+      Operation* operation = queue_[i];
+      if (operation->timeout && !operation->deadline) {
+        operation->deadline = now + *operation->timeout;
+      }
+      if (operation->stop.stop_requested()) {
+        Complete(operation, RequestOutcome::kCancelled);
+      } else if (operation->deadline && now >= *operation->deadline) {
+        Complete(operation, RequestOutcome::kTimedOut);
+      } else {
+        ++i;
+      }
+    }
+
+    if (in_flight_) {
+      Operation* operation = queue_.front();
+      bool corrupted = operation->retry_at.has_value();
+      if ((corrupted && now >= *operation->retry_at) ||
+          now - operation->sent_at >= options_.response_timeout) {
+        if (operation->attempts < options_.max_attempts) {
+          ++stats_.retries;
+          Send(operation);
+        } else {
+          Complete(operation,
+                   corrupted ? RequestOutcome::kCorrupted : RequestOutcome::kTimedOut);
+        }
+      }
+    }
+
+    if (!in_flight_ && !queue_.empty() && now >= quiet_until_) {
+      Send(queue_.front());
+    }
+  } while (!ready_.empty());
+}
+
+std::optional<double> AsyncClient::NextWakeup() const {
+  if (!ready_.empty()) {
+    return now_;
+  }
+  if (queue_.empty()) {
+    return std::nullopt;
+  }
+  double wakeup = std::numeric_limits<double>::infinity();
+  for (const Operation* operation : queue_) {
+    if (operation->timeout && !operation->deadline) {
+      return now_;
+    }
+    if (operation->deadline) {
+      wakeup = std::min(wakeup, *operation->deadline);
+    }
+  }
+  if (in_flight_) {
+    const Operation* operation = queue_.front();
+    wakeup = std::min(wakeup, operation->sent_at + options_.response_timeout);
+    if (operation->retry_at) {
+      wakeup = std::min(wakeup, *operation->retry_at);
+    }
+  } else {
+    wakeup = std::min(wakeup, std::max(now_, quiet_until_));
+  }
+  return wakeup;
+}
+
+void RunClientLoop(AsyncClient& client, SerialPort& port, const std::function<bool()>& done) {
+  // Longest Poll, which bounds how late a stop token is noticed.
+  constexpr double kMaxWaitSeconds = 0.05;
+
+  BusMonitor monitor([&client](Frame&& frame) { client.Receive(frame, MonotonicSeconds()); });
+  monitor.AddSource(port, BusDirection::Tx);
+  client.Advance(MonotonicSeconds());
+  while (!done()) {
+    double now = MonotonicSeconds();
+    double wait = std::clamp(client.NextWakeup().value_or(now + kMaxWaitSeconds) - now, 0.0,
+                             kMaxWaitSeconds);
+    if (!monitor.Poll(std::chrono::milliseconds(static_cast<int>(std::ceil(wait * 1000.0))))) {
+      throw std::runtime_error("serial port closed");
+    }
+    client.Advance(MonotonicSeconds());
+  }
+}
+
+}  // namespace fujitsu::airstage
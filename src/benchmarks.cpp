@@ -0,0 +1,470 @@
+#include "fujitsu/capture_reader.h"
+#include "fujitsu/checksum.h"
+#include "fujitsu/classifier.h"
+#include "fujitsu/describe.h"
+#include "fujitsu/encoder.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+#include "fujitsu/pipeline.h"
+#include "fujitsu/records.h"
+#include "fujitsu/register_db.h"
+#include "fujitsu/synthetic.h"
+#include "fujitsu/text_buffer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using fujitsu::airstage::AppendBinaryRecord;
+using fujitsu::airstage::AppendNdjsonRecord;
+using fujitsu::airstage::ChecksumBackend;
+using fujitsu::airstage::Classify;
+using fujitsu::airstage::ComputeChecksum;
+using fujitsu::airstage::DecodeReadRequest;
+using fujitsu::airstage::DecodeReadRequestView;
+using fujitsu::airstage::DecodeReadResponse;
+using fujitsu::airstage::DecodeReadResponseView;
+using fujitsu::airstage::DecodeWriteRequest;
+using fujitsu::airstage::DecodeWriteRequestView;
+using fujitsu::airstage::DecodeWriteResponse;
+using fujitsu::airstage::DescribeFrame;
+using fujitsu::airstage::EncodeBulkWrite;
+using fujitsu::airstage::EncodeReadRequest;
+using fujitsu::airstage::Frame;
+using fujitsu::airstage::FrameBuffer;
+using fujitsu::airstage::FindPacketStarts;
+using fujitsu::airstage::ByteEvent;
+using fujitsu::airstage::FrameSequencer;
+using fujitsu::airstage::GenerateTraffic;
+using fujitsu::airstage::LoadCapture;
+using fujitsu::airstage::LookupRegister;
+using fujitsu::airstage::Message;
+using fujitsu::airstage::Packet;
+using fujitsu::airstage::ParsePacket;
+using fujitsu::airstage::ParsePacketView;
+using fujitsu::airstage::PipelineOptions;
+using fujitsu::airstage::RegisterValue;
+using fujitsu::airstage::StagedPipeline;
+using fujitsu::airstage::SyntheticTrafficOptions;
+using fujitsu::airstage::TextBuffer;
+using fujitsu::airstage::ValidateFrame;
+
+namespace {
+
+constexpr uint16_t kPolledAddresses[] = {0x1000, 0x1001, 0x1003, 0x1002, 0x0130, 0x1010,
+                                         0x1011, 0x1023, 0x1022, 0x1121, 0x1108, 0x1102,
+                                         0x1101, 0x1120, 0x1100, 0x1031, 0x1109, 0x1142};
+
+// Representative frames: the adapter's usual poll and its answer, a bulk write and an ack.
+struct SampleFrames {
+  std::vector<uint8_t> read_request;
+  std::vector<uint8_t> read_response;
+  std::vector<uint8_t> bulk_write;
+  std::vector<uint8_t> write_ack;
+
+  SampleFrames() {
+    FrameBuffer buffer;
+    read_request.assign(buffer.begin(), buffer.begin() + EncodeReadRequest(kPolledAddresses, buffer));
+
+    Packet response{static_cast<uint32_t>(fujitsu::airstage::CommandId::kReadRegisters), {0x01}};
+    for (uint16_t address : kPolledAddresses) {
+      response.payload.insert(response.payload.end(),
+                              {static_cast<uint8_t>(address >> 8),
+                               static_cast<uint8_t>(address & 0xFF), 0x00, 0x01});
+    }
+    read_response = response.Serialize();
+
+    const RegisterValue writes[] = {
+        {0x5201, 0x0000}, {0x5230, 0x0003}, {0x5231, 0x0003}, {0x5233, 0x0000}, {0xF200, 0x0100}};
+    bulk_write.assign(buffer.begin(), buffer.begin() + EncodeBulkWrite(writes, buffer));
+
+    write_ack = Packet{static_cast<uint32_t>(fujitsu::airstage::CommandId::kBulkWrite), {0x01}}
+                    .Serialize();
+  }
+};
+
+const SampleFrames& Samples() {
+  static const SampleFrames samples;
+  return samples;
+}
+
+std::filesystem::path CapturesDirectory() {
+  if (const char* dir = std::getenv("FUJITSU_CAPTURES")) {
+    return dir;
+  }
+  return FUJITSU_CAPTURES_DIR;
+}
+
+void BM_ComputeChecksum(benchmark::State& state) {
+  std::vector<uint8_t> bytes(static_cast<std::size_t>(state.range(0)), 0xA5);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ComputeChecksum(bytes));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ComputeChecksum)->Arg(8)->Arg(77)->Arg(260)->Arg(4096);
+
+void BM_ComputeChecksumBackend(benchmark::State& state) {
+  auto backend = static_cast<ChecksumBackend>(state.range(0));
+  if (!fujitsu::airstage::IsSupported(backend)) {
+    state.SkipWithError("backend not supported on this CPU");
+    return;
+  }
+  state.SetLabel(fujitsu::airstage::ToString(backend));
+  std::vector<uint8_t> bytes(static_cast<std::size_t>(state.range(1)), 0xA5);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ComputeChecksum(bytes, backend));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(1));
+}
+BENCHMARK(BM_ComputeChecksumBackend)
+    ->ArgsProduct({{static_cast<int64_t>(ChecksumBackend::kScalar),
+                    static_cast<int64_t>(ChecksumBackend::kSse2),
+                    static_cast<int64_t>(ChecksumBackend::kAvx2)},
+                   {77, 260, 4096}});
+
+// Raw bytes of a noisy synthetic stream, for resynchronisation scans.
+std::vector<uint8_t> NoisyBytes(std::size_t size) {
+  SyntheticTrafficOptions options;
+  options.bytes = size;
+  options.noise = 0.01;
+  std::vector<uint8_t> bytes;
+  for (const auto& event : GenerateTraffic(options)) {
+    bytes.push_back(event.value);
+  }
+  return bytes;
+}
+
+// Checks every offset as a frame start by validating each candidate on its own.
+void BM_ScanOffsetsValidateEach(benchmark::State& state) {
+  const auto bytes = NoisyBytes(1 << 20);
+  for (auto _ : state) {
+    std::size_t found = 0;
+    for (std::size_t offset = 0; offset + 7 <= bytes.size(); ++offset) {
+      std::size_t length = 7 + bytes[offset + 4];
+      found += offset + length <= bytes.size() &&
+               ValidateFrame(std::span(bytes.data() + offset, length));
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes.size()));
+}
+BENCHMARK(BM_ScanOffsetsValidateEach)->Unit(benchmark::kMillisecond);
+
+void BM_FindPacketStarts(benchmark::State& state) {
+  const auto bytes = NoisyBytes(1 << 20);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(FindPacketStarts(bytes));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes.size()));
+}
+BENCHMARK(BM_FindPacketStarts)->Unit(benchmark::kMillisecond);
+
+void BM_ValidateFrame(benchmark::State& state) {
+  const auto& frame = Samples().read_response;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ValidateFrame(frame));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame.size()));
+}
+BENCHMARK(BM_ValidateFrame);
+
+void BM_ParsePacket(benchmark::State& state) {
+  const auto& frame = Samples().read_response;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParsePacket(frame));
+  }
+}
+BENCHMARK(BM_ParsePacket);
+
+void BM_ParsePacketView(benchmark::State& state) {
+  const auto& frame = Samples().read_response;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParsePacketView(frame));
+  }
+}
+BENCHMARK(BM_ParsePacketView);
+
+// Runs `decode` on the packet parsed from `frame`.
+template <typename Decode>
+void RunDecode(benchmark::State& state, const std::vector<uint8_t>& frame, Decode decode) {
+  Packet packet = *ParsePacket(frame);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode(packet));
+  }
+}
+
+void BM_DecodeReadRequest(benchmark::State& state) {
+  RunDecode(state, Samples().read_request, [](const Packet& p) { return DecodeReadRequest(p); });
+}
+BENCHMARK(BM_DecodeReadRequest);
+
+void BM_DecodeReadResponse(benchmark::State& state) {
+  RunDecode(state, Samples().read_response, [](const Packet& p) { return DecodeReadResponse(p); });
+}
+BENCHMARK(BM_DecodeReadResponse);
+
+void BM_DecodeWriteRequest(benchmark::State& state) {
+  RunDecode(state, Samples().bulk_write, [](const Packet& p) { return DecodeWriteRequest(p); });
+}
+BENCHMARK(BM_DecodeWriteRequest);
+
+void BM_DecodeWriteResponse(benchmark::State& state) {
+  RunDecode(state, Samples().write_ack, [](const Packet& p) { return DecodeWriteResponse(p); });
+}
+BENCHMARK(BM_DecodeWriteResponse);
+
+void BM_DecodeReadRequestView(benchmark::State& state) {
+  RunDecode(state, Samples().read_request,
+            [](const Packet& p) { return DecodeReadRequestView(p.view()); });
+}
+BENCHMARK(BM_DecodeReadRequestView);
+
+void BM_DecodeReadResponseView(benchmark::State& state) {
+  RunDecode(state, Samples().read_response, [](const Packet& p) {
+    // Iterate so the lazily decoded values are actually read.
+    uint32_t sum = 0;
+    auto response = DecodeReadResponseView(p.view());
+    if (response) {
+      for (const auto entry : response->values) {
+        sum += entry.value;
+      }
+    }
+    return sum;
+  });
+}
+BENCHMARK(BM_DecodeReadResponseView);
+
+void BM_DecodeWriteRequestView(benchmark::State& state) {
+  RunDecode(state, Samples().bulk_write,
+            [](const Packet& p) { return DecodeWriteRequestView(p.view()); });
+}
+BENCHMARK(BM_DecodeWriteRequestView);
+
+void BM_Classify(benchmark::State& state) {
+  Frame frame;
+  frame.type = Frame::Type::Packet;
+  frame.direction = fujitsu::airstage::BusDirection::Tx;
+  frame.bytes = Samples().read_response;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Classify(frame));
+  }
+}
+BENCHMARK(BM_Classify);
+
+void BM_LookupRegister(benchmark::State& state) {
+  uint16_t address = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LookupRegister(kPolledAddresses[address++ % std::size(kPolledAddresses)]));
+  }
+}
+BENCHMARK(BM_LookupRegister);
+
+void BM_DescribeFrame(benchmark::State& state) {
+  Frame frame;
+  frame.type = Frame::Type::Packet;
+  frame.direction = fujitsu::airstage::BusDirection::Tx;
+  frame.start_time = 12.345678;
+  frame.bytes = Samples().read_response;
+  std::ostringstream out;
+  for (auto _ : state) {
+    out.str({});
+    DescribeFrame(frame, out);
+    benchmark::DoNotOptimize(out.tellp());
+  }
+}
+BENCHMARK(BM_DescribeFrame);
+
+void BM_DescribeFrameBuffer(benchmark::State& state) {
+  Frame frame;
+  frame.type = Frame::Type::Packet;
+  frame.direction = fujitsu::airstage::BusDirection::Tx;
+  frame.start_time = 12.345678;
+  frame.bytes = Samples().read_response;
+  TextBuffer out;
+  for (auto _ : state) {
+    out.clear();
+    DescribeFrame(frame, out);
+    benchmark::DoNotOptimize(out.size());
+  }
+}
+BENCHMARK(BM_DescribeFrameBuffer);
+
+void BM_NdjsonRecord(benchmark::State& state) {
+  Frame frame;
+  frame.type = Frame::Type::Packet;
+  frame.direction = fujitsu::airstage::BusDirection::Tx;
+  frame.start_time = 12.345678;
+  frame.bytes = Samples().read_response;
+  fujitsu::airstage::Transaction transaction{3, 12.3, 12.345678, 0.02};
+  TextBuffer out;
+  for (auto _ : state) {
+    out.clear();
+    AppendNdjsonRecord(frame, &transaction, out);
+    benchmark::DoNotOptimize(out.size());
+  }
+}
+BENCHMARK(BM_NdjsonRecord);
+
+void BM_BinaryRecord(benchmark::State& state) {
+  Frame frame;
+  frame.type = Frame::Type::Packet;
+  frame.direction = fujitsu::airstage::BusDirection::Tx;
+  frame.start_time = 12.345678;
+  frame.bytes = Samples().read_response;
+  fujitsu::airstage::Transaction transaction{3, 12.3, 12.345678, 0.02};
+  std::vector<uint8_t> out;
+  for (auto _ : state) {
+    out.clear();
+    AppendBinaryRecord(frame, &transaction, out);
+    benchmark::DoNotOptimize(out.data());
+  }
+}
+BENCHMARK(BM_BinaryRecord);
+
+void BM_LoadCapture(benchmark::State& state, const std::filesystem::path& path) {
+  std::size_t bytes = std::filesystem::file_size(path);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LoadCapture(path));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+
+// Frames a synthetic stream of state.range(0) bytes with state.range(1) per mille of the bytes
+// corrupted.
+void BM_FrameSynthetic(benchmark::State& state) {
+  SyntheticTrafficOptions options;
+  options.bytes = static_cast<std::size_t>(state.range(0));
+  options.noise = static_cast<double>(state.range(1)) / 1000.0;
+  const auto events = GenerateTraffic(options);
+  std::size_t frames = 0;
+  for (auto _ : state) {
+    FrameSequencer sequencer([&frames](Frame&&) { ++frames; });
+    for (const auto& event : events) {
+      sequencer.Push(event);
+    }
+    sequencer.Finish();
+  }
+  benchmark::DoNotOptimize(frames);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+}
+BENCHMARK(BM_FrameSynthetic)
+    ->Args({4 << 20, 0})
+    ->Args({4 << 20, 10})
+    ->Args({4 << 20, 50})
+    ->Unit(benchmark::kMillisecond);
+
+// Frames, validates and classifies a clean synthetic stream on one thread: the work the staged
+// pipeline spreads across three.
+void BM_FrameAndDecodeSynthetic(benchmark::State& state) {
+  SyntheticTrafficOptions options;
+  options.bytes = 4 << 20;
+  const auto events = GenerateTraffic(options);
+  std::size_t messages = 0;
+  for (auto _ : state) {
+    FrameSequencer sequencer([&messages](Frame&& frame) {
+      if (frame.type != Frame::Type::Packet) {
+        return;
+      }
+      if (auto packet = ParsePacketView(frame.bytes)) {
+        benchmark::DoNotOptimize(Classify(*packet, frame.direction));
+        ++messages;
+      }
+    });
+    for (const auto& event : events) {
+      sequencer.Push(event);
+    }
+    sequencer.Finish();
+  }
+  benchmark::DoNotOptimize(messages);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+}
+BENCHMARK(BM_FrameAndDecodeSynthetic)->Unit(benchmark::kMillisecond);
+
+// Pushes the same stream through a StagedPipeline in reads of state.range(0) bytes, as a
+// serial port would deliver them, with each stage taking up to state.range(1) entries at once.
+// The full_waits counters show which queue backed up.
+void BM_StagedPipeline(benchmark::State& state) {
+  SyntheticTrafficOptions traffic;
+  traffic.bytes = 4 << 20;
+  const auto events = GenerateTraffic(traffic);
+  const auto read_size = static_cast<std::size_t>(state.range(0));
+  PipelineOptions options;
+  options.batch_size = static_cast<std::size_t>(state.range(1));
+  double byte_waits = 0.0;
+  double frame_waits = 0.0;
+  std::size_t messages = 0;
+  for (auto _ : state) {
+    StagedPipeline pipeline(
+        [&messages](const Frame&, const std::optional<Message>& message) {
+          messages += message.has_value();
+        },
+        options);
+    std::span<const ByteEvent> remaining(events);
+    while (!remaining.empty()) {
+      std::size_t count = std::min(read_size, remaining.size());
+      pipeline.Push(remaining.first(count));
+      remaining = remaining.subspan(count);
+    }
+    pipeline.Finish();
+    byte_waits += static_cast<double>(pipeline.stats().bytes.full_waits);
+    frame_waits += static_cast<double>(pipeline.stats().frames.full_waits);
+  }
+  benchmark::DoNotOptimize(messages);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+  state.counters["byte_full_waits"] =
+      benchmark::Counter(byte_waits, benchmark::Counter::kAvgIterations);
+  state.counters["frame_full_waits"] =
+      benchmark::Counter(frame_waits, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_StagedPipeline)
+    ->ArgsProduct({{1, 64, 4096}, {16, 256}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+// Results are reported as JSON unless another --benchmark_format is requested, so runs can be
+// archived and compared across releases.
+int main(int argc, char** argv) {
+  std::vector<char*> args(argv, argv + argc);
+  std::string json_format = "--benchmark_format=json";
+  bool has_format = false;
+  for (int i = 1; i < argc; ++i) {
+    has_format = has_format || std::string(argv[i]).starts_with("--benchmark_format");
+  }
+  if (!has_format) {
+    args.push_back(json_format.data());
+  }
+  int count = static_cast<int>(args.size());
+
+  std::vector<std::filesystem::path> captures;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(CapturesDirectory(), error)) {
+    // Raw .sal captures measure the software UART decode against their CSV exports.
+    if (entry.path().extension() == ".csv" || entry.path().extension() == ".sal") {
+      captures.push_back(entry.path());
+    }
+  }
+  std::sort(captures.begin(), captures.end());
+  for (const auto& path : captures) {
+    benchmark::RegisterBenchmark(("BM_LoadCapture/" + path.filename().string()).c_str(),
+                                 BM_LoadCapture, path)
+        ->Unit(benchmark::kMillisecond);
+  }
+
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,191 @@
+#include "fujitsu/binary_capture.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+// LEB128 encodes 64-bit values in at most ten bytes.
+constexpr std::size_t kMaxVarintBytes = 10;
+
+template <typename T>
+void PutLittleEndian(uint8_t* out, T value) {
+  auto bits = static_cast<uint64_t>(value);
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    out[i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+}
+
+template <typename T>
+T GetLittleEndian(const uint8_t* in) {
+  uint64_t bits = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    bits |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return static_cast<T>(bits);
+}
+
+void PutVarint(std::vector<uint8_t>* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+// Caller guarantees a complete varint is available (checked when the capture is opened).
+uint64_t GetVarint(const uint8_t** pos) {
+  uint64_t value = 0;
+  unsigned shift = 0;
+  const uint8_t* p = *pos;
+  while (*p & 0x80) {
+    value |= static_cast<uint64_t>(*p & 0x7F) << shift;
+    shift += 7;
+    ++p;
+  }
+  value |= static_cast<uint64_t>(*p) << shift;
+  *pos = p + 1;
+  return value;
+}
+
+int64_t ToTicks(double time) {
+  return std::llround(time * static_cast<double>(kBinaryCaptureTicksPerSecond));
+}
+
+void SetBit(std::vector<uint8_t>* bits, std::size_t index, bool value) {
+  if (index % 8 == 0) {
+    bits->push_back(0);
+  }
+  if (value) {
+    bits->back() = static_cast<uint8_t>(bits->back() | (1u << (index % 8)));
+  }
+}
+
+bool GetBit(std::span<const uint8_t> bits, std::size_t index) {
+  return (bits[index / 8] >> (index % 8)) & 1u;
+}
+
+std::runtime_error Malformed(const char* what) {
+  return std::runtime_error(std::string("malformed binary capture: ") + what);
+}
+
+}  // namespace
+
+bool IsBinaryCapture(std::span<const uint8_t> bytes) {
+  return bytes.size() >= sizeof(kBinaryCaptureMagic) &&
+         std::memcmp(bytes.data(), kBinaryCaptureMagic, sizeof(kBinaryCaptureMagic)) == 0;
+}
+
+void BinaryCaptureWriter::Append(const ByteEvent& event) {
+  int64_t tick = ToTicks(event.time);
+  std::size_t index = values_.size();
+  if (index == 0) {
+    first_tick_ = tick;
+    last_tick_ = tick;
+  }
+  if (tick < last_tick_) {
+    throw std::runtime_error("binary capture events must be appended in time order");
+  }
+
+  values_.push_back(event.value);
+  SetBit(&directions_, index, event.direction == BusDirection::Tx);
+  SetBit(&errors_, index, event.has_error);
+  PutVarint(&deltas_, static_cast<uint64_t>(tick - last_tick_));
+  last_tick_ = tick;
+}
+
+void BinaryCaptureWriter::Write(const std::filesystem::path& path) const {
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  if (!output.is_open()) {
+    throw std::runtime_error("failed to create binary capture: " + path.string());
+  }
+
+  uint8_t header[kBinaryCaptureHeaderBytes] = {};
+  std::memcpy(header, kBinaryCaptureMagic, sizeof(kBinaryCaptureMagic));
+  PutLittleEndian<uint16_t>(header + 4, kBinaryCaptureVersion);
+  PutLittleEndian<uint64_t>(header + 8, values_.size());
+  PutLittleEndian<uint64_t>(header + 16, kBinaryCaptureTicksPerSecond);
+  PutLittleEndian<int64_t>(header + 24, first_tick_);
+
+  auto write = [&output](const uint8_t* data, std::size_t size) {
+    output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+  };
+  write(header, sizeof(header));
+  write(values_.data(), values_.size());
+  write(directions_.data(), directions_.size());
+  write(errors_.data(), errors_.size());
+  write(deltas_.data(), deltas_.size());
+
+  output.flush();
+  if (!output) {
+    throw std::runtime_error("failed to write binary capture: " + path.string());
+  }
+}
+
+BinaryCapture::BinaryCapture(const std::filesystem::path& path) : BinaryCapture(MappedFile(path)) {}
+
+BinaryCapture::BinaryCapture(MappedFile file) : file_(std::move(file)) {
+  std::span<const uint8_t> bytes = file_.bytes();
+  if (bytes.size() < kBinaryCaptureHeaderBytes || !IsBinaryCapture(bytes)) {
+    throw Malformed("missing header");
+  }
+  if (GetLittleEndian<uint16_t>(bytes.data() + 4) != kBinaryCaptureVersion) {
+    throw Malformed("unsupported version");
+  }
+  event_count_ = GetLittleEndian<uint64_t>(bytes.data() + 8);
+  uint64_t ticks_per_second = GetLittleEndian<uint64_t>(bytes.data() + 16);
+  if (ticks_per_second == 0) {
+    throw Malformed("zero tick rate");
+  }
+  ticks_per_second_ = static_cast<double>(ticks_per_second);
+  first_tick_ = GetLittleEndian<int64_t>(bytes.data() + 24);
+
+  std::span<const uint8_t> rest = bytes.subspan(kBinaryCaptureHeaderBytes);
+  uint64_t bitset_bytes = (event_count_ + 7) / 8;
+  if (event_count_ > rest.size() || event_count_ + 2 * bitset_bytes > rest.size()) {
+    throw Malformed("truncated columns");
+  }
+  values_ = rest.first(event_count_);
+  directions_ = rest.subspan(event_count_, bitset_bytes);
+  errors_ = rest.subspan(event_count_ + bitset_bytes, bitset_bytes);
+  deltas_ = rest.subspan(event_count_ + 2 * bitset_bytes);
+
+  // Every delta must be a complete varint so the cursor can decode without bounds checks.
+  std::size_t pos = 0;
+  for (uint64_t i = 0; i < event_count_; ++i) {
+    std::size_t length = 1;
+    while (pos + length <= deltas_.size() && (deltas_[pos + length - 1] & 0x80) != 0) {
+      if (++length > kMaxVarintBytes) {
+        throw Malformed("oversized time delta");
+      }
+    }
+    if (pos + length > deltas_.size()) {
+      throw Malformed("truncated time deltas");
+    }
+    pos += length;
+  }
+}
+
+BinaryCapture::Cursor::Cursor(const BinaryCapture& capture)
+    : capture_(&capture), delta_pos_(capture.deltas_.data()), tick_(capture.first_tick_) {}
+
+bool BinaryCapture::Cursor::Next(ByteEvent* event) {
+  if (index_ >= capture_->event_count_) {
+    return false;
+  }
+  tick_ += static_cast<int64_t>(GetVarint(&delta_pos_));
+  event->time = static_cast<double>(tick_) / capture_->ticks_per_second_;
+  event->value = capture_->values_[index_];
+  event->direction = GetBit(capture_->directions_, index_) ? BusDirection::Tx : BusDirection::Rx;
+  event->has_error = GetBit(capture_->errors_, index_);
+  ++index_;
+  return true;
+}
+
+}  // namespace fujitsu::airstage
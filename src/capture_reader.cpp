@@ -1,240 +1,503 @@
 #include "fujitsu/capture_reader.h"
 
+#include "fujitsu/binary_capture.h"
+#include "fujitsu/logic_capture.h"
+#include "fujitsu/mapped_file.h"
+#include "fujitsu/metrics.h"
 #include "fujitsu/packet.h"
+#include "fujitsu/zip_archive.h"
 
 #include <algorithm>
 #include <array>
-#include <cctype>
-#include <fstream>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <iterator>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace fujitsu::airstage {
 
 namespace {
 
-struct CsvByte {
-  BusDirection direction = BusDirection::Rx;
-  double time = 0.0;
-  uint8_t value = 0;
-  bool has_error = false;
+// Rows held back to absorb out-of-order CSV exports: at least this many, and they are released
+// in batches of this many.
+constexpr std::size_t kReorderWindow = 4096;
+
+int DirectionIndex(BusDirection dir) {
+  return dir == BusDirection::Rx ? 0 : 1;
+}
+
+// Saleae exports have five or six columns; anything past this is ignored.
+constexpr std::size_t kMaxCsvFields = 16;
+
+using CsvFields = std::array<std::string_view, kMaxCsvFields>;
+
+// Column positions, detected from the header line. The defaults match the Saleae async serial
+// export (`name,type,start_time,duration,"data"[,error]`).
+struct CsvColumns {
+  std::size_t name = 0;
+  std::size_t type = 1;
+  std::size_t time = 2;
+  std::size_t data = 4;
+  std::size_t error = 5;
+
+  [[nodiscard]] std::size_t required() const { return std::max({name, type, time, data}) + 1; }
 };
 
-struct PendingBuffer {
-  std::vector<CsvByte> bytes;
-  std::optional<double> last_time;
+// Records are split by a tokenizer that classifies the buffer 64 bytes at a time into bitmasks
+// of the structural characters, so each byte is looked at once however rows straddle blocks.
+// Quoted regions are masked out with a prefix XOR over the quote bits, carried from one block
+// to the next, so delimiters inside quotes are ignored.
+constexpr std::size_t kBlockBytes = 64;
+
+struct StructuralMasks {
+  uint64_t delimiters = 0;  // ',' and '\n'
+  uint64_t quotes = 0;
 };
 
-int DirectionIndex(BusDirection dir) {
-  return dir == BusDirection::Rx ? 0 : 1;
+StructuralMasks ScanBlock(const char* pos) {
+  StructuralMasks masks;
+#if defined(__SSE2__)
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i quote = _mm_set1_epi8('"');
+  for (std::size_t i = 0; i < kBlockBytes; i += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + i));
+    __m128i delimiters =
+        _mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline));
+    auto delimiter_bits =
+        static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(delimiters)));
+    auto quote_bits = static_cast<uint64_t>(
+        static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, quote))));
+    masks.delimiters |= delimiter_bits << i;
+    masks.quotes |= quote_bits << i;
+  }
+#else
+  for (std::size_t i = 0; i < kBlockBytes; ++i) {
+    uint64_t bit = uint64_t{1} << i;
+    masks.delimiters |= (pos[i] == '\n' || pos[i] == ',') ? bit : 0;
+    masks.quotes |= pos[i] == '"' ? bit : 0;
+  }
+#endif
+  return masks;
 }
 
-bool SplitCsvLine(const std::string& line, std::vector<std::string>* fields) {
-  fields->clear();
-  std::string field;
-  bool in_quotes = false;
-  for (std::size_t i = 0; i < line.size(); ++i) {
-    char ch = line[i];
-    if (in_quotes) {
-      if (ch == '"') {
-        if (i + 1 < line.size() && line[i + 1] == '"') {
-          field.push_back('"');
-          ++i;
-        } else {
-          in_quotes = false;
+std::string_view TrimField(const char* begin, const char* end) {
+  if (end != begin && end[-1] == '\r') {
+    --end;
+  }
+  if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+    ++begin;
+    --end;
+  }
+  return std::string_view(begin, end - begin);
+}
+
+// Splits CSV records in place. Surrounding quotes are stripped; escaped quotes inside a field
+// are left doubled, which never occurs in the columns we interpret.
+class CsvTokenizer {
+ public:
+  CsvTokenizer(const char* begin, const char* end) : block_(begin), end_(end), record_(begin) {
+    if (begin != end) {
+      delimiters_ = Scan();
+    }
+  }
+
+  [[nodiscard]] bool done() const { return record_ == end_; }
+
+  // Splits the next record and moves past its line ending. At most `max_fields` fields are
+  // stored; the rest of the line is skipped. Returns the number of fields stored.
+  std::size_t Next(CsvFields* fields, std::size_t max_fields = kMaxCsvFields) {
+    const char* field_begin = record_;
+    std::size_t count = 0;
+    uint64_t delimiters = delimiters_;
+    for (;;) {
+      while (delimiters == 0) {
+        if (static_cast<std::size_t>(end_ - block_) <= kBlockBytes) {
+          // The last record has no line ending.
+          if (count < max_fields) {
+            (*fields)[count++] = TrimField(field_begin, end_);
+          }
+          record_ = end_;
+          delimiters_ = 0;
+          return count;
         }
-      } else {
-        field.push_back(ch);
+        block_ += kBlockBytes;
+        delimiters = Scan();
       }
+      const char* delimiter = block_ + std::countr_zero(delimiters);
+      delimiters &= delimiters - 1;
+      if (count < max_fields) {
+        (*fields)[count++] = TrimField(field_begin, delimiter);
+      }
+      field_begin = delimiter + 1;
+      if (*delimiter == '\n') {
+        record_ = field_begin;
+        delimiters_ = delimiters;
+        return count;
+      }
+    }
+  }
+
+ private:
+  // Returns the delimiters of the block at `block_`; the last, partial block is scanned from a
+  // padded copy.
+  uint64_t Scan() {
+    StructuralMasks masks;
+    auto available = static_cast<std::size_t>(end_ - block_);
+    if (available >= kBlockBytes) {
+      masks = ScanBlock(block_);
     } else {
-      if (ch == '"') {
-        in_quotes = true;
-      } else if (ch == ',') {
-        fields->push_back(field);
-        field.clear();
-      } else {
-        field.push_back(ch);
+      std::array<char, kBlockBytes> padded{};
+      std::memcpy(padded.data(), block_, available);
+      masks = ScanBlock(padded.data());
+    }
+    if ((masks.quotes | quoted_) != 0) {
+      // Bits set inside a quoted region: the prefix XOR of the quote positions.
+      uint64_t inside = masks.quotes;
+      for (unsigned shift = 1; shift < 64; shift <<= 1) {
+        inside ^= inside << shift;
       }
+      inside ^= quoted_;
+      quoted_ = uint64_t{0} - (inside >> 63);
+      masks.delimiters &= ~inside;
     }
+    return masks.delimiters;
   }
-  fields->push_back(field);
-  return true;
+
+  const char* block_;  // start of the block the delimiters are taken from
+  const char* end_;
+  const char* record_;       // start of the next record
+  uint64_t delimiters_ = 0;  // delimiters in the block not consumed yet
+  uint64_t quoted_ = 0;      // all ones if the previous block ended inside quotes
+};
+
+CsvColumns DetectColumns(CsvTokenizer* tokenizer) {
+  CsvFields fields;
+  std::size_t count = tokenizer->Next(&fields);
+
+  CsvColumns columns;
+  auto find = [&](std::string_view name, std::size_t fallback) {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (fields[i] == name) {
+        return i;
+      }
+    }
+    return fallback;
+  };
+  columns.name = find("name", columns.name);
+  columns.type = find("type", columns.type);
+  columns.time = find("start_time", columns.time);
+  columns.data = find("data", columns.data);
+  // Without an explicit error column, errors show up as an extra trailing field.
+  columns.error = find("error", std::max(count, columns.required()));
+  return columns;
+}
+
+// Exact powers of ten representable as doubles; dividing an exactly representable mantissa by
+// one of these yields the correctly rounded result (Clinger's fast path).
+constexpr double kExactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+std::optional<double> ParseTime(std::string_view token) {
+  // Fast path for the plain `123.456789` timestamps Saleae writes.
+  const char* pos = token.data();
+  const char* end = pos + token.size();
+  uint64_t mantissa = 0;
+  const char* integer_begin = pos;
+  while (pos != end && static_cast<unsigned>(*pos - '0') < 10) {
+    mantissa = mantissa * 10 + static_cast<unsigned>(*pos - '0');
+    ++pos;
+  }
+  std::size_t digits = static_cast<std::size_t>(pos - integer_begin);
+  std::size_t fraction_digits = 0;
+  if (pos != end && *pos == '.') {
+    const char* fraction_begin = ++pos;
+    while (pos != end && static_cast<unsigned>(*pos - '0') < 10) {
+      mantissa = mantissa * 10 + static_cast<unsigned>(*pos - '0');
+      ++pos;
+    }
+    fraction_digits = static_cast<std::size_t>(pos - fraction_begin);
+    digits += fraction_digits;
+  }
+  if (pos == end && digits > 0 && digits <= 15 && fraction_digits < std::size(kExactPowersOfTen)) {
+    return static_cast<double>(mantissa) / kExactPowersOfTen[fraction_digits];
+  }
+
+  double value = 0.0;
+  auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+  if (ec != std::errc() || ptr != token.data() + token.size()) {
+    return std::nullopt;
+  }
+  return value;
 }
 
-uint8_t ParseByteValue(const std::string& token) {
-  std::size_t idx = 0;
+constexpr auto kHexDigitValues = [] {
+  std::array<int8_t, 256> table{};
+  table.fill(-1);
+  for (int i = 0; i < 10; ++i) {
+    table['0' + i] = static_cast<int8_t>(i);
+  }
+  for (int i = 0; i < 6; ++i) {
+    table['a' + i] = static_cast<int8_t>(10 + i);
+    table['A' + i] = static_cast<int8_t>(10 + i);
+  }
+  return table;
+}();
+
+std::optional<uint8_t> ParseByteValue(std::string_view token) {
   int base = 10;
   if (token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X')) {
-    idx = 2;
+    token.remove_prefix(2);
     base = 16;
+    if (token.size() == 2) {
+      int high = kHexDigitValues[static_cast<unsigned char>(token[0])];
+      int low = kHexDigitValues[static_cast<unsigned char>(token[1])];
+      if ((high | low) >= 0) {
+        return static_cast<uint8_t>(high << 4 | low);
+      }
+    }
+  }
+  unsigned value = 0;
+  auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value, base);
+  if (ec != std::errc() || ptr != token.data() + token.size()) {
+    return std::nullopt;
   }
-  return static_cast<uint8_t>(std::stoul(token.substr(idx), nullptr, base));
+  return static_cast<uint8_t>(value);
 }
 
-void EmitRawFrame(const PendingBuffer& buffer, BusDirection dir, std::size_t start, std::size_t end,
-                  std::vector<Frame>* out) {
-  if (start >= end) {
+std::runtime_error MalformedRow(const std::filesystem::path& path, std::size_t line_number,
+                                const char* what) {
+  return std::runtime_error(path.string() + ":" + std::to_string(line_number) + ": " + what);
+}
+
+bool FrameAfter(const Frame& a, uint64_t a_seq, const Frame& b, uint64_t b_seq) {
+  if (a.start_time != b.start_time) {
+    return a.start_time > b.start_time;
+  }
+  return a_seq > b_seq;
+}
+
+// Templated on the callback so that the per-row call inlines where the caller wraps it.
+template <typename OnEvent>
+void ReadCsvEvents(const std::filesystem::path& path, const MappedFile& file,
+                   const OnEvent& on_event) {
+  CsvTokenizer tokenizer(file.text().data(), file.text().data() + file.size());
+  if (tokenizer.done()) {
     return;
   }
-  Frame frame;
-  frame.type = Frame::Type::Raw;
-  frame.direction = dir;
-  frame.start_time = buffer.bytes[start].time;
-  frame.bytes.reserve(end - start);
-  for (std::size_t i = start; i < end; ++i) {
-    frame.bytes.push_back(buffer.bytes[i].value);
-  }
-  out->push_back(std::move(frame));
-}
-
-void EmitBreakFrame(const PendingBuffer& buffer, BusDirection dir, std::size_t start,
-                    std::vector<Frame>* out) {
-  Frame frame;
-  frame.type = Frame::Type::Break;
-  frame.direction = dir;
-  frame.start_time = buffer.bytes[start].time;
-  frame.bytes = {0xFF, 0xFF, 0x00, 0x00};
-  out->push_back(std::move(frame));
-}
-
-void EmitPacketFrame(const PendingBuffer& buffer, BusDirection dir, std::size_t start, std::size_t length,
-                     std::vector<Frame>* out) {
-  Frame frame;
-  frame.type = Frame::Type::Packet;
-  frame.direction = dir;
-  frame.start_time = buffer.bytes[start].time;
-  frame.bytes.reserve(length);
-  for (std::size_t i = 0; i < length; ++i) {
-    frame.bytes.push_back(buffer.bytes[start + i].value);
-  }
-  out->push_back(std::move(frame));
-}
-
-void ParseAvailable(PendingBuffer& buffer, BusDirection dir, std::vector<Frame>* out,
-                    bool final_flush = false) {
-  while (!buffer.bytes.empty()) {
-    // Break frame detection
-    if (buffer.bytes.size() >= 4 && buffer.bytes[0].value == 0xFF &&
-        buffer.bytes[1].value == 0xFF && buffer.bytes[2].value == 0x00 &&
-        buffer.bytes[3].value == 0x00) {
-      EmitBreakFrame(buffer, dir, 0, out);
-      buffer.bytes.erase(buffer.bytes.begin(), buffer.bytes.begin() + 4);
+
+  const CsvColumns columns = DetectColumns(&tokenizer);
+  const std::size_t required_fields = columns.required();
+  const std::size_t max_fields = std::min(std::max(required_fields, columns.error + 1), kMaxCsvFields);
+
+  // Rows waiting in the reorder window, kept sorted by time (stable for equal timestamps).
+  std::vector<ByteEvent> window;
+  window.reserve(2 * kReorderWindow);
+  CsvFields fields;
+  std::size_t line_number = 1;
+
+  while (!tokenizer.done()) {
+    ++line_number;
+    std::size_t count = tokenizer.Next(&fields, max_fields);
+    if (count < required_fields) {
+      // Also skips blank lines, which split into a single empty field.
       continue;
     }
 
-    if (buffer.bytes.size() < kPacketHeaderBytes) {
-      if (final_flush) {
-        EmitRawFrame(buffer, dir, 0, buffer.bytes.size(), out);
-        buffer.bytes.clear();
-      }
-      break;
+    if (fields[columns.type] != "data") {
+      continue;
     }
 
-    uint8_t payload_length = buffer.bytes[4].value;
-    std::size_t total_length = kPacketHeaderBytes + payload_length + kPacketTrailerBytes;
-    if (buffer.bytes.size() < total_length) {
-      if (final_flush) {
-        EmitRawFrame(buffer, dir, 0, buffer.bytes.size(), out);
-        buffer.bytes.clear();
-      }
-      break;
+    BusDirection direction = (fields[columns.name] == "RX") ? BusDirection::Rx : BusDirection::Tx;
+
+    auto time = ParseTime(fields[columns.time]);
+    if (!time) {
+      throw MalformedRow(path, line_number, "malformed start_time");
+    }
+    auto value = ParseByteValue(fields[columns.data]);
+    if (!value) {
+      throw MalformedRow(path, line_number, "malformed data byte");
     }
+    bool has_error = count > columns.error && !fields[columns.error].empty();
 
-    std::vector<uint8_t> candidate(total_length);
-    for (std::size_t i = 0; i < total_length; ++i) {
-      candidate[i] = buffer.bytes[i].value;
+    ByteEvent event{direction, *time, *value, has_error};
+    if (window.empty() || window.back().time <= event.time) {
+      window.push_back(event);
+    } else {
+      auto pos = std::upper_bound(window.begin(), window.end(), event.time,
+                                  [](double t, const ByteEvent& e) { return t < e.time; });
+      window.insert(pos, event);
     }
 
-    if (!ValidateFrame(candidate)) {
-      // Unable to decode a packet at the buffer head. Emit the first byte as raw and retry.
-      EmitRawFrame(buffer, dir, 0, 1, out);
-      buffer.bytes.erase(buffer.bytes.begin());
-      continue;
+    if (window.size() == 2 * kReorderWindow) {
+      auto released = window.begin() + kReorderWindow;
+      std::for_each(window.begin(), released, on_event);
+      window.erase(window.begin(), released);
     }
+  }
 
-    EmitPacketFrame(buffer, dir, 0, total_length, out);
-    buffer.bytes.erase(buffer.bytes.begin(), buffer.bytes.begin() + total_length);
+  for (const auto& event : window) {
+    on_event(event);
   }
 }
 
-}  // namespace
-
-FrameSet LoadCapture(const std::filesystem::path& path, double gap_threshold) {
-  std::ifstream input(path);
-  if (!input.is_open()) {
-    throw std::runtime_error("failed to open capture file: " + path.string());
+template <typename OnEvent>
+void ReadEvents(const std::filesystem::path& path, MappedFile file, const OnEvent& on_event) {
+  if (IsBinaryCapture(file.bytes())) {
+    BinaryCapture capture(std::move(file));
+    BinaryCapture::Cursor cursor = capture.cursor();
+    ByteEvent event;
+    while (cursor.Next(&event)) {
+      on_event(event);
+    }
+    return;
   }
-
-  std::string line;
-  if (!std::getline(input, line)) {
-    return {};
+  if (IsZipArchive(file.bytes())) {
+    ReadSaleaeEvents(std::move(file), on_event);
+    return;
   }
+  ReadCsvEvents(path, file, on_event);
+}
 
-  std::vector<CsvByte> events;
-  std::vector<std::string> fields;
+}  // namespace
 
-  while (std::getline(input, line)) {
-    if (line.empty()) {
-      continue;
-    }
-    SplitCsvLine(line, &fields);
-    if (fields.size() < 5) {
-      continue;
-    }
+FrameSequencer::FrameSequencer(FrameCallback on_frame, double gap_threshold)
+    : on_frame_(std::move(on_frame)),
+      framers_{Framer(BusDirection::Rx, [this](Frame&& frame) { Enqueue(std::move(frame)); },
+                      gap_threshold),
+               Framer(BusDirection::Tx, [this](Frame&& frame) { Enqueue(std::move(frame)); },
+                      gap_threshold)} {}
 
-    std::string name = fields[0];
-    if (name == "RX" || name == "\"RX\"") {
-      name = "RX";
-    } else if (name == "TX" || name == "\"TX\"") {
-      name = "TX";
-    }
+void FrameSequencer::Push(const ByteEvent& event) {
+  framers_[DirectionIndex(event.direction)].Push(event.value, event.time);
+  ReleaseUpTo(event.time);
+}
 
-    BusDirection direction = (name == "RX") ? BusDirection::Rx : BusDirection::Tx;
+void FrameSequencer::Advance(double now) {
+  for (auto& framer : framers_) {
+    framer.Expire(now);
+  }
+  ReleaseUpTo(now);
+}
 
-    if (fields[1] != "data" && fields[1] != "\"data\"") {
-      continue;
+std::optional<double> FrameSequencer::pending_since() const {
+  std::optional<double> oldest;
+  for (const auto& framer : framers_) {
+    if (auto since = framer.pending_since()) {
+      oldest = oldest ? std::min(*oldest, *since) : *since;
     }
+  }
+  return oldest;
+}
 
-    double time = std::stod(fields[2]);
-    uint8_t value = ParseByteValue(fields[4]);
-    bool has_error = fields.size() > 5 && !fields[5].empty();
-
-    events.push_back(CsvByte{direction, time, value, has_error});
+void FrameSequencer::ReleaseUpTo(double now) {
+  if (ready_.empty()) {
+    return;
+  }
+  // Any frame produced from here on starts at or after `now`, or at the oldest byte still
+  // pending in either direction.
+  double watermark = now;
+  if (auto since = pending_since()) {
+    watermark = std::min(watermark, *since);
   }
+  Release(watermark);
+}
 
-  std::stable_sort(events.begin(), events.end(),
-                   [](const CsvByte& a, const CsvByte& b) { return a.time < b.time; });
+void FrameSequencer::Finish() {
+  for (auto& framer : framers_) {
+    framer.Flush();
+  }
+  Release(std::nullopt);
+}
 
-  std::array<PendingBuffer, 2> buffers;
-  FrameSet result;
+void FrameSequencer::Enqueue(Frame&& frame) {
+  ready_.push_back(QueuedFrame{std::move(frame), next_sequence_++});
+  std::push_heap(ready_.begin(), ready_.end(), [](const QueuedFrame& a, const QueuedFrame& b) {
+    return FrameAfter(a.frame, a.sequence, b.frame, b.sequence);
+  });
+}
 
-  for (const auto& event : events) {
-    PendingBuffer& buffer = buffers[DirectionIndex(event.direction)];
-    if (buffer.last_time.has_value()) {
-      double delta = event.time - *buffer.last_time;
-      if (delta > gap_threshold && !buffer.bytes.empty()) {
-        ParseAvailable(buffer, event.direction, &result.frames, /*final_flush=*/true);
-      }
+void FrameSequencer::Release(std::optional<double> watermark) {
+  auto after = [](const QueuedFrame& a, const QueuedFrame& b) {
+    return FrameAfter(a.frame, a.sequence, b.frame, b.sequence);
+  };
+  while (!ready_.empty()) {
+    if (watermark.has_value() && ready_.front().frame.start_time > *watermark) {
+      break;
     }
-
-    buffer.last_time = event.time;
-    buffer.bytes.push_back(event);
-    ParseAvailable(buffer, event.direction, &result.frames, /*final_flush=*/false);
+    std::pop_heap(ready_.begin(), ready_.end(), after);
+    Frame frame = std::move(ready_.back().frame);
+    ready_.pop_back();
+    on_frame_(std::move(frame));
   }
+}
 
-  // Flush remaining buffers at end of file.
-  for (std::size_t i = 0; i < buffers.size(); ++i) {
-    ParseAvailable(buffers[i], i == 0 ? BusDirection::Rx : BusDirection::Tx, &result.frames,
-                   /*final_flush=*/true);
+void ReadCaptureEvents(const std::filesystem::path& path, const ByteEventCallback& on_event) {
+  MappedFile file(path);
+  ScopedMetricTimer timer(MetricTimer::kCapture, file.size());
+  CountMetric(MetricCounter::kCaptureBytes, file.size());
+  if constexpr (kMetricsEnabled) {
+    // Tally locally and publish once, so the per-byte cost is a couple of increments.
+    uint64_t events = 0;
+    uint64_t errors = 0;
+    double last_time = 0.0;
+    ReadEvents(path, std::move(file), [&](const ByteEvent& event) {
+      ++events;
+      errors += event.has_error ? 1 : 0;
+      last_time = event.time;
+      on_event(event);
+    });
+    CountMetric(MetricCounter::kByteEvents, events);
+    CountMetric(MetricCounter::kByteEventErrors, errors);
+    CountMetric(MetricCounter::kCaptureMicroseconds, static_cast<uint64_t>(last_time * 1e6));
+  } else {
+    ReadEvents(path, std::move(file), on_event);
   }
+}
 
-  std::stable_sort(result.frames.begin(), result.frames.end(),
-                   [](const Frame& a, const Frame& b) { return a.start_time < b.start_time; });
+void StreamCapture(const std::filesystem::path& path, const FrameCallback& on_frame,
+                   double gap_threshold) {
+  FrameSequencer sequencer(on_frame, gap_threshold);
+  ReadCaptureEvents(path, [&sequencer](const ByteEvent& event) { sequencer.Push(event); });
+  sequencer.Finish();
+}
 
+std::vector<std::span<const ByteEvent>> SplitAtIdle(std::span<const ByteEvent> events,
+                                                    double chunk_seconds, double gap_threshold) {
+  std::vector<std::span<const ByteEvent>> chunks;
+  std::size_t begin = 0;
+  for (std::size_t i = 1; i < events.size(); ++i) {
+    bool long_enough = events[i - 1].time - events[begin].time >= chunk_seconds;
+    bool idle = events[i].time - events[i - 1].time > gap_threshold;
+    if (long_enough && idle) {
+      chunks.push_back(events.subspan(begin, i - begin));
+      begin = i;
+    }
+  }
+  if (begin < events.size()) {
+    chunks.push_back(events.subspan(begin));
+  }
+  return chunks;
+}
+
+FrameSet LoadCapture(const std::filesystem::path& path, double gap_threshold) {
+  FrameSet result;
+  StreamCapture(
+      path, [&result](Frame&& frame) { result.frames.push_back(std::move(frame)); },
+      gap_threshold);
   return result;
 }
 
 }  // namespace fujitsu::airstage
-
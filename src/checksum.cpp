@@ -0,0 +1,178 @@
+#include "fujitsu/checksum.h"
+
+#include "fujitsu/packet.h"
+
+#if !FUJITSU_EMBEDDED
+#include <stdexcept>
+#include <string>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FUJITSU_HAVE_AVX2_DISPATCH 1
+#endif
+
+namespace fujitsu::airstage {
+
+namespace {
+
+using SumFunction = uint64_t (*)(const uint8_t*, std::size_t);
+
+uint64_t SumScalar(const uint8_t* data, std::size_t size) {
+  uint64_t sum = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+#if defined(__SSE2__) || defined(FUJITSU_HAVE_AVX2_DISPATCH)
+// Adds the two 64-bit lanes. Goes through memory because _mm_cvtsi128_si64 is x86-64 only.
+inline uint64_t AddLanes(__m128i lanes) {
+  alignas(16) uint64_t parts[2];
+  _mm_store_si128(reinterpret_cast<__m128i*>(parts), lanes);
+  return parts[0] + parts[1];
+}
+#endif
+
+#if defined(__SSE2__)
+// PSADBW against zero adds each group of 8 bytes into a 64-bit lane.
+uint64_t SumSse2(const uint8_t* data, std::size_t size) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = zero;
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(block, zero));
+  }
+  return AddLanes(acc) + SumScalar(data + i, size - i);
+}
+#endif
+
+#if defined(FUJITSU_HAVE_AVX2_DISPATCH)
+__attribute__((target("avx2"))) uint64_t SumAvx2(const uint8_t* data, std::size_t size) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc = zero;
+  std::size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(block, zero));
+  }
+  __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  return AddLanes(half) + SumScalar(data + i, size - i);
+}
+#endif
+
+SumFunction SumFor(ChecksumBackend backend) {
+  switch (backend) {
+    case ChecksumBackend::kScalar:
+      return SumScalar;
+    case ChecksumBackend::kSse2:
+#if defined(__SSE2__)
+      return SumSse2;
+#else
+      return nullptr;
+#endif
+    case ChecksumBackend::kAvx2:
+#if defined(FUJITSU_HAVE_AVX2_DISPATCH)
+      return __builtin_cpu_supports("avx2") ? SumAvx2 : nullptr;
+#else
+      return nullptr;
+#endif
+  }
+  return nullptr;
+}
+
+ChecksumBackend SelectBackend() {
+  for (auto backend : {ChecksumBackend::kAvx2, ChecksumBackend::kSse2}) {
+    if (SumFor(backend)) {
+      return backend;
+    }
+  }
+  return ChecksumBackend::kScalar;
+}
+
+uint16_t ChecksumFromSum(uint64_t sum) {
+  return static_cast<uint16_t>(0xFFFF - static_cast<uint16_t>(sum));
+}
+
+}  // namespace
+
+const char* ToString(ChecksumBackend backend) {
+  switch (backend) {
+    case ChecksumBackend::kScalar:
+      return "scalar";
+    case ChecksumBackend::kSse2:
+      return "sse2";
+    case ChecksumBackend::kAvx2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+bool IsSupported(ChecksumBackend backend) {
+  return SumFor(backend) != nullptr;
+}
+
+ChecksumBackend ActiveChecksumBackend() {
+  static const ChecksumBackend backend = SelectBackend();
+  return backend;
+}
+
+uint16_t ComputeChecksum(std::span<const uint8_t> bytes) {
+  // Below one vector the indirect call costs more than it saves.
+  if (bytes.size() < 16) {
+    return ChecksumFromSum(SumScalar(bytes.data(), bytes.size()));
+  }
+  static const SumFunction sum = SumFor(ActiveChecksumBackend());
+  return ChecksumFromSum(sum(bytes.data(), bytes.size()));
+}
+
+#if !FUJITSU_EMBEDDED
+uint16_t ComputeChecksum(std::span<const uint8_t> bytes, ChecksumBackend backend) {
+  SumFunction sum = SumFor(backend);
+  if (!sum) {
+    throw std::runtime_error(std::string("checksum backend not supported: ") + ToString(backend));
+  }
+  return ChecksumFromSum(sum(bytes.data(), bytes.size()));
+}
+#endif
+
+void PrefixSums16(std::span<const uint8_t> bytes, std::span<uint16_t> sums) {
+  uint16_t running = 0;
+  sums[0] = 0;
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    running = static_cast<uint16_t>(running + bytes[i]);
+    sums[i + 1] = running;
+  }
+}
+
+#if !FUJITSU_EMBEDDED
+std::vector<std::size_t> FindPacketStarts(std::span<const uint8_t> bytes) {
+  std::vector<std::size_t> starts;
+  if (bytes.size() < kPacketHeaderBytes + kPacketTrailerBytes) {
+    return starts;
+  }
+  std::vector<uint16_t> sums(bytes.size() + 1);
+  PrefixSums16(bytes, sums);
+
+  std::size_t last = bytes.size() - (kPacketHeaderBytes + kPacketTrailerBytes);
+  for (std::size_t offset = 0; offset <= last; ++offset) {
+    std::size_t end = offset + kPacketHeaderBytes + bytes[offset + 4];
+    if (end + kPacketTrailerBytes > bytes.size()) {
+      continue;
+    }
+    auto expected = ChecksumFromSum(static_cast<uint16_t>(sums[end] - sums[offset]));
+    auto actual = static_cast<uint16_t>((bytes[end] << 8) | bytes[end + 1]);
+    if (expected == actual) {
+      starts.push_back(offset);
+    }
+  }
+  return starts;
+}
+#endif
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,86 @@
+#include "fujitsu/classifier.h"
+
+#include <array>
+#include <cstddef>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+using Decoder = Message (*)(const PacketView& packet);
+
+// Highest command id with a dedicated decoder; anything above is opaque.
+constexpr uint32_t kMaxDispatchCommand = static_cast<uint32_t>(CommandId::kBulkWrite);
+
+Message DecodeOpaque(const PacketView& packet) {
+  return OpaqueMessage{packet};
+}
+
+template <auto DecodeFn>
+Message DecodeOrOpaque(const PacketView& packet) {
+  if (auto message = DecodeFn(packet)) {
+    return *message;
+  }
+  return OpaqueMessage{packet};
+}
+
+constexpr std::size_t DispatchIndex(uint32_t command_id, BusDirection direction) {
+  return command_id * 2 + (direction == BusDirection::Rx ? 0 : 1);
+}
+
+constexpr auto BuildDispatchTable() {
+  std::array<Decoder, (kMaxDispatchCommand + 1) * 2> table{};
+  for (auto& entry : table) {
+    entry = &DecodeOpaque;
+  }
+
+  auto set = [&table](CommandId command, BusDirection direction, Decoder decoder) {
+    table[DispatchIndex(static_cast<uint32_t>(command), direction)] = decoder;
+  };
+  set(CommandId::kReadRegisters, BusDirection::Rx, &DecodeOrOpaque<&DecodeReadRequestView>);
+  set(CommandId::kReadRegisters, BusDirection::Tx, &DecodeOrOpaque<&DecodeReadResponseView>);
+  for (CommandId write : {CommandId::kSetpoint, CommandId::kControlRegister, CommandId::kBulkWrite}) {
+    set(write, BusDirection::Rx, &DecodeOrOpaque<&DecodeWriteRequestView>);
+    set(write, BusDirection::Tx,
+        &DecodeOrOpaque<static_cast<std::optional<WriteResponse> (*)(const PacketView&)>(
+            &DecodeWriteResponse)>);
+  }
+  return table;
+}
+
+constexpr auto kDispatchTable = BuildDispatchTable();
+
+}  // namespace
+
+Message Classify(const PacketView& packet, BusDirection direction) {
+  if (packet.command_id > kMaxDispatchCommand) {
+    return OpaqueMessage{packet};
+  }
+  return kDispatchTable[DispatchIndex(packet.command_id, direction)](packet);
+}
+
+std::optional<Message> Classify(const FrameView& frame) {
+  if (frame.type != FrameType::Packet) {
+    return std::nullopt;
+  }
+  auto packet = ParsePacketView(frame.bytes);
+  if (!packet) {
+    return std::nullopt;
+  }
+  return Classify(*packet, frame.direction);
+}
+
+#if !FUJITSU_EMBEDDED
+std::optional<Message> Classify(const Frame& frame, std::string* error) {
+  if (frame.type != Frame::Type::Packet) {
+    return std::nullopt;
+  }
+  auto packet = ParsePacketView(frame.bytes, error);
+  if (!packet) {
+    return std::nullopt;
+  }
+  return Classify(*packet, frame.direction);
+}
+#endif
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,45 @@
+#include "fujitsu/binary_capture.h"
+#include "fujitsu/capture_reader.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+using fujitsu::airstage::BinaryCaptureWriter;
+using fujitsu::airstage::ByteEvent;
+using fujitsu::airstage::ReadCaptureEvents;
+
+namespace {
+
+void PrintUsage(const char* program) {
+  std::cout << "Usage: " << program << " <capture.csv|capture.sal> <output.fjbc>\n";
+  std::cout << "  Converts a Saleae CSV export or .sal capture into the compact binary capture format.\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc == 2 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  if (argc != 3) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::filesystem::path input = argv[1];
+  std::filesystem::path output = argv[2];
+  try {
+    BinaryCaptureWriter writer;
+    ReadCaptureEvents(input, [&writer](const ByteEvent& event) { writer.Append(event); });
+    writer.Write(output);
+    std::cout << input.string() << " -> " << output.string() << " (" << writer.size()
+              << " events, " << std::filesystem::file_size(input) << " -> "
+              << std::filesystem::file_size(output) << " bytes)\n";
+  } catch (const std::exception& ex) {
+    std::cerr << "Error converting " << input << ": " << ex.what() << '\n';
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include "fujitsu/correlator.h"
+
+#include "fujitsu/packet.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+// Values below kSubBuckets get one bucket each. Above that, each power-of-two range is split
+// into kHalfSubBuckets equal buckets, so bucket width is at most 1/128 of the value.
+std::size_t LatencyHistogram::IndexOf(uint64_t value) {
+  if (value < kSubBuckets) {
+    return static_cast<std::size_t>(value);
+  }
+  unsigned shift = static_cast<unsigned>(std::bit_width(value)) - kSubBucketBits;
+  return static_cast<std::size_t>(kSubBuckets + (shift - 1) * kHalfSubBuckets +
+                                  ((value >> shift) - kHalfSubBuckets));
+}
+
+uint64_t LatencyHistogram::HighestEquivalent(std::size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  uint64_t above = index - kSubBuckets;
+  unsigned shift = static_cast<unsigned>(above / kHalfSubBuckets) + 1;
+  uint64_t lowest = (kHalfSubBuckets + above % kHalfSubBuckets) << shift;
+  return lowest + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::Record(double seconds) {
+  uint64_t value = static_cast<uint64_t>(std::llround(std::max(seconds, 0.0) * 1e6));
+  std::size_t index = IndexOf(value);
+  if (index >= counts_.size()) {
+    counts_.resize(index + 1);
+  }
+  ++counts_[index];
+  ++count_;
+  max_us_ = std::max(max_us_, value);
+  total_us_ += static_cast<double>(value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (other.counts_.size() > counts_.size()) {
+    counts_.resize(other.counts_.size());
+  }
+  for (std::size_t i = 0; i < other.counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  max_us_ = std::max(max_us_, other.max_us_);
+  total_us_ += other.total_us_;
+}
+
+double LatencyHistogram::ValueAtPercentile(double percentile) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  double fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+  auto target = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(count_)));
+  target = std::max<std::size_t>(target, 1);
+  std::size_t seen = 0;
+  for (std::size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= target) {
+      return static_cast<double>(std::min(HighestEquivalent(i), max_us_)) * 1e-6;
+    }
+  }
+  return max_seconds();
+}
+
+void CommandStats::Merge(const CommandStats& other) {
+  requests += other.requests;
+  answered += other.answered;
+  timeouts += other.timeouts;
+  orphans += other.orphans;
+  latency.Merge(other.latency);
+}
+
+TransactionCorrelator::TransactionCorrelator(double timeout, TransactionCallback on_transaction)
+    : timeout_(timeout), on_transaction_(std::move(on_transaction)) {}
+
+void TransactionCorrelator::Push(const Frame& frame) {
+  ExpireBefore(frame.start_time);
+  if (frame.type != Frame::Type::Packet) {
+    return;
+  }
+  auto packet = ParsePacketView(frame.bytes);
+  if (!packet) {
+    ++invalid_packets_;
+    return;
+  }
+
+  CommandStats& stats = stats_[packet->command_id];
+  if (frame.direction == BusDirection::Rx) {
+    if (outstanding_) {
+      TimeOut();
+    }
+    ++stats.requests;
+    outstanding_ = Outstanding{packet->command_id, frame.start_time, frame.end_time};
+    return;
+  }
+
+  if (!outstanding_ || outstanding_->command_id != packet->command_id) {
+    ++stats.orphans;
+    return;
+  }
+  Transaction transaction{packet->command_id, outstanding_->start_time, frame.start_time,
+                          frame.start_time - outstanding_->end_time};
+  outstanding_.reset();
+  ++stats.answered;
+  stats.latency.Record(transaction.latency);
+  if (on_transaction_) {
+    on_transaction_(transaction);
+  }
+}
+
+void TransactionCorrelator::Finish() {
+  if (outstanding_) {
+    TimeOut();
+  }
+}
+
+void TransactionCorrelator::ExpireBefore(double time) {
+  if (outstanding_ && time - outstanding_->end_time > timeout_) {
+    TimeOut();
+  }
+}
+
+void TransactionCorrelator::TimeOut() {
+  ++stats_[outstanding_->command_id].timeouts;
+  outstanding_.reset();
+}
+
+}  // namespace fujitsu::airstage
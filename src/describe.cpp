@@ -0,0 +1,205 @@
+#include "fujitsu/describe.h"
+
+#include "fujitsu/classifier.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+#include "fujitsu/register_db.h"
+
+#include <span>
+#include <string>
+#include <variant>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+void AppendRegister(uint16_t address, TextBuffer& out) {
+  out.Append("0x");
+  out.AppendHex(address, 4);
+  if (auto info = LookupRegister(address)) {
+    out.Append('(');
+    out.Append(info->name);
+    out.Append(')');
+  }
+}
+
+// `0x1234(4660)`
+void AppendValue(uint16_t value, TextBuffer& out) {
+  out.Append("0x");
+  out.AppendHex(value, 4);
+  out.Append('(');
+  out.AppendDecimal(value);
+  out.Append(')');
+}
+
+void AppendByteVector(std::span<const uint8_t> bytes, TextBuffer& out) {
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    out.Append(i ? " 0x" : "0x");
+    out.AppendHex(bytes[i], 2);
+  }
+}
+
+void AppendTimestamp(double seconds, TextBuffer& out) {
+  out.Append('[');
+  out.AppendFixed(seconds, 6, 10);
+  out.Append("] ");
+}
+
+void DescribeMessage(const ReadRequestView& request, TextBuffer& out) {
+  out.Append(" ReadRequest addresses=[");
+  bool first = true;
+  for (uint16_t address : request.addresses) {
+    if (!first) {
+      out.Append(", ");
+    }
+    first = false;
+    AppendRegister(address, out);
+  }
+  out.Append(']');
+}
+
+void DescribeMessage(const ReadResponseView& response, TextBuffer& out) {
+  out.Append(" ReadResponse status=0x");
+  out.AppendHex(response.status, 2);
+  out.Append(" values=[");
+  bool first = true;
+  for (const auto entry : response.values) {
+    if (!first) {
+      out.Append(", ");
+    }
+    first = false;
+    DescribeRegisterValue(entry.address, entry.value, out);
+  }
+  out.Append(']');
+}
+
+void DescribeMessage(const WriteRequestView& request, TextBuffer& out) {
+  out.Append(" WriteRequest values=[");
+  bool first = true;
+  for (const auto entry : request.values) {
+    if (!first) {
+      out.Append(", ");
+    }
+    first = false;
+    DescribeRegisterValue(entry.address, entry.value, out);
+  }
+  out.Append(']');
+}
+
+void DescribeMessage(const WriteResponse& response, TextBuffer& out) {
+  out.Append(" WriteResponse status=0x");
+  out.AppendHex(response.status, 2);
+}
+
+void DescribeMessage(const OpaqueMessage& message, TextBuffer& out) {
+  out.Append(" command=");
+  out.Append(CommandToString(message.packet.command_id));
+  if (!message.packet.payload.empty()) {
+    out.Append(" payload=[");
+    AppendByteVector(message.packet.payload, out);
+    out.Append(']');
+  }
+}
+
+void DescribePacket(const Frame& frame, const PacketView& packet, TextBuffer& out) {
+  out.Append("PACKET id=0x");
+  out.AppendHex(packet.command_id, 8);
+  out.Append(" len=");
+  out.AppendDecimal(packet.payload_length());
+
+  std::visit([&out](const auto& message) { DescribeMessage(message, out); },
+             Classify(packet, frame.direction));
+}
+
+// Scratch space for the std::ostream overloads, reused so that steady-state formatting does
+// not allocate.
+TextBuffer& ScratchBuffer() {
+  thread_local TextBuffer buffer;
+  buffer.clear();
+  return buffer;
+}
+
+}  // namespace
+
+void DescribeRegisterValue(uint16_t address, uint16_t value, TextBuffer& out) {
+  auto info = LookupRegister(address);
+  out.Append("0x");
+  out.AppendHex(address, 4);
+  if (info) {
+    out.Append('(');
+    out.Append(info->name);
+    out.Append(')');
+  }
+  out.Append('=');
+  AppendValue(value, out);
+  if (auto decoded = info ? DecodeValue(*info->codec, value) : std::nullopt) {
+    out.Append('[');
+    if (decoded->kind == ValueKind::kScaled) {
+      out.AppendFixed(decoded->number, 1);
+      out.Append(' ');
+      out.Append(decoded->unit);
+    } else {
+      out.Append(decoded->label);
+    }
+    out.Append(']');
+  }
+}
+
+void DescribeFrame(const Frame& frame, TextBuffer& out) {
+  AppendTimestamp(frame.start_time, out);
+  out.Append(ToString(frame.direction));
+  out.Append(' ');
+
+  switch (frame.type) {
+    case Frame::Type::Break:
+      out.Append("BREAK");
+      break;
+    case Frame::Type::Raw:
+      out.Append("RAW ");
+      AppendByteVector(frame.bytes, out);
+      break;
+    case Frame::Type::Packet: {
+      std::string error;
+      auto packet = ParsePacketView(frame.bytes, &error);
+      if (!packet) {
+        out.Append("PACKET(parse error: ");
+        out.Append(error);
+        out.Append(") raw=");
+        AppendByteVector(frame.bytes, out);
+      } else {
+        DescribePacket(frame, *packet, out);
+      }
+      break;
+    }
+  }
+}
+
+void DescribeFrame(const Frame& frame, std::ostream& os) {
+  TextBuffer& buffer = ScratchBuffer();
+  DescribeFrame(frame, buffer);
+  buffer.WriteTo(os);
+}
+
+void DescribeChange(const RegisterChange& change, TextBuffer& out) {
+  AppendTimestamp(change.time, out);
+  AppendRegister(change.address, out);
+  out.Append(' ');
+  if (change.previous) {
+    AppendValue(*change.previous, out);
+  } else {
+    out.Append("unset");
+  }
+  out.Append(" -> ");
+  AppendValue(change.value, out);
+  out.Append(" (");
+  out.Append(ToString(change.source));
+  out.Append(')');
+}
+
+void DescribeChange(const RegisterChange& change, std::ostream& os) {
+  TextBuffer& buffer = ScratchBuffer();
+  DescribeChange(change, buffer);
+  buffer.WriteTo(os);
+}
+
+}  // namespace fujitsu::airstage
@@ -1,167 +1,625 @@
 #include "fujitsu/capture_reader.h"
+#include "fujitsu/classifier.h"
+#include "fujitsu/correlator.h"
+#include "fujitsu/describe.h"
 #include "fujitsu/messages.h"
+#include "fujitsu/metrics.h"
 #include "fujitsu/packet.h"
-#include "fujitsu/register_db.h"
+#include "fujitsu/pipeline.h"
+#include "fujitsu/records.h"
+#include "fujitsu/register_map.h"
+#include "fujitsu/register_mirror.h"
+#include "fujitsu/text_buffer.h"
+#include "fujitsu/transport.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <condition_variable>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+using fujitsu::airstage::AppendBinaryCaptureRecord;
+using fujitsu::airstage::AppendBinaryRecord;
+using fujitsu::airstage::AppendNdjsonCaptureRecord;
+using fujitsu::airstage::AppendNdjsonRecord;
+using fujitsu::airstage::AppendRecordStreamHeader;
 using fujitsu::airstage::BusDirection;
+using fujitsu::airstage::BusMonitor;
+using fujitsu::airstage::ByteEvent;
+using fujitsu::airstage::Classify;
+using fujitsu::airstage::CommandStats;
 using fujitsu::airstage::CommandToString;
-using fujitsu::airstage::DecodeReadRequest;
-using fujitsu::airstage::DecodeReadResponse;
-using fujitsu::airstage::DecodeWriteRequest;
-using fujitsu::airstage::DecodeWriteResponse;
+using fujitsu::airstage::DescribeChange;
+using fujitsu::airstage::DescribeFrame;
 using fujitsu::airstage::Frame;
-using fujitsu::airstage::FrameSet;
-using fujitsu::airstage::LoadCapture;
-using fujitsu::airstage::LookupRegister;
-using fujitsu::airstage::Packet;
-using fujitsu::airstage::ParsePacket;
-using fujitsu::airstage::ToString;
+using fujitsu::airstage::FrameSequencer;
+using fujitsu::airstage::kMetricCommandSlots;
+using fujitsu::airstage::kMetricsEnabled;
+using fujitsu::airstage::kMetricTimerCount;
+using fujitsu::airstage::Message;
+using fujitsu::airstage::MetricCounter;
+using fujitsu::airstage::MetricsSnapshot;
+using fujitsu::airstage::MetricTimer;
+using fujitsu::airstage::MonotonicSeconds;
+using fujitsu::airstage::ParsePacketView;
+using fujitsu::airstage::PipelineOptions;
+using fujitsu::airstage::ReadCaptureEvents;
+using fujitsu::airstage::RegisterChange;
+using fujitsu::airstage::RegisterMapWatcher;
+using fujitsu::airstage::RegisterMirror;
+using fujitsu::airstage::SerialPort;
+using fujitsu::airstage::SnapshotMetrics;
+using fujitsu::airstage::SplitAtIdle;
+using fujitsu::airstage::StagedPipeline;
+using fujitsu::airstage::StreamCapture;
+using fujitsu::airstage::TextBuffer;
+using fujitsu::airstage::Transaction;
+using fujitsu::airstage::TransactionCorrelator;
 
 namespace {
 
 constexpr double kDefaultGapThreshold = 0.004;  // seconds
 
-std::string FormatHex(uint16_t value) {
-  std::ostringstream oss;
-  oss << "0x" << std::uppercase << std::hex << std::setw(4) << std::setfill('0') << value;
-  return oss.str();
+// Formatted capture output is handed to std::cout in blocks of about this size.
+constexpr std::size_t kOutputBlockBytes = 256 * 1024;
+
+enum class OutputFormat {
+  kText,
+  kNdjson,
+  kBinary,
+};
+
+void PrintUsage(const char* program) {
+  std::cout << "Usage: " << program
+            << " [--gap <seconds>] [--jobs <n>] [--chunk <seconds>] [--changes] [--stats]\n"
+            << "           [--registers <file>] [--format text|ndjson|binary] [--metrics]\n"
+            << "           <capture.csv|capture.sal|capture.fjbc>...\n";
+  std::cout << "  --gap    Override inter-byte gap threshold for frame detection (default "
+            << kDefaultGapThreshold << ")\n";
+  std::cout << "  --jobs   Decode captures on <n> threads; output keeps argument order\n";
+  std::cout << "  --chunk  Split each capture into ~<seconds> chunks at idle points and decode\n"
+            << "           the chunks concurrently (requires --jobs > 1)\n";
+  std::cout << "  --changes  Print register value changes instead of frames (decodes sequentially)\n";
+  std::cout << "  --stats    Print request/response counts and round-trip latency per command\n"
+            << "           across all captures instead of the frames\n";
+  std::cout << "  --registers  Load register definitions from <file> (reloaded on change in --live)\n";
+  std::cout << "  --format   Write frames as text (default), NDJSON or binary records with decoded\n"
+            << "           values and request/response pairing (fujitsu/records.h; decodes sequentially)\n";
+  std::cout << "  --metrics  Report decoder counters and stage timings on stderr when the run ends\n";
+  std::cout << "       " << program
+            << " --live <device> [--live-tx <device>] [--duration <seconds>] [--changes] [--stats]\n"
+            << "           [--format text|ndjson|binary] [--metrics]\n";
+  std::cout << "  --live      Decode RX traffic from a serial device or pty as it arrives\n";
+  std::cout << "  --live-tx   Also decode TX traffic from a second device\n";
+  std::cout << "  --duration  Stop after <seconds> (default: until the devices close or Ctrl-C)\n";
+  std::cout << "  --stats     Report per-command round-trip statistics on stderr when the run ends\n";
 }
 
-std::string FormatRegister(uint16_t address) {
-  std::ostringstream oss;
-  oss << FormatHex(address);
-  if (auto info = LookupRegister(address)) {
-    oss << "(" << info->name << ")";
+// Feeds the register values carried by a frame into the mirror.
+void ApplyFrame(const Frame& frame, RegisterMirror& mirror) {
+  if (frame.type != Frame::Type::Packet) {
+    return;
+  }
+  if (auto packet = ParsePacketView(frame.bytes)) {
+    mirror.Apply(Classify(*packet, frame.direction), frame.start_time);
   }
-  return oss.str();
 }
 
-std::string FormatRegisterValue(uint16_t address, uint16_t value) {
-  std::ostringstream oss;
-  oss << FormatRegister(address) << "=" << FormatHex(value) << "(" << std::dec
-      << static_cast<int>(value) << ")";
-  return oss.str();
+void PrintStats(const std::map<uint32_t, CommandStats>& stats, std::size_t invalid_packets,
+                std::ostream& os) {
+  auto milliseconds = [](double seconds) { return seconds * 1000.0; };
+  os << std::left << std::setw(22) << "command" << std::right << std::setw(10) << "requests"
+     << std::setw(10) << "answered" << std::setw(10) << "timeouts" << std::setw(10) << "orphans"
+     << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms"
+     << '\n';
+  os << std::fixed << std::setprecision(3);
+  for (const auto& [command, entry] : stats) {
+    os << std::left << std::setw(22) << CommandToString(command) << std::right << std::setw(10)
+       << entry.requests << std::setw(10) << entry.answered << std::setw(10) << entry.timeouts
+       << std::setw(10) << entry.orphans << std::setw(10)
+       << milliseconds(entry.latency.ValueAtPercentile(50.0)) << std::setw(10)
+       << milliseconds(entry.latency.ValueAtPercentile(99.0)) << std::setw(10)
+       << milliseconds(entry.latency.max_seconds()) << '\n';
+  }
+  if (invalid_packets) {
+    os << invalid_packets << " packet frames failed validation\n";
+  }
 }
 
-std::string FormatByteVector(const std::vector<uint8_t>& bytes) {
-  std::ostringstream oss;
-  oss << std::uppercase << std::hex << std::setfill('0');
-  for (std::size_t i = 0; i < bytes.size(); ++i) {
-    if (i) {
-      oss << ' ';
+// Frame rates are per second of capture time, or of wall-clock time for live input.
+void PrintMetrics(const MetricsSnapshot& metrics, double wall_seconds, std::ostream& os) {
+  auto count = [&metrics](MetricCounter counter) { return metrics.counter(counter); };
+  double capture_seconds = static_cast<double>(count(MetricCounter::kCaptureMicroseconds)) * 1e-6;
+  double seconds = capture_seconds > 0.0 ? capture_seconds : wall_seconds;
+  os << std::fixed << std::setprecision(3);
+  os << "input:      " << count(MetricCounter::kCaptureBytes) << " capture bytes, "
+     << count(MetricCounter::kByteEvents) << " byte events ("
+     << count(MetricCounter::kByteEventErrors) << " with framing errors), " << seconds
+     << " s of traffic\n";
+  os << "framing:    " << count(MetricCounter::kPacketFrames) << " packet, "
+     << count(MetricCounter::kBreakFrames) << " break, " << count(MetricCounter::kRawFrames)
+     << " raw frames; " << count(MetricCounter::kRawBytes) << " bytes discarded, "
+     << count(MetricCounter::kResyncChecksumMisses) << " resync checksum misses\n";
+  os << "validation: " << metrics.timer(MetricTimer::kValidate).calls << " frames, "
+     << count(MetricCounter::kValidateTooShort) << " too short, "
+     << count(MetricCounter::kValidateLengthMismatch) << " length mismatches, "
+     << count(MetricCounter::kValidateChecksumMismatch) << " checksum mismatches\n";
+  os << "messages:   " << count(MetricCounter::kMessagesDecoded) << " decoded, "
+     << count(MetricCounter::kMessageDecodeFailures) << " malformed\n";
+
+  os << std::left << std::setw(22) << "command" << std::right << std::setw(10) << "frames"
+     << std::setw(12) << "per second" << '\n';
+  for (std::size_t slot = 0; slot < kMetricCommandSlots; ++slot) {
+    uint64_t frames = metrics.packet_frames_by_command[slot];
+    if (frames == 0) {
+      continue;
     }
-    oss << "0x" << std::setw(2) << static_cast<int>(bytes[i]);
+    std::string name =
+        slot + 1 < kMetricCommandSlots ? CommandToString(static_cast<uint32_t>(slot)) : "other";
+    os << std::left << std::setw(22) << name << std::right << std::setw(10) << frames
+       << std::setw(12) << (seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0) << '\n';
   }
-  return oss.str();
-}
 
-void PrintUsage(const char* program) {
-  std::cout << "Usage: " << program << " [--gap <seconds>] <capture.csv>...\n";
-  std::cout << "  --gap    Override inter-byte gap threshold for frame detection (default "
-            << kDefaultGapThreshold << ")\n";
+  os << std::left << std::setw(22) << "stage" << std::right << std::setw(10) << "calls"
+     << std::setw(10) << "timed" << std::setw(12) << "mean us" << std::setw(12) << "p50 us"
+     << std::setw(12) << "p99 us" << std::setw(12) << "MB/s" << '\n';
+  for (std::size_t index = 0; index < kMetricTimerCount; ++index) {
+    auto timer = static_cast<MetricTimer>(index);
+    const auto& stage = metrics.timer(timer);
+    os << std::left << std::setw(22) << ToString(timer) << std::right << std::setw(10)
+       << stage.calls << std::setw(10) << stage.samples << std::setw(12)
+       << stage.mean_nanoseconds() * 1e-3 << std::setw(12)
+       << stage.percentile_nanoseconds(0.5) * 1e-3 << std::setw(12)
+       << stage.percentile_nanoseconds(0.99) * 1e-3 << std::setw(12)
+       << stage.bytes_per_second() * 1e-6 << '\n';
+  }
 }
 
-void DescribePacket(const Frame& frame, const Packet& packet, std::ostream& os) {
-  os << "PACKET id=0x" << std::uppercase << std::hex << std::setw(8) << std::setfill('0')
-     << packet.command_id << std::dec;
-  os.fill(' ');
-  os << " len=" << packet.payload_length();
+// Output of one unit of work, kept until every earlier unit has been written.
+struct TaskResult {
+  std::string text;
+  std::string error;  // non-empty if the task failed
+};
+
+// Runs `produce(0..count)` on `jobs` worker threads and passes each result to `consume` in
+// index order as soon as it and all earlier results are available. Stops handing out new work
+// once `consume` returns false. Returns false if it was stopped early.
+template <typename Produce, typename Consume>
+bool RunOrdered(std::size_t count, std::size_t jobs, Produce produce, Consume consume) {
+  std::vector<std::optional<TaskResult>> results(count);
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::atomic<std::size_t> next{0};
+  std::atomic<bool> cancelled{false};
 
-  auto read_request = DecodeReadRequest(packet);
-  if (read_request) {
-    os << " ReadRequest addresses=[";
-    for (std::size_t i = 0; i < read_request->addresses.size(); ++i) {
-      if (i) {
-        os << ", ";
+  auto worker = [&] {
+    for (;;) {
+      std::size_t index = next.fetch_add(1);
+      if (index >= count || cancelled.load()) {
+        return;
+      }
+      TaskResult result = produce(index);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[index] = std::move(result);
       }
-      os << FormatRegister(read_request->addresses[i]);
+      ready.notify_all();
     }
-    os << "]";
-    return;
+  };
+
+  std::vector<std::jthread> threads;
+  threads.reserve(jobs);
+  for (std::size_t i = 0; i < jobs; ++i) {
+    threads.emplace_back(worker);
   }
 
-  auto read_response = DecodeReadResponse(packet);
-  if (read_response) {
-    os << " ReadResponse status=0x" << std::uppercase << std::hex << std::setw(2)
-       << std::setfill('0') << static_cast<int>(read_response->status) << std::dec;
-    os.fill(' ');
-    os << " values=[";
-    for (std::size_t i = 0; i < read_response->values.size(); ++i) {
-      if (i) {
-        os << ", ";
+  for (std::size_t index = 0; index < count; ++index) {
+    TaskResult result;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ready.wait(lock, [&] { return results[index].has_value(); });
+      result = std::move(*results[index]);
+      results[index].reset();
+    }
+    if (!consume(result)) {
+      cancelled = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string DescribeFrames(std::span<const ByteEvent> events, double gap_threshold) {
+  TextBuffer out;
+  FrameSequencer sequencer(
+      [&out](Frame&& frame) {
+        DescribeFrame(frame, out);
+        out.Append('\n');
+      },
+      gap_threshold);
+  for (const auto& event : events) {
+    sequencer.Push(event);
+  }
+  sequencer.Finish();
+  return out.Take();
+}
+
+std::string FileHeader(const std::filesystem::path& path) {
+  std::ostringstream out;
+  out << "== " << path << " ==\n";
+  return out.str();
+}
+
+// Passes the buffered text on to std::cout once a full block has accumulated.
+void FlushFullBlock(TextBuffer& out) {
+  if (out.size() >= kOutputBlockBytes) {
+    out.WriteTo(std::cout);
+  }
+}
+
+int DumpSequential(const std::vector<std::filesystem::path>& paths, double gap_threshold) {
+  TextBuffer out;
+  for (std::size_t idx = 0; idx < paths.size(); ++idx) {
+    const auto& path = paths[idx];
+    try {
+      // The header is written lazily so that an unreadable file produces no partial output.
+      bool header_written = false;
+      auto write_header = [&] {
+        if (!header_written) {
+          out.Append(FileHeader(path));
+          header_written = true;
+        }
+      };
+      StreamCapture(
+          path,
+          [&](Frame&& frame) {
+            write_header();
+            DescribeFrame(frame, out);
+            out.Append('\n');
+            FlushFullBlock(out);
+          },
+          gap_threshold);
+      write_header();
+      if (idx + 1 < paths.size()) {
+        out.Append('\n');
       }
-      const auto& entry = read_response->values[i];
-      os << FormatRegisterValue(entry.address, entry.value);
+    } catch (const std::exception& ex) {
+      out.WriteTo(std::cout);
+      std::cout.flush();
+      std::cerr << "Error processing " << path << ": " << ex.what() << '\n';
+      return 2;
     }
-    os << "]";
-    return;
   }
+  out.WriteTo(std::cout);
+  return 0;
+}
+
+// Writes frames as NDJSON or binary records. Each response is paired with the request it answers
+// as it is written, so records stream out in capture order.
+class RecordWriter {
+ public:
+  explicit RecordWriter(OutputFormat format) : format_(format), correlator_(MakeCorrelator()) {
+    if (format_ == OutputFormat::kBinary) {
+      AppendRecordStreamHeader(binary_);
+    }
+  }
+
+  RecordWriter(const RecordWriter&) = delete;
+  RecordWriter& operator=(const RecordWriter&) = delete;
+
+  // Starts a new capture file; requests are never paired across files.
+  void BeginCapture(const std::filesystem::path& path) {
+    correlator_ = MakeCorrelator();
+    if (format_ == OutputFormat::kNdjson) {
+      AppendNdjsonCaptureRecord(path.string(), text_);
+    } else {
+      AppendBinaryCaptureRecord(path.string(), binary_);
+    }
+  }
+
+  void Write(const Frame& frame) {
+    completed_.reset();
+    correlator_.Push(frame);
+    const Transaction* transaction = completed_ ? &*completed_ : nullptr;
+    if (format_ == OutputFormat::kNdjson) {
+      AppendNdjsonRecord(frame, transaction, text_);
+    } else {
+      AppendBinaryRecord(frame, transaction, binary_);
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const { return text_.size() + binary_.size(); }
+
+  void Flush() {
+    text_.WriteTo(std::cout);
+    std::cout.write(reinterpret_cast<const char*>(binary_.data()),
+                    static_cast<std::streamsize>(binary_.size()));
+    binary_.clear();
+  }
+
+ private:
+  TransactionCorrelator MakeCorrelator() {
+    return TransactionCorrelator(0.5, [this](const Transaction& transaction) {
+      completed_ = transaction;
+    });
+  }
+
+  OutputFormat format_;
+  TextBuffer text_;
+  std::vector<uint8_t> binary_;
+  std::optional<Transaction> completed_;
+  TransactionCorrelator correlator_;
+};
 
-  auto write_request = DecodeWriteRequest(packet);
-  if (write_request) {
-    os << " WriteRequest values=[";
-    for (std::size_t i = 0; i < write_request->values.size(); ++i) {
-      if (i) {
-        os << ", ";
+int DumpRecords(const std::vector<std::filesystem::path>& paths, double gap_threshold,
+                OutputFormat format) {
+  RecordWriter writer(format);
+  for (const auto& path : paths) {
+    try {
+      writer.BeginCapture(path);
+      StreamCapture(
+          path,
+          [&writer](Frame&& frame) {
+            writer.Write(frame);
+            if (writer.size() >= kOutputBlockBytes) {
+              writer.Flush();
+            }
+          },
+          gap_threshold);
+    } catch (const std::exception& ex) {
+      writer.Flush();
+      std::cout.flush();
+      std::cerr << "Error processing " << path << ": " << ex.what() << '\n';
+      return 2;
+    }
+  }
+  writer.Flush();
+  return 0;
+}
+
+// Tracks register state through each capture and prints only the values that change.
+int DumpChanges(const std::vector<std::filesystem::path>& paths, double gap_threshold) {
+  for (std::size_t idx = 0; idx < paths.size(); ++idx) {
+    const auto& path = paths[idx];
+    try {
+      RegisterMirror mirror;
+      TextBuffer out;
+      out.Append(FileHeader(path));
+      mirror.Subscribe([&out](const RegisterChange& change) {
+        DescribeChange(change, out);
+        out.Append('\n');
+      });
+      StreamCapture(path, [&mirror](Frame&& frame) { ApplyFrame(frame, mirror); }, gap_threshold);
+      if (idx + 1 < paths.size()) {
+        out.Append('\n');
       }
-      const auto& entry = write_request->values[i];
-      os << FormatRegisterValue(entry.address, entry.value);
+      out.WriteTo(std::cout);
+    } catch (const std::exception& ex) {
+      std::cerr << "Error processing " << path << ": " << ex.what() << '\n';
+      return 2;
     }
-    os << "]";
-    return;
   }
+  return 0;
+}
 
-  auto write_response = DecodeWriteResponse(packet);
-  if (write_response) {
-    os << " WriteResponse status=0x" << std::uppercase << std::hex << std::setw(2)
-       << std::setfill('0') << static_cast<int>(write_response->status) << std::dec;
-    os.fill(' ');
-    return;
+// Correlates requests with responses in every capture and prints one summary for the corpus.
+// Each capture is correlated separately since their timelines are unrelated.
+int DumpStats(const std::vector<std::filesystem::path>& paths, double gap_threshold) {
+  std::map<uint32_t, CommandStats> totals;
+  std::size_t invalid_packets = 0;
+  for (const auto& path : paths) {
+    try {
+      TransactionCorrelator correlator;
+      StreamCapture(path, [&correlator](Frame&& frame) { correlator.Push(frame); }, gap_threshold);
+      correlator.Finish();
+      for (const auto& [command, entry] : correlator.stats()) {
+        totals[command].Merge(entry);
+      }
+      invalid_packets += correlator.invalid_packets();
+    } catch (const std::exception& ex) {
+      std::cerr << "Error processing " << path << ": " << ex.what() << '\n';
+      return 2;
+    }
   }
+  PrintStats(totals, invalid_packets, std::cout);
+  return 0;
+}
+
+// One file per task; each file's text is buffered and written in argument order.
+int DumpFilesParallel(const std::vector<std::filesystem::path>& paths, double gap_threshold,
+                      std::size_t jobs) {
+  int status = 0;
+  RunOrdered(
+      paths.size(), jobs,
+      [&](std::size_t idx) {
+        TaskResult result;
+        try {
+          TextBuffer out;
+          out.Append(FileHeader(paths[idx]));
+          StreamCapture(
+              paths[idx],
+              [&out](Frame&& frame) {
+                DescribeFrame(frame, out);
+                out.Append('\n');
+              },
+              gap_threshold);
+          if (idx + 1 < paths.size()) {
+            out.Append('\n');
+          }
+          result.text = out.Take();
+        } catch (const std::exception& ex) {
+          result.error = ex.what();
+        }
+        return result;
+      },
+      [&, idx = std::size_t{0}](const TaskResult& result) mutable {
+        if (!result.error.empty()) {
+          std::cerr << "Error processing " << paths[idx] << ": " << result.error << '\n';
+          status = 2;
+          return false;
+        }
+        std::cout << result.text;
+        ++idx;
+        return true;
+      });
+  return status;
+}
+
+// Each file is loaded once, split at idle points into ~`chunk_seconds` pieces, and the pieces
+// are framed and formatted concurrently. Idle boundaries make the stitched output identical to
+// framing the file in one pass.
+int DumpChunksParallel(const std::vector<std::filesystem::path>& paths, double gap_threshold,
+                       std::size_t jobs, double chunk_seconds) {
+  for (std::size_t idx = 0; idx < paths.size(); ++idx) {
+    const auto& path = paths[idx];
+    std::vector<ByteEvent> events;
+    try {
+      ReadCaptureEvents(path, [&events](const ByteEvent& event) { events.push_back(event); });
+    } catch (const std::exception& ex) {
+      std::cerr << "Error processing " << path << ": " << ex.what() << '\n';
+      return 2;
+    }
 
-  os << " command=" << CommandToString(packet.command_id);
-  if (!packet.payload.empty()) {
-    os << " payload=[" << FormatByteVector(packet.payload) << "]";
+    auto chunks = SplitAtIdle(events, chunk_seconds, gap_threshold);
+    std::cout << FileHeader(path);
+    RunOrdered(
+        chunks.size(), jobs,
+        [&](std::size_t chunk) { return TaskResult{DescribeFrames(chunks[chunk], gap_threshold), {}}; },
+        [](const TaskResult& result) {
+          std::cout << result.text;
+          return true;
+        });
+    if (idx + 1 < paths.size()) {
+      std::cout << '\n';
+    }
   }
+  return 0;
 }
 
-void DescribeFrame(const Frame& frame, std::ostream& os) {
-  os.fill(' ');
-  os << "[" << std::setw(10) << std::fixed << std::setprecision(6) << frame.start_time << "] ";
-  os << ToString(frame.direction) << ' ';
+std::atomic<bool> g_stop_requested{false};
+
+void RequestStop(int) {
+  g_stop_requested = true;
+}
+
+// Decodes frames from serial devices as they arrive. Latency from the last byte of each frame
+// to its delivery is reported on stderr when the run ends.
+int DumpLive(const std::filesystem::path& rx_device, const std::optional<std::filesystem::path>& tx_device,
+             double gap_threshold, std::optional<double> duration, bool changes_only,
+             bool stats, OutputFormat format, RegisterMapWatcher* registers) {
+  try {
+    SerialPort rx(rx_device);
+    std::optional<SerialPort> tx;
+    // Live output is flushed line by line so that each frame shows up as soon as it is decoded.
+    TextBuffer line;
+    RegisterMirror mirror;
+    mirror.Subscribe([&line](const RegisterChange& change) {
+      DescribeChange(change, line);
+      line.Append('\n');
+      line.WriteTo(std::cout);
+      std::cout.flush();
+    });
+    TransactionCorrelator correlator;
+    std::optional<RecordWriter> records;
+    if (format != OutputFormat::kText) {
+      records.emplace(format);
+    }
+    // Reading, framing and decoding run on separate threads (fujitsu/pipeline.h), so output
+    // that blocks on a slow terminal never holds up reading the serial devices.
+    PipelineOptions options;
+    options.gap_threshold = gap_threshold;
+    StagedPipeline pipeline(
+        [&](const Frame& frame, const std::optional<Message>&) {
+          if (stats) {
+            correlator.Push(frame);
+          }
+          if (changes_only) {
+            ApplyFrame(frame, mirror);
+            return;
+          }
+          if (records) {
+            records->Write(frame);
+            records->Flush();
+            std::cout.flush();
+            return;
+          }
+          DescribeFrame(frame, line);
+          line.Append('\n');
+          line.WriteTo(std::cout);
+          std::cout.flush();
+        },
+        options);
+    BusMonitor monitor(
+        [&pipeline](std::span<const ByteEvent> events, double now) {
+          pipeline.Push(events);
+          pipeline.Advance(now);
+        },
+        gap_threshold);
+    monitor.AddSource(rx, BusDirection::Rx);
+    if (tx_device) {
+      tx.emplace(*tx_device);
+      monitor.AddSource(*tx, BusDirection::Tx);
+    }
 
-  switch (frame.type) {
-    case Frame::Type::Break:
-      os << "BREAK";
-      break;
-    case Frame::Type::Raw:
-      os << "RAW " << FormatByteVector(frame.bytes);
-      break;
-    case Frame::Type::Packet: {
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+    double deadline = duration ? MonotonicSeconds() + *duration : 0.0;
+    while (!g_stop_requested && (!duration || MonotonicSeconds() < deadline)) {
+      if (!monitor.Poll(std::chrono::milliseconds(100))) {
+        break;
+      }
       std::string error;
-      auto packet = ParsePacket(frame.bytes, &error);
-      if (!packet) {
-        os << "PACKET(parse error: " << error << ") raw=" << FormatByteVector(frame.bytes);
-      } else {
-        DescribePacket(frame, *packet, os);
+      if (registers && registers->Poll(&error)) {
+        std::cerr << "Reloaded register definitions from " << registers->path() << '\n';
+      } else if (!error.empty()) {
+        std::cerr << "Keeping previous register definitions: " << error << '\n';
       }
-      break;
     }
+    monitor.Finish();
+    pipeline.Finish();
+
+    const auto& pipeline_stats = pipeline.stats();
+    const auto& latency = pipeline_stats.latency;
+    std::cerr << latency.frames << " frames, delivery latency mean "
+              << latency.mean_seconds() * 1000.0 << " ms, max " << latency.max_seconds * 1000.0
+              << " ms; queue full waits: " << pipeline_stats.bytes.full_waits << " bytes, "
+              << pipeline_stats.frames.full_waits << " frames\n";
+    if (stats) {
+      correlator.Finish();
+      PrintStats(correlator.stats(), correlator.invalid_packets(), std::cerr);
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << "Error reading " << rx_device << ": " << ex.what() << '\n';
+    return 2;
   }
+  return 0;
 }
 
 }  // namespace
 
 int main(int argc, char* argv[]) {
   double gap_threshold = kDefaultGapThreshold;
+  std::size_t jobs = 1;
+  std::optional<double> chunk_seconds;
+  std::optional<std::filesystem::path> live_rx;
+  std::optional<std::filesystem::path> live_tx;
+  std::optional<double> duration;
+  bool changes_only = false;
+  bool stats = false;
+  bool metrics = false;
+  std::optional<std::filesystem::path> register_file;
+  OutputFormat format = OutputFormat::kText;
   std::vector<std::filesystem::path> paths;
 
   for (int i = 1; i < argc; ++i) {
@@ -174,32 +632,112 @@ int main(int argc, char* argv[]) {
       gap_threshold = std::stod(argv[++i]);
       continue;
     }
+    if (arg == "--jobs" && i + 1 < argc) {
+      jobs = std::max(1, std::stoi(argv[++i]));
+      continue;
+    }
+    if (arg == "--chunk" && i + 1 < argc) {
+      chunk_seconds = std::stod(argv[++i]);
+      continue;
+    }
+    if (arg == "--live" && i + 1 < argc) {
+      live_rx = argv[++i];
+      continue;
+    }
+    if (arg == "--live-tx" && i + 1 < argc) {
+      live_tx = argv[++i];
+      continue;
+    }
+    if (arg == "--duration" && i + 1 < argc) {
+      duration = std::stod(argv[++i]);
+      continue;
+    }
+    if (arg == "--registers" && i + 1 < argc) {
+      register_file = argv[++i];
+      continue;
+    }
+    if (arg == "--format" && i + 1 < argc) {
+      std::string name = argv[++i];
+      if (name == "text") {
+        format = OutputFormat::kText;
+      } else if (name == "ndjson") {
+        format = OutputFormat::kNdjson;
+      } else if (name == "binary") {
+        format = OutputFormat::kBinary;
+      } else {
+        std::cerr << "Unknown output format: " << name << '\n';
+        return 1;
+      }
+      continue;
+    }
+    if (arg == "--stats") {
+      stats = true;
+      continue;
+    }
+    if (arg == "--changes") {
+      changes_only = true;
+      continue;
+    }
+    if (arg == "--metrics") {
+      metrics = true;
+      continue;
+    }
     paths.emplace_back(arg);
   }
 
-  if (paths.empty()) {
-    PrintUsage(argv[0]);
+  if (format != OutputFormat::kText && (changes_only || (stats && !live_rx))) {
+    std::cerr << "--format applies to frame output and cannot be combined with --changes"
+              << (live_rx ? "" : " or --stats") << '\n';
     return 1;
   }
 
-  for (std::size_t idx = 0; idx < paths.size(); ++idx) {
-    const auto& path = paths[idx];
+  if (metrics && !kMetricsEnabled) {
+    std::cerr << "--metrics is unavailable: built with FUJITSU_METRICS=OFF\n";
+    return 1;
+  }
+
+  std::optional<RegisterMapWatcher> registers;
+  if (register_file) {
     try {
-      FrameSet frames = LoadCapture(path, gap_threshold);
-      std::cout << "== " << path << " ==\n";
-      for (const auto& frame : frames.frames) {
-        DescribeFrame(frame, std::cout);
-        std::cout << '\n';
-      }
-      if (idx + 1 < paths.size()) {
-        std::cout << '\n';
-      }
+      registers.emplace(*register_file);
     } catch (const std::exception& ex) {
-      std::cerr << "Error processing " << path << ": " << ex.what() << '\n';
+      std::cerr << "Error loading register definitions: " << ex.what() << '\n';
       return 2;
     }
   }
 
-  return 0;
-}
+  if (!live_rx && paths.empty()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
 
+  double started = MonotonicSeconds();
+  auto run = [&]() -> int {
+    if (live_rx) {
+      return DumpLive(*live_rx, live_tx, gap_threshold, duration, changes_only, stats, format,
+                      registers ? &*registers : nullptr);
+    }
+
+    if (stats) {
+      return DumpStats(paths, gap_threshold);
+    }
+    if (changes_only) {
+      return DumpChanges(paths, gap_threshold);
+    }
+    if (format != OutputFormat::kText) {
+      return DumpRecords(paths, gap_threshold, format);
+    }
+    if (jobs <= 1) {
+      return DumpSequential(paths, gap_threshold);
+    }
+    if (chunk_seconds) {
+      return DumpChunksParallel(paths, gap_threshold, jobs, *chunk_seconds);
+    }
+    return DumpFilesParallel(paths, gap_threshold, jobs);
+  };
+  int status = run();
+  if (metrics) {
+    PrintMetrics(SnapshotMetrics(), MonotonicSeconds() - started, std::cerr);
+  }
+  return status;
+}
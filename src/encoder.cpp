@@ -0,0 +1,55 @@
+#include "fujitsu/encoder.h"
+
+namespace fujitsu::airstage {
+
+namespace {
+
+constexpr uint16_t kSetpointRegister = 0x1002;
+
+void PutBigEndian(uint8_t* out, uint16_t value) {
+  out[0] = static_cast<uint8_t>(value >> 8);
+  out[1] = static_cast<uint8_t>(value & 0xFF);
+}
+
+}  // namespace
+
+std::size_t EncodeReadRequest(std::span<const uint16_t> addresses, std::span<uint8_t> out) {
+  if (addresses.empty() || addresses.size() > kMaxReadAddresses) {
+    return 0;
+  }
+  std::array<uint8_t, kMaxReadAddresses * 2> payload;
+  for (std::size_t i = 0; i < addresses.size(); ++i) {
+    PutBigEndian(&payload[i * 2], addresses[i]);
+  }
+  return EncodePacket(static_cast<uint32_t>(CommandId::kReadRegisters),
+                      std::span<const uint8_t>(payload.data(), addresses.size() * 2), out);
+}
+
+std::size_t EncodeWriteRequest(CommandId command, std::span<const RegisterValue> values,
+                               std::span<uint8_t> out) {
+  if (values.empty() || values.size() > kMaxWriteValues) {
+    return 0;
+  }
+  std::array<uint8_t, kMaxWriteValues * 4> payload;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    PutBigEndian(&payload[i * 4], values[i].address);
+    PutBigEndian(&payload[i * 4 + 2], values[i].value);
+  }
+  return EncodePacket(static_cast<uint32_t>(command),
+                      std::span<const uint8_t>(payload.data(), values.size() * 4), out);
+}
+
+std::size_t EncodeSetpoint(uint16_t tenths_celsius, std::span<uint8_t> out) {
+  RegisterValue value{kSetpointRegister, tenths_celsius};
+  return EncodeWriteRequest(CommandId::kSetpoint, std::span(&value, 1), out);
+}
+
+std::size_t EncodeControlWrite(RegisterValue value, std::span<uint8_t> out) {
+  return EncodeWriteRequest(CommandId::kControlRegister, std::span(&value, 1), out);
+}
+
+std::size_t EncodeBulkWrite(std::span<const RegisterValue> values, std::span<uint8_t> out) {
+  return EncodeWriteRequest(CommandId::kBulkWrite, values, out);
+}
+
+}  // namespace fujitsu::airstage
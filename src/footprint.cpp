@@ -0,0 +1,244 @@
+// Exercises the embedded core (FUJITSU_EMBEDDED=ON) the way module firmware would: frames a
+// byte stream of indoor unit requests, decodes them, encodes the answers and frames those
+// again, all with the C allocator intercepted. Exits with 1 if anything allocated and with 2 if
+// allocations cannot be counted.
+
+#include "fujitsu/classifier.h"
+#include "fujitsu/encoder.h"
+#include "fujitsu/framer.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <utility>
+#include <variant>
+
+#if !FUJITSU_EMBEDDED
+#error "fujitsu_footprint is built only with FUJITSU_EMBEDDED=ON"
+#endif
+
+using fujitsu::airstage::BusDirection;
+using fujitsu::airstage::Classify;
+using fujitsu::airstage::EncodeBulkWrite;
+using fujitsu::airstage::EncodeControlWrite;
+using fujitsu::airstage::EncodePacket;
+using fujitsu::airstage::EncodeReadRequest;
+using fujitsu::airstage::EncodeSetpoint;
+using fujitsu::airstage::FrameBuffer;
+using fujitsu::airstage::Framer;
+using fujitsu::airstage::FrameType;
+using fujitsu::airstage::FrameView;
+using fujitsu::airstage::kMaxPayloadBytes;
+using fujitsu::airstage::ParsePacketView;
+using fujitsu::airstage::ReadRequestView;
+using fujitsu::airstage::ReadResponseView;
+using fujitsu::airstage::RegisterValue;
+using fujitsu::airstage::WriteRequestView;
+using fujitsu::airstage::WriteResponse;
+
+namespace {
+bool g_counting = false;
+std::size_t g_allocations = 0;
+}  // namespace
+
+// glibc exports its allocator under these names as well, so replacing malloc and friends here
+// (operator new sits on top of malloc) sees every heap allocation in the process.
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* pointer, std::size_t size);
+void __libc_free(void* pointer);
+
+void* malloc(std::size_t size) {
+  g_allocations += g_counting;
+  return __libc_malloc(size);
+}
+void* calloc(std::size_t count, std::size_t size) {
+  g_allocations += g_counting;
+  return __libc_calloc(count, size);
+}
+void* realloc(void* pointer, std::size_t size) {
+  g_allocations += g_counting;
+  return __libc_realloc(pointer, size);
+}
+void free(void* pointer) { __libc_free(pointer); }
+}
+#endif
+
+namespace {
+
+constexpr double kByteSeconds = 10.0 / 9600.0;  // one 8N1 byte at 9600 baud
+constexpr std::size_t kRounds = 200;
+
+// A polling cycle as the indoor unit sends it, followed by a line glitch.
+struct Traffic {
+  std::array<uint8_t, 4 * sizeof(FrameBuffer)> bytes{};
+  std::size_t size = 0;
+
+  void Append(std::span<const uint8_t> frame) {
+    for (uint8_t value : frame) {
+      bytes[size++] = value;
+    }
+  }
+};
+
+Traffic BuildTraffic() {
+  Traffic traffic;
+  FrameBuffer frame{};
+  static constexpr uint16_t kAddresses[] = {0x1000, 0x1001, 0x1002, 0x1003, 0x1020, 0x1021};
+  traffic.Append(std::span(frame).first(EncodeReadRequest(kAddresses, frame)));
+  traffic.Append(std::span(frame).first(EncodeSetpoint(225, frame)));
+  traffic.Append(std::span(frame).first(EncodeControlWrite(RegisterValue{0x1001, 2}, frame)));
+  static constexpr RegisterValue kValues[] = {{0x1000, 1}, {0x1002, 3}};
+  std::size_t length = EncodeBulkWrite(kValues, frame);
+  frame[length - 1] ^= 0x5A;  // corrupt the checksum
+  traffic.Append(std::span(frame).first(length));
+  static constexpr uint8_t kBreak[] = {0xFF, 0xFF, 0x00, 0x00};
+  traffic.Append(kBreak);
+  return traffic;
+}
+
+struct Totals {
+  std::size_t frames = 0;
+  std::size_t raw_frames = 0;
+  std::size_t messages = 0;
+  std::size_t answers = 0;
+  uint32_t checksum = 0;  // of decoded values, so that nothing is optimised away
+};
+
+// Module side: answers each request on the TX line, which loops back into `tx`.
+class Module {
+ public:
+  explicit Module(Totals& totals) : totals_(totals) {}
+
+  void OnRequest(const FrameView& frame) {
+    Count(frame);
+    auto packet = frame.type == FrameType::Packet ? ParsePacketView(frame.bytes) : std::nullopt;
+    if (!packet) {
+      return;
+    }
+    auto message = Classify(*packet, frame.direction);
+    ++totals_.messages;
+    std::array<uint8_t, kMaxPayloadBytes> payload{};
+    std::size_t payload_length = 0;
+    if (const auto* read = std::get_if<ReadRequestView>(&message)) {
+      payload[payload_length++] = 0;  // status
+      for (uint16_t address : read->addresses) {
+        auto value = static_cast<uint16_t>(address ^ 0x00A5);
+        payload[payload_length++] = static_cast<uint8_t>(address >> 8);
+        payload[payload_length++] = static_cast<uint8_t>(address);
+        payload[payload_length++] = static_cast<uint8_t>(value >> 8);
+        payload[payload_length++] = static_cast<uint8_t>(value);
+      }
+    } else if (const auto* write = std::get_if<WriteRequestView>(&message)) {
+      payload[payload_length++] = 0;
+      for (RegisterValue entry : write->values) {
+        totals_.checksum += entry.address + entry.value;
+      }
+    } else {
+      return;
+    }
+    // Answers carry the command id of the request.
+    answer_length_ =
+        EncodePacket(packet->command_id, std::span(payload).first(payload_length), answer_);
+  }
+
+  void OnAnswer(const FrameView& frame) {
+    Count(frame);
+    auto message = Classify(frame);
+    if (!message) {
+      return;
+    }
+    ++totals_.answers;
+    if (const auto* read = std::get_if<ReadResponseView>(&*message)) {
+      for (RegisterValue entry : read->values) {
+        totals_.checksum += entry.address + entry.value;
+      }
+    } else if (const auto* write = std::get_if<WriteResponse>(&*message)) {
+      totals_.checksum += write->status;
+    }
+  }
+
+  [[nodiscard]] std::span<const uint8_t> TakeAnswer() {
+    return std::span<const uint8_t>(answer_).first(std::exchange(answer_length_, 0));
+  }
+
+ private:
+  void Count(const FrameView& frame) {
+    ++totals_.frames;
+    totals_.raw_frames += frame.type == FrameType::Raw;
+  }
+
+  Totals& totals_;
+  FrameBuffer answer_{};
+  std::size_t answer_length_ = 0;
+};
+
+// Frames and answers the traffic for kRounds cycles. The framers are built here, inside the
+// caller's counting window, so that their callbacks are covered too.
+void Run(const Traffic& traffic, Totals& totals) {
+  Module module(totals);
+  Framer rx(BusDirection::Rx, [&module](const FrameView& frame) { module.OnRequest(frame); });
+  Framer tx(BusDirection::Tx, [&module](const FrameView& frame) { module.OnAnswer(frame); });
+
+  double time = 0.0;
+  for (std::size_t round = 0; round < kRounds; ++round) {
+    for (std::size_t i = 0; i < traffic.size; ++i) {
+      rx.Push(traffic.bytes[i], time);
+      time += kByteSeconds;
+      auto answer = module.TakeAnswer();
+      for (uint8_t value : answer) {
+        tx.Push(value, time);
+        time += kByteSeconds;
+      }
+      if (!answer.empty()) {
+        tx.Flush();
+      }
+    }
+    rx.Flush();
+    time += 0.1;
+  }
+}
+
+}  // namespace
+
+int main() {
+#if !defined(__GLIBC__)
+  std::printf("allocations:   cannot be counted without glibc\n");
+  return 2;
+#else
+  // Positive control: one allocation the compiler cannot elide must reach the counter.
+  void* (*volatile allocate)(std::size_t) = std::malloc;
+  g_counting = true;
+  std::free(allocate(16));
+  g_counting = false;
+  if (g_allocations != 1) {
+    std::printf("allocations:   interception not working (control counted %zu)\n",
+                g_allocations);
+    return 2;
+  }
+  g_allocations = 0;
+
+  Traffic traffic = BuildTraffic();
+  Totals totals;
+  g_counting = true;
+  Run(traffic, totals);
+  g_counting = false;
+
+  std::printf("rounds:        %zu (%zu bytes each)\n", kRounds, traffic.size);
+  std::printf("frames:        %zu (%zu raw)\n", totals.frames, totals.raw_frames);
+  std::printf("messages:      %zu requests, %zu answers\n", totals.messages, totals.answers);
+  std::printf("value sum:     %u\n", static_cast<unsigned>(totals.checksum));
+  std::printf("sizeof Framer: %zu bytes\n", sizeof(Framer));
+  std::printf("sizeof Module: %zu bytes\n", sizeof(Module));
+  std::printf("allocations:   %zu\n", g_allocations);
+  return g_allocations == 0 ? 0 : 1;
+#endif
+}
@@ -0,0 +1,138 @@
+#include "fujitsu/framer.h"
+
+#include "fujitsu/metrics.h"
+
+#include <utility>
+
+namespace fujitsu::airstage {
+
+Framer::Framer(BusDirection direction, FrameViewCallback on_frame, double gap_threshold)
+    : direction_(direction), on_frame_view_(std::move(on_frame)), gap_threshold_(gap_threshold) {}
+
+#if !FUJITSU_EMBEDDED
+Framer::Framer(BusDirection direction, FrameCallback on_frame, double gap_threshold)
+    : direction_(direction), on_frame_(std::move(on_frame)), gap_threshold_(gap_threshold) {}
+#endif
+
+void Framer::Push(uint8_t value, double time) {
+  if (last_time_.has_value()) {
+    double delta = time - *last_time_;
+    if (delta > gap_threshold_ && pending() != 0) {
+      ParseAvailable(/*final_flush=*/true);
+    }
+  }
+  last_time_ = time;
+
+  std::size_t slot = tail_ % kCapacity;
+  values_[slot] = value;
+  times_[slot] = time;
+  sums_before_[slot] = running_sum_;
+  running_sum_ = static_cast<uint16_t>(running_sum_ + value);
+  ++tail_;
+
+  ParseAvailable(/*final_flush=*/false);
+}
+
+void Framer::Flush() {
+  ParseAvailable(/*final_flush=*/true);
+}
+
+void Framer::Expire(double now) {
+  if (pending() != 0 && last_time_.has_value() && now - *last_time_ > gap_threshold_) {
+    ParseAvailable(/*final_flush=*/true);
+  }
+}
+
+uint16_t Framer::SumBefore(std::size_t offset) const {
+  std::size_t index = head_ + offset;
+  return index == tail_ ? running_sum_ : sums_before_[index % kCapacity];
+}
+
+bool Framer::HeadChecksumMatches(std::size_t total_length) const {
+  std::size_t body_length = total_length - kPacketTrailerBytes;
+  // The sums wrap modulo 2^16 exactly like the checksum, so the difference of two prefixes is
+  // the checksum input for the candidate.
+  auto sum = static_cast<uint16_t>(SumBefore(body_length) - SumBefore(0));
+  auto expected = static_cast<uint16_t>(0xFFFF - sum);
+  auto actual = static_cast<uint16_t>((At(body_length) << 8) | At(body_length + 1));
+  return expected == actual;
+}
+
+void Framer::Emit(FrameType type, std::size_t length) {
+  double start_time = times_[head_ % kCapacity];
+  double end_time = times_[(head_ + length - 1) % kCapacity];
+  switch (type) {
+    case FrameType::Packet:
+      CountMetric(MetricCounter::kPacketFrames);
+      CountPacketFrame(static_cast<uint32_t>(At(0)) | (static_cast<uint32_t>(At(1)) << 8) |
+                       (static_cast<uint32_t>(At(2)) << 16) |
+                       (static_cast<uint32_t>(At(3)) << 24));
+      break;
+    case FrameType::Break:
+      CountMetric(MetricCounter::kBreakFrames);
+      break;
+    case FrameType::Raw:
+      CountMetric(MetricCounter::kRawFrames);
+      CountMetric(MetricCounter::kRawBytes, length);
+      break;
+  }
+#if !FUJITSU_EMBEDDED
+  if (on_frame_) {
+    Frame frame;
+    frame.type = type;
+    frame.direction = direction_;
+    frame.start_time = start_time;
+    frame.end_time = end_time;
+    frame.bytes.reserve(length);
+    for (std::size_t i = 0; i < length; ++i) {
+      frame.bytes.push_back(At(i));
+    }
+    head_ += length;
+    on_frame_(std::move(frame));
+    return;
+  }
+#endif
+  for (std::size_t i = 0; i < length; ++i) {
+    view_bytes_[i] = At(i);
+  }
+  head_ += length;
+  on_frame_view_(FrameView{type, direction_, start_time, end_time,
+                           std::span<const uint8_t>(view_bytes_.data(), length)});
+}
+
+void Framer::ParseAvailable(bool final_flush) {
+  while (pending() != 0) {
+    // Break frame detection
+    if (pending() >= 4 && At(0) == 0xFF && At(1) == 0xFF && At(2) == 0x00 && At(3) == 0x00) {
+      Emit(FrameType::Break, 4);
+      continue;
+    }
+
+    if (pending() < kPacketHeaderBytes) {
+      if (final_flush) {
+        Emit(FrameType::Raw, pending());
+      }
+      break;
+    }
+
+    uint8_t payload_length = At(4);
+    std::size_t total_length = kPacketHeaderBytes + payload_length + kPacketTrailerBytes;
+    if (pending() < total_length) {
+      if (final_flush) {
+        Emit(FrameType::Raw, pending());
+      }
+      break;
+    }
+
+    if (!HeadChecksumMatches(total_length)) {
+      // Unable to decode a packet at the buffer head. Emit the first byte as raw and retry.
+      CountMetric(MetricCounter::kResyncChecksumMisses);
+      Emit(FrameType::Raw, 1);
+      continue;
+    }
+
+    Emit(FrameType::Packet, total_length);
+  }
+}
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,375 @@
+#include "fujitsu/logic_capture.h"
+
+#include "fujitsu/zip_archive.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+constexpr char kSaleaeMagic[8] = {'<', 'S', 'A', 'L', 'E', 'A', 'E', '>'};
+constexpr int32_t kSaleaeVersion = 2;
+constexpr int32_t kSaleaeDigitalType = 100;
+constexpr std::size_t kSaleaeRateOffset = 17;
+constexpr std::size_t kSaleaeChunkCountOffset = 43;
+constexpr std::size_t kSaleaeHeaderBytes = 51;
+constexpr std::size_t kSaleaeChunkHeaderBytes = 26;
+
+// Baud detection: spans between same-polarity edges are bucketed per eighth of an octave, and
+// each bucket holding at least 2% of them yields candidate bit times of its mean divided by 1
+// to 3. Spans of up to 12 bits within a quarter bit of a whole number of bits count towards a
+// candidate.
+constexpr std::size_t kBaudBinsPerOctave = 8;
+constexpr double kBaudCandidateShare = 0.02;
+constexpr double kMaxCandidateDivisor = 3.0;
+constexpr double kMaxSpanBits = 12.0;
+constexpr double kBaudBitTolerance = 0.25;
+constexpr double kBaudRefineTolerance = 0.05;
+constexpr std::size_t kMinBaudRuns = 16;
+constexpr double kBaudSnapTolerance = 0.03;
+constexpr std::array<double, 15> kStandardBauds = {300,    600,    1200,   2400,   4800,
+                                                   9600,   14400,  19200,  28800,  38400,
+                                                   57600,  115200, 230400, 460800, 921600};
+
+template <typename T>
+T GetLittleEndian(const uint8_t* in) {
+  uint64_t bits = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    bits |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  if constexpr (std::is_floating_point_v<T>) {
+    return std::bit_cast<T>(bits);
+  } else {
+    return static_cast<T>(bits);
+  }
+}
+
+std::runtime_error Malformed(const std::string& what) {
+  return std::runtime_error("malformed Saleae digital channel: " + what);
+}
+
+// Decodes one interval code; returns the interval length in samples.
+uint64_t GetIntervalCode(const uint8_t** pos, const uint8_t* end) {
+  uint8_t byte = *(*pos)++;
+  uint64_t value = byte & 0x3F;
+  bool more = (byte & 0x40) != 0;
+  while (more) {
+    if (*pos == end || value >> 57 != 0) {
+      throw Malformed("truncated interval code");
+    }
+    byte = *(*pos)++;
+    value = value << 7 | (byte & 0x7F);
+    more = (byte & 0x80) != 0;
+  }
+  return value + 1;
+}
+
+}  // namespace
+
+DigitalChannel ParseSaleaeDigital(std::span<const uint8_t> bytes) {
+  if (bytes.size() < kSaleaeHeaderBytes ||
+      std::memcmp(bytes.data(), kSaleaeMagic, sizeof(kSaleaeMagic)) != 0) {
+    throw Malformed("bad magic");
+  }
+  if (GetLittleEndian<int32_t>(bytes.data() + 8) != kSaleaeVersion ||
+      GetLittleEndian<int32_t>(bytes.data() + 12) != kSaleaeDigitalType) {
+    throw Malformed("unsupported version or channel type");
+  }
+
+  DigitalChannel channel;
+  channel.sample_rate = GetLittleEndian<double>(bytes.data() + kSaleaeRateOffset);
+  if (!(channel.sample_rate > 0.0)) {
+    throw Malformed("bad sample rate");
+  }
+  auto chunk_count = GetLittleEndian<uint64_t>(bytes.data() + kSaleaeChunkCountOffset);
+
+  const uint8_t* pos = bytes.data() + kSaleaeHeaderBytes;
+  const uint8_t* const end = bytes.data() + bytes.size();
+  bool level = true;
+  for (uint64_t chunk = 0; chunk < chunk_count; ++chunk) {
+    if (end - pos < static_cast<std::ptrdiff_t>(kSaleaeChunkHeaderBytes)) {
+      throw Malformed("truncated chunk header");
+    }
+    auto first_sample = GetLittleEndian<uint64_t>(pos);
+    auto end_sample = GetLittleEndian<uint64_t>(pos + 8);
+    bool level_after_first = pos[16] != 0;
+    auto size = GetLittleEndian<uint64_t>(pos + 18);
+    pos += kSaleaeChunkHeaderBytes;
+    if (static_cast<uint64_t>(end - pos) < size) {
+      throw Malformed("truncated chunk");
+    }
+    if (chunk == 0) {
+      level = !level_after_first;
+      channel.initial_level = level;
+    } else if (first_sample != channel.end_sample || level_after_first == level) {
+      throw Malformed("discontinuous chunks");
+    }
+
+    const uint8_t* const chunk_end = pos + size;
+    bool last_chunk = chunk + 1 == chunk_count;
+    uint64_t sample = first_sample;
+    while (pos != chunk_end) {
+      sample += GetIntervalCode(&pos, chunk_end);
+      if (sample > end_sample) {
+        throw Malformed("interval past end of chunk");
+      }
+      if (pos == chunk_end && last_chunk) {
+        break;  // the final interval ends with the recording, not with an edge
+      }
+      channel.edges.push_back(sample);
+      level = !level;
+    }
+    if (sample != end_sample) {
+      throw Malformed("intervals do not cover chunk");
+    }
+    channel.end_sample = end_sample;
+  }
+  return channel;
+}
+
+std::map<int, DigitalChannel> ReadSaleaeChannels(const std::filesystem::path& path) {
+  return ReadSaleaeChannels(MappedFile(path));
+}
+
+std::map<int, DigitalChannel> ReadSaleaeChannels(MappedFile file) {
+  ZipArchive archive(std::move(file));
+  std::map<int, DigitalChannel> channels;
+  constexpr std::string_view kPrefix = "digital-";
+  constexpr std::string_view kSuffix = ".bin";
+  for (const auto& name : archive.names()) {
+    std::string_view view = name;
+    if (!view.starts_with(kPrefix) || !view.ends_with(kSuffix)) {
+      continue;
+    }
+    std::string_view number =
+        view.substr(kPrefix.size(), view.size() - kPrefix.size() - kSuffix.size());
+    if (number.empty() || !std::all_of(number.begin(), number.end(),
+                                       [](char c) { return c >= '0' && c <= '9'; })) {
+      continue;
+    }
+    auto contents = archive.Read(name);
+    channels.emplace(std::stoi(std::string(number)), ParseSaleaeDigital(*contents));
+  }
+  return channels;
+}
+
+std::optional<double> DetectBaudRate(const DigitalChannel& channel) {
+  if (channel.edges.size() <= kMinBaudRuns) {
+    return std::nullopt;
+  }
+  // Edges of the same polarity are a whole number of bits apart within a byte. Slow rise or
+  // fall times lengthen one level at the expense of the other, which skews the runs between
+  // adjacent edges but cancels out here.
+  std::vector<uint64_t> spans;
+  spans.reserve(channel.edges.size() - 2);
+  for (std::size_t i = 2; i < channel.edges.size(); ++i) {
+    spans.push_back(channel.edges[i] - channel.edges[i - 2]);
+  }
+
+  // Common span lengths, bucketed on a log scale, are candidate multiples of the bit time.
+  struct Bin {
+    double total = 0.0;
+    std::size_t count = 0;
+  };
+  std::array<Bin, 64 * kBaudBinsPerOctave> bins{};
+  for (uint64_t span : spans) {
+    auto index =
+        static_cast<std::size_t>(std::log2(static_cast<double>(span)) * kBaudBinsPerOctave);
+    bins[index].total += static_cast<double>(span);
+    ++bins[index].count;
+  }
+
+  // A candidate bit time scores one point for every span that is a whole number of bits long.
+  // Glitches fit no candidate, while every span of real traffic fits the true bit time, which
+  // therefore wins even on lines that are mostly noise.
+  auto multiple = [](uint64_t span, double bit, double tolerance) -> std::optional<double> {
+    double bits = std::round(static_cast<double>(span) / bit);
+    if (bits < 1.0 || bits > kMaxSpanBits ||
+        std::abs(static_cast<double>(span) - bits * bit) > tolerance * bit) {
+      return std::nullopt;
+    }
+    return bits;
+  };
+  double best_bit = 0.0;
+  std::size_t best_score = 0;
+  auto min_count = std::max<std::size_t>(
+      kMinBaudRuns, static_cast<std::size_t>(static_cast<double>(spans.size()) * kBaudCandidateShare));
+  for (const Bin& bin : bins) {
+    if (bin.count < min_count) {
+      continue;
+    }
+    for (double divisor = 1.0; divisor <= kMaxCandidateDivisor; ++divisor) {
+      double bit = bin.total / static_cast<double>(bin.count) / divisor;
+      auto score = static_cast<std::size_t>(std::count_if(
+          spans.begin(), spans.end(),
+          [&](uint64_t span) { return multiple(span, bit, kBaudBitTolerance).has_value(); }));
+      if (score > best_score || (score == best_score && bit > best_bit)) {
+        best_bit = bit;
+        best_score = score;
+      }
+    }
+  }
+  if (best_score < kMinBaudRuns) {
+    return std::nullopt;
+  }
+
+  // Refine over the spans that fit, then again over the ones that fit closely, which drops
+  // spans across the idle time some transmitters leave between bytes.
+  for (double tolerance : {kBaudBitTolerance, kBaudRefineTolerance}) {
+    double samples = 0.0;
+    double bits = 0.0;
+    for (uint64_t span : spans) {
+      if (auto count = multiple(span, best_bit, tolerance)) {
+        samples += static_cast<double>(span);
+        bits += *count;
+      }
+    }
+    if (bits > 0.0) {
+      best_bit = samples / bits;
+    }
+  }
+
+  double baud = channel.sample_rate / best_bit;
+  for (double standard : kStandardBauds) {
+    if (std::abs(baud - standard) <= standard * kBaudSnapTolerance) {
+      return standard;
+    }
+  }
+  return baud;
+}
+
+UartDecoder::UartDecoder(const DigitalChannel& channel, BusDirection direction,
+                         const UartSettings& settings)
+    : channel_(&channel), direction_(direction), settings_(settings) {
+  if (settings.data_bits < 5 || settings.data_bits > 8) {
+    throw std::runtime_error("UART data bits must be between 5 and 8");
+  }
+  baud_ = settings.baud;
+  if (baud_ <= 0.0) {
+    auto detected = DetectBaudRate(channel);
+    if (!detected) {
+      throw std::runtime_error("cannot detect UART baud rate: too few transitions");
+    }
+    baud_ = *detected;
+  }
+  bit_samples_ = channel.sample_rate / baud_;
+}
+
+bool UartDecoder::LevelAt(double sample) {
+  const auto& edges = channel_->edges;
+  while (cursor_ < edges.size() && static_cast<double>(edges[cursor_]) <= sample) {
+    ++cursor_;
+  }
+  bool level = channel_->initial_level != ((cursor_ & 1) != 0);
+  return level != settings_.inverted;
+}
+
+bool UartDecoder::Next(ByteEvent* event) {
+  const auto& edges = channel_->edges;
+  const int parity_bits = settings_.parity == UartParity::kNone ? 0 : 1;
+  const double stop_offset = (1.5 + settings_.data_bits + parity_bits) * bit_samples_;
+  while (next_edge_ < edges.size()) {
+    std::size_t edge = next_edge_++;
+    bool level_after = channel_->initial_level != ((edge & 1) == 0);
+    if (level_after != settings_.inverted) {
+      continue;  // rising to mark: not a start bit
+    }
+
+    auto start = static_cast<double>(edges[edge]);
+    if (start + stop_offset > static_cast<double>(channel_->end_sample)) {
+      next_edge_ = edges.size();
+      return false;
+    }
+    cursor_ = edge + 1;
+    unsigned value = 0;
+    for (int bit = 0; bit < settings_.data_bits; ++bit) {
+      value |= static_cast<unsigned>(LevelAt(start + (1.5 + bit) * bit_samples_)) << bit;
+    }
+    bool error = false;
+    if (parity_bits != 0) {
+      bool parity = LevelAt(start + (1.5 + settings_.data_bits) * bit_samples_);
+      bool odd = (std::popcount(value) & 1) != static_cast<int>(parity);
+      error = odd != (settings_.parity == UartParity::kOdd);
+    }
+    error |= !LevelAt(start + stop_offset);
+    next_edge_ = cursor_;
+
+    event->direction = direction_;
+    event->time = start / channel_->sample_rate;
+    event->value = static_cast<uint8_t>(value);
+    event->has_error = error;
+    return true;
+  }
+  return false;
+}
+
+void ReadSaleaeEvents(MappedFile file, const ByteEventCallback& on_event) {
+  std::map<int, DigitalChannel> channels = ReadSaleaeChannels(std::move(file));
+  struct Line {
+    const DigitalChannel* channel;
+    BusDirection direction;
+    std::optional<double> baud;
+  };
+  std::vector<Line> lines;
+  std::optional<double> any_baud;
+  for (auto [number, direction] :
+       {std::pair{0, BusDirection::Rx}, std::pair{1, BusDirection::Tx}}) {
+    auto it = channels.find(number);
+    if (it != channels.end()) {
+      lines.push_back(Line{&it->second, direction, DetectBaudRate(it->second)});
+      any_baud = any_baud ? any_baud : lines.back().baud;
+    }
+  }
+  if (lines.empty()) {
+    throw std::runtime_error("Saleae capture has neither channel 0 nor channel 1");
+  }
+  if (!any_baud) {
+    throw std::runtime_error("cannot detect UART baud rate: too few transitions on any channel");
+  }
+  // Both lines run at the same rate, so a silent or barely active one borrows the other's.
+  std::vector<UartDecoder> decoders;
+  for (const Line& line : lines) {
+    UartSettings settings;
+    settings.baud = line.baud.value_or(*any_baud);
+    decoders.emplace_back(*line.channel, line.direction, settings);
+  }
+
+  // Two-way merge of the per-line byte streams; RX goes first on equal timestamps.
+  std::vector<std::optional<ByteEvent>> heads(decoders.size());
+  for (std::size_t i = 0; i < decoders.size(); ++i) {
+    ByteEvent event;
+    if (decoders[i].Next(&event)) {
+      heads[i] = event;
+    }
+  }
+  for (;;) {
+    std::optional<std::size_t> earliest;
+    for (std::size_t i = 0; i < heads.size(); ++i) {
+      if (heads[i] && (!earliest || heads[i]->time < heads[*earliest]->time)) {
+        earliest = i;
+      }
+    }
+    if (!earliest) {
+      return;
+    }
+    on_event(*heads[*earliest]);
+    ByteEvent event;
+    if (decoders[*earliest].Next(&event)) {
+      heads[*earliest] = event;
+    } else {
+      heads[*earliest].reset();
+    }
+  }
+}
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,83 @@
+#include "fujitsu/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("failed to open capture file: " + path.string());
+  }
+
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("failed to stat capture file: " + path.string());
+  }
+
+  size_ = static_cast<std::size_t>(info.st_size);
+  if (size_ != 0 && size_ < kReadThreshold) {
+    buffer_ = std::make_unique_for_overwrite<uint8_t[]>(size_);
+    std::size_t done = 0;
+    while (done < size_) {
+      ssize_t got = ::read(fd, buffer_.get() + done, size_ - done);
+      if (got < 0 && errno == EINTR) {
+        continue;
+      }
+      if (got <= 0) {
+        ::close(fd);
+        throw std::runtime_error("failed to read capture file: " + path.string());
+      }
+      done += static_cast<std::size_t>(got);
+    }
+    data_ = buffer_.get();
+  } else if (size_ != 0) {
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("failed to map capture file: " + path.string());
+    }
+    data_ = mapping;
+    ::madvise(data_, size_, MADV_SEQUENTIAL);
+  }
+  ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+  Reset();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      buffer_(std::move(other.buffer_)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Reset();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    buffer_ = std::move(other.buffer_);
+  }
+  return *this;
+}
+
+void MappedFile::Reset() {
+  if (buffer_) {
+    buffer_.reset();
+  } else if (data_ != nullptr) {
+    ::munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace fujitsu::airstage
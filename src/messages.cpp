@@ -1,6 +1,10 @@
 #include "fujitsu/messages.h"
 
+#include "fujitsu/metrics.h"
+
+#if !FUJITSU_EMBEDDED
 #include <sstream>
+#endif
 
 namespace fujitsu::airstage {
 
@@ -17,26 +21,23 @@ bool IsWriteCommand(uint32_t command_id) {
   }
 }
 
-}  // namespace
+template <typename T>
+std::optional<T> CountDecoded(std::optional<T> message) {
+  CountMetric(message ? MetricCounter::kMessagesDecoded : MetricCounter::kMessageDecodeFailures);
+  return message;
+}
 
-std::optional<ReadRequest> DecodeReadRequest(const Packet& packet) {
+std::optional<ReadRequestView> DecodeReadRequestPayload(const PacketView& packet) {
   if (packet.command_id != static_cast<uint32_t>(CommandId::kReadRegisters)) {
     return std::nullopt;
   }
   if (packet.payload.empty() || (packet.payload.size() % 2) != 0) {
     return std::nullopt;
   }
-
-  ReadRequest request;
-  request.addresses.reserve(packet.payload.size() / 2);
-  for (std::size_t i = 0; i < packet.payload.size(); i += 2) {
-    uint16_t address = static_cast<uint16_t>(packet.payload[i] << 8 | packet.payload[i + 1]);
-    request.addresses.push_back(address);
-  }
-  return request;
+  return ReadRequestView{AddressRange(packet.payload)};
 }
 
-std::optional<ReadResponse> DecodeReadResponse(const Packet& packet) {
+std::optional<ReadResponseView> DecodeReadResponsePayload(const PacketView& packet) {
   if (packet.command_id != static_cast<uint32_t>(CommandId::kReadRegisters)) {
     return std::nullopt;
   }
@@ -46,38 +47,20 @@ std::optional<ReadResponse> DecodeReadResponse(const Packet& packet) {
   if ((packet.payload.size() - 1) % 4 != 0) {
     return std::nullopt;
   }
-
-  ReadResponse response;
-  response.status = packet.payload[0];
-  response.values.reserve((packet.payload.size() - 1) / 4);
-  for (std::size_t i = 1; i < packet.payload.size(); i += 4) {
-    uint16_t address = static_cast<uint16_t>(packet.payload[i] << 8 | packet.payload[i + 1]);
-    uint16_t value = static_cast<uint16_t>(packet.payload[i + 2] << 8 | packet.payload[i + 3]);
-    response.values.push_back(RegisterValue{address, value});
-  }
-  return response;
+  return ReadResponseView{packet.payload[0], RegisterValueRange(packet.payload.subspan(1))};
 }
 
-std::optional<WriteRequest> DecodeWriteRequest(const Packet& packet) {
+std::optional<WriteRequestView> DecodeWriteRequestPayload(const PacketView& packet) {
   if (!IsWriteCommand(packet.command_id)) {
     return std::nullopt;
   }
-
   if (packet.payload.empty() || (packet.payload.size() % 4) != 0) {
     return std::nullopt;
   }
-
-  WriteRequest request;
-  request.values.reserve(packet.payload.size() / 4);
-  for (std::size_t i = 0; i < packet.payload.size(); i += 4) {
-    uint16_t address = static_cast<uint16_t>(packet.payload[i] << 8 | packet.payload[i + 1]);
-    uint16_t value = static_cast<uint16_t>(packet.payload[i + 2] << 8 | packet.payload[i + 3]);
-    request.values.push_back(RegisterValue{address, value});
-  }
-  return request;
+  return WriteRequestView{RegisterValueRange(packet.payload)};
 }
 
-std::optional<WriteResponse> DecodeWriteResponse(const Packet& packet) {
+std::optional<WriteResponse> DecodeWriteResponsePayload(const PacketView& packet) {
   if (!IsWriteCommand(packet.command_id)) {
     return std::nullopt;
   }
@@ -90,6 +73,58 @@ std::optional<WriteResponse> DecodeWriteResponse(const Packet& packet) {
   return response;
 }
 
+}  // namespace
+
+std::optional<ReadRequestView> DecodeReadRequestView(const PacketView& packet) {
+  ScopedMetricTimer timer(MetricTimer::kDecode, packet.payload.size());
+  return CountDecoded(DecodeReadRequestPayload(packet));
+}
+
+std::optional<ReadResponseView> DecodeReadResponseView(const PacketView& packet) {
+  ScopedMetricTimer timer(MetricTimer::kDecode, packet.payload.size());
+  return CountDecoded(DecodeReadResponsePayload(packet));
+}
+
+std::optional<WriteRequestView> DecodeWriteRequestView(const PacketView& packet) {
+  ScopedMetricTimer timer(MetricTimer::kDecode, packet.payload.size());
+  return CountDecoded(DecodeWriteRequestPayload(packet));
+}
+
+std::optional<WriteResponse> DecodeWriteResponse(const PacketView& packet) {
+  ScopedMetricTimer timer(MetricTimer::kDecode, packet.payload.size());
+  return CountDecoded(DecodeWriteResponsePayload(packet));
+}
+
+#if !FUJITSU_EMBEDDED
+
+std::optional<ReadRequest> DecodeReadRequest(const Packet& packet) {
+  auto view = DecodeReadRequestView(packet.view());
+  if (!view) {
+    return std::nullopt;
+  }
+  return ReadRequest{{view->addresses.begin(), view->addresses.end()}};
+}
+
+std::optional<ReadResponse> DecodeReadResponse(const Packet& packet) {
+  auto view = DecodeReadResponseView(packet.view());
+  if (!view) {
+    return std::nullopt;
+  }
+  return ReadResponse{view->status, {view->values.begin(), view->values.end()}};
+}
+
+std::optional<WriteRequest> DecodeWriteRequest(const Packet& packet) {
+  auto view = DecodeWriteRequestView(packet.view());
+  if (!view) {
+    return std::nullopt;
+  }
+  return WriteRequest{{view->values.begin(), view->values.end()}};
+}
+
+std::optional<WriteResponse> DecodeWriteResponse(const Packet& packet) {
+  return DecodeWriteResponse(packet.view());
+}
+
 std::string CommandToString(uint32_t command_id) {
   switch (command_id) {
     case static_cast<uint32_t>(CommandId::kHandshake0):
@@ -112,5 +147,7 @@ std::string CommandToString(uint32_t command_id) {
   }
 }
 
+#endif
+
 }  // namespace fujitsu::airstage
 
@@ -0,0 +1,246 @@
+#include "fujitsu/metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+constexpr std::array<const char*, kMetricCounterCount> kCounterNames = {
+    "capture_bytes",
+    "byte_events",
+    "byte_event_errors",
+    "capture_microseconds",
+    "packet_frames",
+    "break_frames",
+    "raw_frames",
+    "raw_bytes",
+    "resync_checksum_misses",
+    "validate_too_short",
+    "validate_length_mismatch",
+    "validate_checksum_mismatch",
+    "messages_decoded",
+    "message_decode_failures",
+};
+
+constexpr std::array<const char*, kMetricTimerCount> kTimerNames = {"capture", "validate",
+                                                                    "decode"};
+
+constexpr std::array<uint64_t, kMetricTimerCount> kSampleIntervals = {
+    1, kMetricTimerSampleInterval, kMetricTimerSampleInterval};
+
+}  // namespace
+
+const char* ToString(MetricCounter counter) {
+  return kCounterNames[static_cast<std::size_t>(counter)];
+}
+
+const char* ToString(MetricTimer timer) {
+  return kTimerNames[static_cast<std::size_t>(timer)];
+}
+
+double TimerSnapshot::mean_nanoseconds() const {
+  return samples == 0 ? 0.0
+                      : static_cast<double>(sampled_nanoseconds) / static_cast<double>(samples);
+}
+
+double TimerSnapshot::percentile_nanoseconds(double q) const {
+  if (samples == 0) {
+    return 0.0;
+  }
+  auto rank = static_cast<uint64_t>(q * static_cast<double>(samples - 1));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen > rank) {
+      return static_cast<double>(uint64_t{1} << (i + 1));
+    }
+  }
+  return static_cast<double>(uint64_t{1} << buckets.size());
+}
+
+double TimerSnapshot::bytes_per_second() const {
+  double seconds = mean_nanoseconds() * static_cast<double>(calls) * 1e-9;
+  return seconds <= 0.0 ? 0.0 : static_cast<double>(bytes) / seconds;
+}
+
+#if FUJITSU_METRICS
+
+namespace {
+
+// Every cell has a single writer, its owning thread, which updates it with a relaxed load and
+// store instead of a locked read-modify-write. Readers see each value whole, if slightly stale.
+using Cell = std::atomic<uint64_t>;
+
+void Bump(Cell& cell, uint64_t amount) {
+  cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct TimerCells {
+  Cell calls{0};
+  Cell samples{0};
+  Cell sampled_nanoseconds{0};
+  Cell bytes{0};
+  std::array<Cell, kMetricHistogramBuckets> buckets{};
+};
+
+struct MetricCells {
+  std::array<Cell, kMetricCounterCount> counters{};
+  std::array<Cell, kMetricCommandSlots> packet_frames_by_command{};
+  std::array<TimerCells, kMetricTimerCount> timers{};
+
+  void AddTo(MetricsSnapshot* snapshot) const {
+    auto add = [](uint64_t& total, const Cell& cell) {
+      total += cell.load(std::memory_order_relaxed);
+    };
+    for (std::size_t i = 0; i < counters.size(); ++i) {
+      add(snapshot->counters[i], counters[i]);
+    }
+    for (std::size_t i = 0; i < packet_frames_by_command.size(); ++i) {
+      add(snapshot->packet_frames_by_command[i], packet_frames_by_command[i]);
+    }
+    for (std::size_t t = 0; t < timers.size(); ++t) {
+      TimerSnapshot& out = snapshot->timers[t];
+      add(out.calls, timers[t].calls);
+      add(out.samples, timers[t].samples);
+      add(out.sampled_nanoseconds, timers[t].sampled_nanoseconds);
+      add(out.bytes, timers[t].bytes);
+      for (std::size_t b = 0; b < kMetricHistogramBuckets; ++b) {
+        add(out.buckets[b], timers[t].buckets[b]);
+      }
+    }
+  }
+
+  void Clear() {
+    auto zero = [](Cell& cell) { cell.store(0, std::memory_order_relaxed); };
+    for (auto& cell : counters) {
+      zero(cell);
+    }
+    for (auto& cell : packet_frames_by_command) {
+      zero(cell);
+    }
+    for (auto& timer : timers) {
+      zero(timer.calls);
+      zero(timer.samples);
+      zero(timer.sampled_nanoseconds);
+      zero(timer.bytes);
+      for (auto& cell : timer.buckets) {
+        zero(cell);
+      }
+    }
+  }
+};
+
+// Live per-thread cells plus the folded-in totals of threads that have exited.
+struct Registry {
+  std::mutex mutex;
+  std::vector<MetricCells*> threads;
+  MetricsSnapshot retired;
+};
+
+Registry& GetRegistry() {
+  // Leaked so that it outlives the thread_local cells of threads exiting during shutdown.
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+class ThreadCells {
+ public:
+  ThreadCells() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.threads.push_back(&cells_);
+  }
+
+  ~ThreadCells() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    cells_.AddTo(&registry.retired);
+    std::erase(registry.threads, &cells_);
+  }
+
+  ThreadCells(const ThreadCells&) = delete;
+  ThreadCells& operator=(const ThreadCells&) = delete;
+
+  MetricCells& cells() { return cells_; }
+
+ private:
+  MetricCells cells_;
+};
+
+MetricCells& LocalCells() {
+  thread_local ThreadCells cells;
+  return cells.cells();
+}
+
+int64_t NowNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+void CountMetric(MetricCounter counter, uint64_t amount) {
+  Bump(LocalCells().counters[static_cast<std::size_t>(counter)], amount);
+}
+
+void CountPacketFrame(uint32_t command_id) {
+  std::size_t slot = command_id < kMetricCommandSlots - 1 ? command_id : kMetricCommandSlots - 1;
+  Bump(LocalCells().packet_frames_by_command[slot], 1);
+}
+
+int64_t StartMetricTimer(MetricTimer timer, uint64_t bytes) {
+  auto index = static_cast<std::size_t>(timer);
+  TimerCells& cells = LocalCells().timers[index];
+  uint64_t call = cells.calls.load(std::memory_order_relaxed);
+  cells.calls.store(call + 1, std::memory_order_relaxed);
+  Bump(cells.bytes, bytes);
+  return call % kSampleIntervals[index] == 0 ? NowNanoseconds() : 0;
+}
+
+void StopMetricTimer(MetricTimer timer, int64_t start) {
+  auto elapsed = static_cast<uint64_t>(std::max<int64_t>(NowNanoseconds() - start, 1));
+  TimerCells& cells = LocalCells().timers[static_cast<std::size_t>(timer)];
+  Bump(cells.samples, 1);
+  Bump(cells.sampled_nanoseconds, elapsed);
+  std::size_t bucket =
+      std::min<std::size_t>(std::bit_width(elapsed) - 1, kMetricHistogramBuckets - 1);
+  Bump(cells.buckets[bucket], 1);
+}
+
+MetricsSnapshot SnapshotMetrics() {
+  Registry& registry = GetRegistry();
+  std::lock_guard lock(registry.mutex);
+  MetricsSnapshot snapshot = registry.retired;
+  for (const MetricCells* cells : registry.threads) {
+    cells->AddTo(&snapshot);
+  }
+  return snapshot;
+}
+
+void ResetMetrics() {
+  Registry& registry = GetRegistry();
+  std::lock_guard lock(registry.mutex);
+  registry.retired = MetricsSnapshot{};
+  for (MetricCells* cells : registry.threads) {
+    cells->Clear();
+  }
+}
+
+#else
+
+MetricsSnapshot SnapshotMetrics() {
+  return {};
+}
+
+void ResetMetrics() {}
+
+#endif
+
+}  // namespace fujitsu::airstage
@@ -1,7 +1,12 @@
 #include "fujitsu/packet.h"
 
+#include "fujitsu/metrics.h"
+
 #include <algorithm>
+
+#if !FUJITSU_EMBEDDED
 #include <stdexcept>
+#endif
 
 namespace fujitsu::airstage {
 
@@ -11,80 +16,120 @@ namespace {
   return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
 }
 
-}  // namespace
+// `frame` must have passed FrameError.
+PacketView ViewValidFrame(std::span<const uint8_t> frame) {
+  PacketView packet;
+  packet.command_id = static_cast<uint32_t>(frame[0]) |
+                      (static_cast<uint32_t>(frame[1]) << 8) |
+                      (static_cast<uint32_t>(frame[2]) << 16) |
+                      (static_cast<uint32_t>(frame[3]) << 24);
 
-std::vector<uint8_t> Packet::Serialize() const {
-  std::vector<uint8_t> frame(frame_length());
-  frame[0] = static_cast<uint8_t>(command_id & 0xFF);
-  frame[1] = static_cast<uint8_t>((command_id >> 8) & 0xFF);
-  frame[2] = static_cast<uint8_t>((command_id >> 16) & 0xFF);
-  frame[3] = static_cast<uint8_t>((command_id >> 24) & 0xFF);
-  frame[4] = static_cast<uint8_t>(payload.size());
-  std::copy(payload.begin(), payload.end(), frame.begin() + kPacketHeaderBytes);
-  auto checksum_span = std::span<const uint8_t>(frame.data(), frame.size() - kPacketTrailerBytes);
-  uint16_t cs = ComputeChecksum(checksum_span);
-  frame[frame.size() - 2] = static_cast<uint8_t>((cs >> 8) & 0xFF);
-  frame.back() = static_cast<uint8_t>(cs & 0xFF);
-  return frame;
+  uint8_t payload_len = frame[4];
+  packet.payload = frame.subspan(kPacketHeaderBytes, payload_len);
+  packet.checksum = ReadBigEndianUint16(frame.last(kPacketTrailerBytes));
+  return packet;
 }
 
-uint16_t ComputeChecksum(std::span<const uint8_t> bytes) {
-  uint32_t sum = 0;
-  for (uint8_t byte : bytes) {
-    sum += byte;
+}  // namespace
+
+std::size_t EncodePacket(uint32_t command_id, std::span<const uint8_t> payload,
+                         std::span<uint8_t> out) {
+  std::size_t length = kPacketHeaderBytes + payload.size() + kPacketTrailerBytes;
+  if (payload.size() > kMaxPayloadBytes || out.size() < length) {
+    return 0;
   }
-  sum &= 0xFFFF;
-  uint16_t checksum = static_cast<uint16_t>(0xFFFF - static_cast<uint16_t>(sum));
-  return checksum;
+  out[0] = static_cast<uint8_t>(command_id & 0xFF);
+  out[1] = static_cast<uint8_t>((command_id >> 8) & 0xFF);
+  out[2] = static_cast<uint8_t>((command_id >> 16) & 0xFF);
+  out[3] = static_cast<uint8_t>((command_id >> 24) & 0xFF);
+  out[4] = static_cast<uint8_t>(payload.size());
+  std::copy(payload.begin(), payload.end(), out.begin() + kPacketHeaderBytes);
+  uint16_t cs = ComputeChecksum(out.first(length - kPacketTrailerBytes));
+  out[length - 2] = static_cast<uint8_t>((cs >> 8) & 0xFF);
+  out[length - 1] = static_cast<uint8_t>(cs & 0xFF);
+  return length;
 }
 
-bool ValidateFrame(std::span<const uint8_t> frame, std::string* error) {
+const char* FrameError(std::span<const uint8_t> frame) {
+  ScopedMetricTimer timer(MetricTimer::kValidate, frame.size());
   if (frame.size() < kPacketHeaderBytes + kPacketTrailerBytes) {
-    if (error) {
-      *error = "frame too short";
-    }
-    return false;
+    CountMetric(MetricCounter::kValidateTooShort);
+    return "frame too short";
   }
 
   uint8_t payload_len = frame[4];
   std::size_t expected_size = kPacketHeaderBytes + payload_len + kPacketTrailerBytes;
   if (frame.size() != expected_size) {
-    if (error) {
-      *error = "payload length does not match frame size";
-    }
-    return false;
+    CountMetric(MetricCounter::kValidateLengthMismatch);
+    return "payload length does not match frame size";
   }
 
   std::span<const uint8_t> without_crc(frame.data(), frame.size() - kPacketTrailerBytes);
   uint16_t expected_crc = ComputeChecksum(without_crc);
   uint16_t actual_crc = ReadBigEndianUint16(frame.last(kPacketTrailerBytes));
   if (expected_crc != actual_crc) {
-    if (error) {
-      *error = "checksum mismatch";
-    }
-    return false;
+    CountMetric(MetricCounter::kValidateChecksumMismatch);
+    return "checksum mismatch";
   }
 
-  return true;
+  return nullptr;
 }
 
-std::optional<Packet> ParsePacket(std::span<const uint8_t> frame, std::string* error) {
+#if FUJITSU_EMBEDDED
+
+bool ValidateFrame(std::span<const uint8_t> frame) {
+  return FrameError(frame) == nullptr;
+}
+
+std::optional<PacketView> ParsePacketView(std::span<const uint8_t> frame) {
+  if (FrameError(frame) != nullptr) {
+    return std::nullopt;
+  }
+  return ViewValidFrame(frame);
+}
+
+#else
+
+bool ValidateFrame(std::span<const uint8_t> frame, std::string* error) {
+  const char* reason = FrameError(frame);
+  if (reason != nullptr && error != nullptr) {
+    *error = reason;
+  }
+  return reason == nullptr;
+}
+
+std::optional<PacketView> ParsePacketView(std::span<const uint8_t> frame, std::string* error) {
   if (!ValidateFrame(frame, error)) {
     return std::nullopt;
   }
+  return ViewValidFrame(frame);
+}
 
-  Packet packet;
-  packet.command_id = static_cast<uint32_t>(frame[0]) |
-                      (static_cast<uint32_t>(frame[1]) << 8) |
-                      (static_cast<uint32_t>(frame[2]) << 16) |
-                      (static_cast<uint32_t>(frame[3]) << 24);
+std::vector<uint8_t> Packet::Serialize() const {
+  if (payload.size() > kMaxPayloadBytes) {
+    throw std::runtime_error("payload exceeds 255 bytes");
+  }
+  std::vector<uint8_t> frame(frame_length());
+  EncodePacket(command_id, payload, frame);
+  return frame;
+}
 
-  uint8_t payload_len = frame[4];
-  packet.payload.assign(frame.begin() + kPacketHeaderBytes,
-                        frame.begin() + kPacketHeaderBytes + payload_len);
-  packet.checksum = ReadBigEndianUint16(frame.last(kPacketTrailerBytes));
+Packet PacketView::ToPacket() const {
+  Packet packet;
+  packet.command_id = command_id;
+  packet.payload.assign(payload.begin(), payload.end());
+  packet.checksum = checksum;
   return packet;
 }
 
-}  // namespace fujitsu::airstage
+std::optional<Packet> ParsePacket(std::span<const uint8_t> frame, std::string* error) {
+  auto view = ParsePacketView(frame, error);
+  if (!view) {
+    return std::nullopt;
+  }
+  return view->ToPacket();
+}
+
+#endif
 
+}  // namespace fujitsu::airstage
@@ -0,0 +1,151 @@
+#include "fujitsu/pipeline.h"
+
+#include "fujitsu/packet.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+StagedPipeline::StagedPipeline(DecodedFrameCallback on_frame, const PipelineOptions& options)
+    : on_frame_(std::move(on_frame)),
+      options_(options),
+      inputs_(options.byte_queue_capacity),
+      frames_(options.frame_queue_capacity) {
+  scratch_.reserve(options_.batch_size);
+  framer_ = std::thread([this] { RunFramer(); });
+  decoder_ = std::thread([this] { RunDecoder(); });
+}
+
+StagedPipeline::~StagedPipeline() {
+  try {
+    Finish();
+  } catch (...) {
+    // Errors from the callback are only reported through an explicit Finish.
+  }
+}
+
+void StagedPipeline::Push(std::span<const ByteEvent> events) {
+  double ingress = MonotonicSeconds();
+  while (!events.empty()) {
+    std::size_t count = std::min(events.size(), options_.batch_size);
+    scratch_.clear();
+    for (const ByteEvent& event : events.first(count)) {
+      scratch_.push_back(Input{event.time, ingress, event.value, event.has_error, event.direction,
+                               InputKind::kByte});
+    }
+    PushInputs(scratch_);
+    events = events.subspan(count);
+  }
+}
+
+void StagedPipeline::Advance(double now) {
+  Input input;
+  input.time = now;
+  input.kind = InputKind::kAdvance;
+  PushInputs(std::span<const Input>(&input, 1));
+}
+
+void StagedPipeline::Finish() {
+  if (!finished_) {
+    finished_ = true;
+    Input input;
+    input.kind = InputKind::kFinish;
+    PushInputs(std::span<const Input>(&input, 1));
+    framer_.join();
+    decoder_.join();
+  }
+  if (callback_error_) {
+    std::rethrow_exception(std::exchange(callback_error_, nullptr));
+  }
+}
+
+void StagedPipeline::PushInputs(std::span<const Input> inputs) {
+  stats_.bytes.pushed += inputs.size();
+  for (;;) {
+    inputs = inputs.subspan(inputs_.TryPush(inputs));
+    if (inputs.empty()) {
+      return;
+    }
+    ++stats_.bytes.full_waits;
+    inputs_.WaitNotFull();
+  }
+}
+
+void StagedPipeline::PushFrame(StagedFrame&& staged) {
+  ++stats_.frames.pushed;
+  while (!frames_.TryPush(std::move(staged))) {
+    ++stats_.frames.full_waits;
+    frames_.WaitNotFull();
+  }
+}
+
+void StagedPipeline::RunFramer() {
+  // Ingress of the latest byte seen on each line, which is (almost always) the last byte of
+  // the next frame emitted for that line.
+  std::array<double, 2> ingress{};
+  FrameSequencer sequencer(
+      [this, &ingress](Frame&& frame) {
+        double frame_ingress = ingress[static_cast<std::size_t>(frame.direction)];
+        PushFrame(StagedFrame{std::move(frame), frame_ingress, false});
+      },
+      options_.gap_threshold);
+  bool finished = false;
+  while (!finished) {
+    inputs_.WaitNotEmpty();
+    ++stats_.bytes.batches;
+    inputs_.PopBatch(options_.batch_size, [&](const Input& input) {
+      switch (input.kind) {
+        case InputKind::kByte:
+          ingress[static_cast<std::size_t>(input.direction)] = input.ingress;
+          sequencer.Push(ByteEvent{input.direction, input.time, input.value, input.has_error});
+          break;
+        case InputKind::kAdvance:
+          sequencer.Advance(input.time);
+          break;
+        case InputKind::kFinish:
+          finished = true;
+          break;
+      }
+    });
+  }
+  sequencer.Finish();
+  PushFrame(StagedFrame{Frame{}, 0.0, true});
+}
+
+void StagedPipeline::RunDecoder() {
+  LatencyStats& latency = stats_.latency;
+  bool finished = false;
+  while (!finished) {
+    frames_.WaitNotEmpty();
+    ++stats_.frames.batches;
+    frames_.PopBatch(options_.batch_size, [&](StagedFrame& staged) {
+      if (staged.last) {
+        finished = true;
+        return;
+      }
+      if (callback_error_) {
+        return;
+      }
+      std::optional<Message> message;
+      if (staged.frame.type == Frame::Type::Packet) {
+        if (auto packet = ParsePacketView(staged.frame.bytes)) {
+          message = Classify(*packet, staged.frame.direction);
+        }
+      }
+      try {
+        on_frame_(staged.frame, message);
+      } catch (...) {
+        callback_error_ = std::current_exception();
+      }
+      double elapsed = MonotonicSeconds() - staged.ingress;
+      ++latency.frames;
+      latency.total_seconds += elapsed;
+      latency.max_seconds = std::max(latency.max_seconds, elapsed);
+      staged.frame = Frame{};  // release the bytes now rather than when the slot is reused
+    });
+  }
+}
+
+}  // namespace fujitsu::airstage
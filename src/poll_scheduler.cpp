@@ -0,0 +1,139 @@
+#include "fujitsu/poll_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+// Smoothing factors of the classic TCP round-trip estimator (RFC 6298).
+constexpr double kLatencyGain = 1.0 / 8.0;
+constexpr double kVarianceGain = 1.0 / 4.0;
+constexpr double kMinTimeout = 0.1;
+constexpr double kMaxTimeout = 2.0;
+
+}  // namespace
+
+PollScheduler::PollScheduler(double initial_latency, std::size_t max_addresses)
+    : max_addresses_(std::clamp<std::size_t>(max_addresses, 1, kMaxReadAddresses)),
+      smoothed_latency_(initial_latency), latency_variance_(initial_latency / 2.0) {}
+
+void PollScheduler::Watch(uint16_t address, double interval, double now) {
+  auto it = std::find_if(watched_.begin(), watched_.end(),
+                         [address](const Watched& w) { return w.address == address; });
+  if (it != watched_.end()) {
+    it->interval = interval;
+    it->next_due = std::min(it->next_due, now + interval);
+    return;
+  }
+  watched_.push_back(Watched{address, interval, now});
+}
+
+void PollScheduler::Unwatch(uint16_t address) {
+  auto it = std::find_if(watched_.begin(), watched_.end(),
+                         [address](const Watched& w) { return w.address == address; });
+  if (it == watched_.end()) {
+    return;
+  }
+  std::size_t index = static_cast<std::size_t>(it - watched_.begin());
+  watched_.erase(it);
+  if (outstanding_) {
+    // Keep the outstanding indices pointing at the same registers.
+    auto& entries = outstanding_->entries;
+    std::erase(entries, index);
+    for (auto& entry : entries) {
+      entry -= entry > index ? 1 : 0;
+    }
+  }
+}
+
+std::optional<Packet> PollScheduler::NextRequest(double now) {
+  if (outstanding_) {
+    return std::nullopt;
+  }
+  // Anything falling due before this request's response would arrive rides along now rather
+  // than needing a frame of its own right after.
+  double horizon = now + smoothed_latency_;
+  bool any_due = false;
+  candidates_.clear();
+  for (std::size_t i = 0; i < watched_.size(); ++i) {
+    if (watched_[i].next_due <= horizon) {
+      candidates_.push_back(i);
+      any_due = any_due || watched_[i].next_due <= now;
+    }
+  }
+  if (!any_due) {
+    return std::nullopt;
+  }
+
+  std::size_t count = std::min(candidates_.size(), max_addresses_);
+  std::partial_sort(candidates_.begin(), candidates_.begin() + static_cast<std::ptrdiff_t>(count),
+                    candidates_.end(), [this](std::size_t a, std::size_t b) {
+                      return watched_[a].next_due < watched_[b].next_due;
+                    });
+  candidates_.resize(count);
+
+  Packet request;
+  request.command_id = static_cast<uint32_t>(CommandId::kReadRegisters);
+  request.payload.reserve(count * 2);
+  for (std::size_t index : candidates_) {
+    uint16_t address = watched_[index].address;
+    request.payload.push_back(static_cast<uint8_t>(address >> 8));
+    request.payload.push_back(static_cast<uint8_t>(address & 0xFF));
+  }
+  outstanding_ = Outstanding{now, candidates_};
+  ++stats_.requests;
+  return request;
+}
+
+std::optional<double> PollScheduler::NextDue() const {
+  if (watched_.empty()) {
+    return std::nullopt;
+  }
+  return std::min_element(watched_.begin(), watched_.end(),
+                          [](const Watched& a, const Watched& b) { return a.next_due < b.next_due; })
+      ->next_due;
+}
+
+std::optional<ReadResponse> PollScheduler::OnResponse(const Packet& response, double now) {
+  if (!outstanding_) {
+    return std::nullopt;
+  }
+  auto decoded = DecodeReadResponse(response);
+  if (!decoded) {
+    return std::nullopt;
+  }
+  // The values reflect the unit's state when the request went out, so the next refresh is
+  // measured from then. Registers the unit did not return are rescheduled as well, otherwise
+  // an unsupported address would be re-requested in a tight loop.
+  for (std::size_t index : outstanding_->entries) {
+    Watched& watched = watched_[index];
+    watched.next_due = std::max(outstanding_->sent_at + watched.interval, now);
+  }
+  RecordLatency(now - outstanding_->sent_at);
+  outstanding_.reset();
+  ++stats_.responses;
+  stats_.registers_read += decoded->values.size();
+  return decoded;
+}
+
+void PollScheduler::OnTimeout(double now) {
+  if (!outstanding_) {
+    return;
+  }
+  RecordLatency(std::max(now - outstanding_->sent_at, 2.0 * smoothed_latency_));
+  outstanding_.reset();
+  ++stats_.timeouts;
+}
+
+double PollScheduler::response_timeout() const {
+  return std::clamp(smoothed_latency_ + 4.0 * latency_variance_, kMinTimeout, kMaxTimeout);
+}
+
+void PollScheduler::RecordLatency(double sample) {
+  latency_variance_ += kVarianceGain * (std::abs(sample - smoothed_latency_) - latency_variance_);
+  smoothed_latency_ += kLatencyGain * (sample - smoothed_latency_);
+}
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,231 @@
+#include "fujitsu/capture_reader.h"
+#include "fujitsu/classifier.h"
+#include "fujitsu/describe.h"
+#include "fujitsu/register_db.h"
+#include "fujitsu/register_history.h"
+#include "fujitsu/text_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using fujitsu::airstage::ByteEvent;
+using fujitsu::airstage::Classify;
+using fujitsu::airstage::DescribeRegisterValue;
+using fujitsu::airstage::Frame;
+using fujitsu::airstage::HistoryRun;
+using fujitsu::airstage::LookupRegister;
+using fujitsu::airstage::RegisterHistory;
+using fujitsu::airstage::ReadCaptureEvents;
+using fujitsu::airstage::RegisterHistoryWriter;
+using fujitsu::airstage::StreamCapture;
+using fujitsu::airstage::TextBuffer;
+
+namespace {
+
+constexpr double kDefaultGapThreshold = 0.004;  // seconds
+
+void PrintUsage(const char* program) {
+  std::cout << "Usage: " << program << " build <history> [--append] [--mtime] <capture>...\n";
+  std::cout << "  Records every register value seen in the captures. Captures are placed end to\n"
+            << "  end in argument order (after the existing history with --append); with --mtime\n"
+            << "  each one ends at its file modification time (Unix seconds) instead, moved\n"
+            << "  later where it would overlap the capture or history before it.\n";
+  std::cout << "       " << program << " list <history>\n";
+  std::cout << "  Lists the registers in the history with their number of value runs.\n";
+  std::cout << "       " << program << " range <history> <register> <from> <to>\n";
+  std::cout << "  Prints the values the register held between the two times.\n";
+  std::cout << "       " << program << " asof <history> <register> <time>\n";
+  std::cout << "  Prints the value the register held at the given time.\n";
+  std::cout << "  <register> is a name from the register table or an address such as 0x1002.\n";
+}
+
+// Resolves a register name (case-sensitive) or a numeric address.
+std::optional<uint16_t> ParseRegister(const std::string& text) {
+  for (uint32_t address = 0; address <= 0xFFFF; ++address) {
+    auto info = LookupRegister(static_cast<uint16_t>(address));
+    if (info && text == info->name) {
+      return static_cast<uint16_t>(address);
+    }
+  }
+  try {
+    std::size_t used = 0;
+    unsigned long value = std::stoul(text, &used, 0);
+    if (used == text.size() && value <= 0xFFFF) {
+      return static_cast<uint16_t>(value);
+    }
+  } catch (const std::exception&) {
+  }
+  return std::nullopt;
+}
+
+double FileEndTime(const std::filesystem::path& path) {
+  auto modified = std::chrono::file_clock::to_sys(std::filesystem::last_write_time(path));
+  return std::chrono::duration<double>(modified.time_since_epoch()).count();
+}
+
+int Build(const std::filesystem::path& history_path, const std::vector<std::string>& args) {
+  bool append = false;
+  bool use_mtime = false;
+  std::vector<std::filesystem::path> captures;
+  for (const auto& arg : args) {
+    if (arg == "--append") {
+      append = true;
+    } else if (arg == "--mtime") {
+      use_mtime = true;
+    } else {
+      captures.emplace_back(arg);
+    }
+  }
+  if (captures.empty()) {
+    std::cerr << "No captures given\n";
+    return 1;
+  }
+
+  try {
+    std::optional<RegisterHistory> existing;
+    if (append && std::filesystem::exists(history_path)) {
+      existing.emplace(history_path);
+    }
+    RegisterHistoryWriter writer =
+        existing ? RegisterHistoryWriter(*existing) : RegisterHistoryWriter();
+
+    // Placing a capture on the timeline needs its length, so a first pass reads only the byte
+    // times; frames are then decoded straight into the writer, one capture at a time.
+    struct Capture {
+      std::filesystem::path path;
+      double offset = 0.0;
+      double length = 0.0;
+      double requested = 0.0;  // offset before overlaps were resolved
+    };
+    std::vector<Capture> placed;
+    double next_start = writer.end_time().value_or(0.0);
+    for (const auto& path : captures) {
+      double length = 0.0;
+      ReadCaptureEvents(path, [&length](const ByteEvent& event) {
+        length = std::max(length, event.time);
+      });
+      double offset = use_mtime ? FileEndTime(path) - length : next_start;
+      next_start = offset + length;
+      placed.push_back(Capture{path, offset, length, offset});
+    }
+    std::stable_sort(placed.begin(), placed.end(),
+                     [](const Capture& a, const Capture& b) { return a.offset < b.offset; });
+    // Modification times are only as fine as the file system keeps them, and copied captures
+    // often share one, so a capture that would overlap the previous one (or the existing
+    // history) starts where that one ends instead.
+    if (auto end = writer.end_time()) {
+      next_start = *end;
+    } else if (!placed.empty()) {
+      next_start = placed.front().offset;
+    }
+    for (auto& capture : placed) {
+      capture.offset = std::max(capture.offset, next_start);
+      next_start = capture.offset + capture.length;
+    }
+
+    for (const auto& capture : placed) {
+      std::size_t frames = 0;
+      StreamCapture(
+          capture.path,
+          [&](Frame&& frame) {
+            ++frames;
+            if (auto message = Classify(frame)) {
+              writer.Apply(*message, capture.offset + frame.start_time);
+            }
+          },
+          kDefaultGapThreshold);
+      std::cout << capture.path.string() << ": " << frames << " frames at +" << std::fixed
+                << std::setprecision(3) << capture.offset << " s";
+      if (capture.offset != capture.requested) {
+        std::cout << " (moved from +" << capture.requested << " s to avoid an overlap)";
+      }
+      std::cout << '\n';
+    }
+    writer.Write(history_path);
+    RegisterHistory written(history_path);
+    std::cout << history_path.string() << ": " << written.addresses().size() << " registers, "
+              << written.run_count() << " value runs, "
+              << std::filesystem::file_size(history_path) << " bytes\n";
+  } catch (const std::exception& ex) {
+    std::cerr << "Error building " << history_path << ": " << ex.what() << '\n';
+    return 2;
+  }
+  return 0;
+}
+
+void AppendRun(uint16_t address, const HistoryRun& run, TextBuffer& out) {
+  out.Append('[');
+  out.AppendFixed(run.start, 6, 12);
+  out.Append(" .. ");
+  out.AppendFixed(run.last_seen, 6, 12);
+  out.Append("] ");
+  DescribeRegisterValue(address, run.value, out);
+  out.Append('\n');
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc >= 2 && (std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0)) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  if (argc < 3) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  std::string command = argv[1];
+  std::filesystem::path history_path = argv[2];
+  std::vector<std::string> args(argv + 3, argv + argc);
+
+  if (command == "build") {
+    return Build(history_path, args);
+  }
+
+  try {
+    RegisterHistory history(history_path);
+    TextBuffer out;
+    if (command == "list" && args.empty()) {
+      for (uint16_t address : history.addresses()) {
+        out.Append("0x");
+        out.AppendHex(address, 4);
+        if (auto info = LookupRegister(address)) {
+          out.Append('(');
+          out.Append(info->name);
+          out.Append(')');
+        }
+        out.Append(' ');
+        out.AppendDecimal(history.run_count(address));
+        out.Append(" runs\n");
+      }
+    } else if ((command == "range" && args.size() == 3) || (command == "asof" && args.size() == 2)) {
+      auto address = ParseRegister(args[0]);
+      if (!address) {
+        std::cerr << "Unknown register: " << args[0] << '\n';
+        return 1;
+      }
+      if (command == "range") {
+        for (const auto& run : history.Range(*address, std::stod(args[1]), std::stod(args[2]))) {
+          AppendRun(*address, run, out);
+        }
+      } else if (auto run = history.AsOf(*address, std::stod(args[1]))) {
+        AppendRun(*address, *run, out);
+      }
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    out.WriteTo(std::cout);
+  } catch (const std::exception& ex) {
+    std::cerr << "Error querying " << history_path << ": " << ex.what() << '\n';
+    return 2;
+  }
+  return 0;
+}
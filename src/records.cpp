@@ -0,0 +1,395 @@
+#include "fujitsu/records.h"
+
+#include "fujitsu/classifier.h"
+#include "fujitsu/packet.h"
+#include "fujitsu/register_db.h"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+// What a frame decodes to, shared by both record formats.
+struct FrameSummary {
+  RecordType type = RecordType::kRaw;
+  std::optional<PacketView> packet;
+  std::optional<Message> message;
+  std::string error;  // validation failure for kInvalid
+};
+
+FrameSummary Summarize(const Frame& frame) {
+  FrameSummary summary;
+  switch (frame.type) {
+    case Frame::Type::Break:
+      summary.type = RecordType::kBreak;
+      break;
+    case Frame::Type::Raw:
+      summary.type = RecordType::kRaw;
+      break;
+    case Frame::Type::Packet:
+      summary.packet = ParsePacketView(frame.bytes, &summary.error);
+      if (summary.packet) {
+        summary.type = RecordType::kPacket;
+        summary.message = Classify(*summary.packet, frame.direction);
+      } else {
+        summary.type = RecordType::kInvalid;
+      }
+      break;
+  }
+  return summary;
+}
+
+RecordMessage MessageKind(const Message& message) {
+  struct Visitor {
+    RecordMessage operator()(const ReadRequestView&) const { return RecordMessage::kReadRequest; }
+    RecordMessage operator()(const ReadResponseView&) const { return RecordMessage::kReadResponse; }
+    RecordMessage operator()(const WriteRequestView&) const { return RecordMessage::kWriteRequest; }
+    RecordMessage operator()(const WriteResponse&) const { return RecordMessage::kWriteResponse; }
+    RecordMessage operator()(const OpaqueMessage&) const { return RecordMessage::kOpaque; }
+  };
+  return std::visit(Visitor{}, message);
+}
+
+std::optional<uint8_t> MessageStatus(const Message& message) {
+  if (const auto* response = std::get_if<ReadResponseView>(&message)) {
+    return response->status;
+  }
+  if (const auto* response = std::get_if<WriteResponse>(&message)) {
+    return response->status;
+  }
+  return std::nullopt;
+}
+
+// Bytes carried verbatim: whole frames that did not decode, payloads of opaque packets.
+std::span<const uint8_t> UndecodedBytes(const Frame& frame, const FrameSummary& summary) {
+  if (summary.type == RecordType::kBreak) {
+    return {};
+  }
+  if (summary.type != RecordType::kPacket) {
+    return frame.bytes;
+  }
+  if (const auto* opaque = std::get_if<OpaqueMessage>(&*summary.message)) {
+    return opaque->packet.payload;
+  }
+  return {};
+}
+
+template <typename Fn>
+void ForEachRegister(const Message& message, Fn&& fn) {
+  if (const auto* request = std::get_if<ReadRequestView>(&message)) {
+    for (uint16_t address : request->addresses) {
+      fn(RegisterValue{address, 0}, false);
+    }
+  } else if (const auto* response = std::get_if<ReadResponseView>(&message)) {
+    for (const auto entry : response->values) {
+      fn(entry, true);
+    }
+  } else if (const auto* write = std::get_if<WriteRequestView>(&message)) {
+    for (const auto entry : write->values) {
+      fn(entry, true);
+    }
+  }
+}
+
+const char* RecordTypeName(RecordType type) {
+  switch (type) {
+    case RecordType::kPacket:
+      return "packet";
+    case RecordType::kBreak:
+      return "break";
+    case RecordType::kRaw:
+      return "raw";
+    case RecordType::kInvalid:
+      return "invalid";
+    case RecordType::kCapture:
+      return "capture";
+  }
+  return "unknown";
+}
+
+const char* MessageName(RecordMessage message) {
+  switch (message) {
+    case RecordMessage::kNone:
+      return "None";
+    case RecordMessage::kReadRequest:
+      return "ReadRequest";
+    case RecordMessage::kReadResponse:
+      return "ReadResponse";
+    case RecordMessage::kWriteRequest:
+      return "WriteRequest";
+    case RecordMessage::kWriteResponse:
+      return "WriteResponse";
+    case RecordMessage::kOpaque:
+      return "Opaque";
+  }
+  return "Unknown";
+}
+
+void AppendJsonString(std::string_view text, TextBuffer& out) {
+  out.Append('"');
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out.Append('\\');
+      out.Append(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out.Append("\\u00");
+      out.AppendHex(static_cast<unsigned char>(c), 2);
+    } else {
+      out.Append(c);
+    }
+  }
+  out.Append('"');
+}
+
+void AppendJsonKey(const char* key, TextBuffer& out) {
+  out.Append(",\"");
+  out.Append(key);
+  out.Append("\":");
+}
+
+void AppendJsonRegister(RegisterValue entry, bool has_value, TextBuffer& out) {
+  out.Append("{\"address\":");
+  out.AppendDecimal(entry.address);
+  if (has_value) {
+    AppendJsonKey("value", out);
+    out.AppendDecimal(entry.value);
+  }
+  auto info = LookupRegister(entry.address);
+  if (info) {
+    AppendJsonKey("name", out);
+    AppendJsonString(info->name, out);
+  }
+  if (auto decoded = has_value && info ? DecodeValue(*info->codec, entry.value) : std::nullopt) {
+    AppendJsonKey("decoded", out);
+    if (decoded->kind == ValueKind::kScaled) {
+      // Same precision as the text output, which avoids printing binary rounding noise.
+      out.AppendFixed(decoded->number, 1);
+      AppendJsonKey("unit", out);
+      AppendJsonString(decoded->unit, out);
+    } else {
+      AppendJsonString(decoded->label, out);
+    }
+  }
+  out.Append('}');
+}
+
+void AppendHexString(std::span<const uint8_t> bytes, TextBuffer& out) {
+  out.Append('"');
+  for (uint8_t byte : bytes) {
+    out.AppendHex(byte, 2);
+  }
+  out.Append('"');
+}
+
+template <typename T>
+void PutLittleEndian(std::vector<uint8_t>& out, T value) {
+  uint64_t bits;
+  if constexpr (std::is_same_v<T, double>) {
+    bits = std::bit_cast<uint64_t>(value);
+  } else {
+    bits = static_cast<uint64_t>(value);
+  }
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+  }
+}
+
+template <typename T>
+T GetLittleEndian(const uint8_t* in) {
+  uint64_t bits = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    bits |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  if constexpr (std::is_same_v<T, double>) {
+    return std::bit_cast<double>(bits);
+  } else {
+    return static_cast<T>(bits);
+  }
+}
+
+// Size of the fixed part of a binary record, after the size field.
+constexpr std::size_t kRecordFixedBytes = 8 + 1 + 1 + 1 + 1 + 4 + 8 + 8 + 2 + 4;
+
+void AppendBinary(double time, BusDirection direction, RecordType type, RecordMessage message,
+                  uint8_t status, uint32_t command_id, const Transaction* transaction,
+                  const std::optional<Message>& registers, std::span<const uint8_t> bytes,
+                  std::vector<uint8_t>& out) {
+  std::size_t count = 0;
+  if (registers) {
+    ForEachRegister(*registers, [&count](RegisterValue, bool) { ++count; });
+  }
+  std::size_t size = kRecordFixedBytes + 4 * count + bytes.size();
+  PutLittleEndian<uint32_t>(out, static_cast<uint32_t>(size));
+  PutLittleEndian<double>(out, time);
+  out.push_back(direction == BusDirection::Tx ? 1 : 0);
+  out.push_back(static_cast<uint8_t>(type));
+  out.push_back(static_cast<uint8_t>(message));
+  out.push_back(status);
+  PutLittleEndian<uint32_t>(out, command_id);
+  constexpr double kNone = std::numeric_limits<double>::quiet_NaN();
+  PutLittleEndian<double>(out, transaction ? transaction->request_time : kNone);
+  PutLittleEndian<double>(out, transaction ? transaction->latency : kNone);
+  PutLittleEndian<uint16_t>(out, static_cast<uint16_t>(count));
+  if (registers) {
+    ForEachRegister(*registers, [&out](RegisterValue entry, bool) {
+      PutLittleEndian<uint16_t>(out, entry.address);
+      PutLittleEndian<uint16_t>(out, entry.value);
+    });
+  }
+  PutLittleEndian<uint32_t>(out, static_cast<uint32_t>(bytes.size()));
+  out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+std::runtime_error Malformed(const char* what) {
+  return std::runtime_error(std::string("malformed record stream: ") + what);
+}
+
+}  // namespace
+
+void AppendNdjsonRecord(const Frame& frame, const Transaction* transaction, TextBuffer& out) {
+  FrameSummary summary = Summarize(frame);
+  out.Append("{\"t\":");
+  out.AppendDouble(frame.start_time);
+  AppendJsonKey("dir", out);
+  AppendJsonString(ToString(frame.direction), out);
+  AppendJsonKey("type", out);
+  AppendJsonString(RecordTypeName(summary.type), out);
+
+  if (summary.type == RecordType::kPacket) {
+    const Message& message = *summary.message;
+    AppendJsonKey("command", out);
+    out.AppendDecimal(summary.packet->command_id);
+    AppendJsonKey("command_name", out);
+    AppendJsonString(CommandToString(summary.packet->command_id), out);
+    AppendJsonKey("message", out);
+    AppendJsonString(MessageName(MessageKind(message)), out);
+    if (auto status = MessageStatus(message)) {
+      AppendJsonKey("status", out);
+      out.AppendDecimal(*status);
+    }
+    if (!std::holds_alternative<OpaqueMessage>(message) &&
+        !std::holds_alternative<WriteResponse>(message)) {
+      AppendJsonKey("registers", out);
+      out.Append('[');
+      bool first = true;
+      ForEachRegister(message, [&](RegisterValue entry, bool has_value) {
+        if (!first) {
+          out.Append(',');
+        }
+        first = false;
+        AppendJsonRegister(entry, has_value, out);
+      });
+      out.Append(']');
+    }
+  } else if (summary.type == RecordType::kInvalid) {
+    AppendJsonKey("error", out);
+    AppendJsonString(summary.error, out);
+  }
+
+  if (auto bytes = UndecodedBytes(frame, summary); !bytes.empty()) {
+    AppendJsonKey("bytes", out);
+    AppendHexString(bytes, out);
+  }
+  if (transaction) {
+    AppendJsonKey("request_t", out);
+    out.AppendDouble(transaction->request_time);
+    AppendJsonKey("latency", out);
+    out.AppendDouble(transaction->latency);
+  }
+  out.Append("}\n");
+}
+
+void AppendNdjsonCaptureRecord(const std::string& path, TextBuffer& out) {
+  out.Append("{\"type\":\"capture\",\"path\":");
+  AppendJsonString(path, out);
+  out.Append("}\n");
+}
+
+void AppendRecordStreamHeader(std::vector<uint8_t>& out) {
+  out.insert(out.end(), std::begin(kRecordStreamMagic), std::end(kRecordStreamMagic));
+  PutLittleEndian<uint16_t>(out, kRecordStreamVersion);
+  PutLittleEndian<uint16_t>(out, 0);
+}
+
+void AppendBinaryRecord(const Frame& frame, const Transaction* transaction,
+                        std::vector<uint8_t>& out) {
+  FrameSummary summary = Summarize(frame);
+  RecordMessage message = summary.message ? MessageKind(*summary.message) : RecordMessage::kNone;
+  uint8_t status = summary.message ? MessageStatus(*summary.message).value_or(0) : 0;
+  uint32_t command_id = summary.packet ? summary.packet->command_id : 0;
+  AppendBinary(frame.start_time, frame.direction, summary.type, message, status, command_id,
+               transaction, summary.message, UndecodedBytes(frame, summary), out);
+}
+
+void AppendBinaryCaptureRecord(const std::string& path, std::vector<uint8_t>& out) {
+  std::span<const uint8_t> bytes(reinterpret_cast<const uint8_t*>(path.data()), path.size());
+  AppendBinary(0.0, BusDirection::Rx, RecordType::kCapture, RecordMessage::kNone, 0, 0, nullptr,
+               std::nullopt, bytes, out);
+}
+
+BinaryRecordReader::BinaryRecordReader(std::span<const uint8_t> bytes) {
+  if (bytes.size() < kRecordStreamHeaderBytes ||
+      std::memcmp(bytes.data(), kRecordStreamMagic, sizeof(kRecordStreamMagic)) != 0) {
+    throw Malformed("missing header");
+  }
+  if (GetLittleEndian<uint16_t>(bytes.data() + 4) != kRecordStreamVersion) {
+    throw Malformed("unsupported version");
+  }
+  remaining_ = bytes.subspan(kRecordStreamHeaderBytes);
+}
+
+std::optional<Record> BinaryRecordReader::Next() {
+  if (remaining_.empty()) {
+    return std::nullopt;
+  }
+  if (remaining_.size() < 4) {
+    throw Malformed("truncated record");
+  }
+  auto size = GetLittleEndian<uint32_t>(remaining_.data());
+  if (size < kRecordFixedBytes || remaining_.size() - 4 < size) {
+    throw Malformed("truncated record");
+  }
+  const uint8_t* p = remaining_.data() + 4;
+  const uint8_t* end = p + size;
+  remaining_ = remaining_.subspan(4 + size);
+
+  Record record;
+  record.time = GetLittleEndian<double>(p);
+  record.direction = p[8] ? BusDirection::Tx : BusDirection::Rx;
+  record.type = static_cast<RecordType>(p[9]);
+  record.message = static_cast<RecordMessage>(p[10]);
+  record.status = p[11];
+  record.command_id = GetLittleEndian<uint32_t>(p + 12);
+  auto request_time = GetLittleEndian<double>(p + 16);
+  auto latency = GetLittleEndian<double>(p + 24);
+  if (!std::isnan(request_time)) {
+    record.transaction = Transaction{record.command_id, request_time, record.time, latency};
+  }
+  auto count = GetLittleEndian<uint16_t>(p + 32);
+  p += 34;
+  if (static_cast<std::size_t>(end - p) < 4 * std::size_t{count} + 4) {
+    throw Malformed("register list overruns record");
+  }
+  record.registers.reserve(count);
+  for (std::size_t i = 0; i < count; ++i, p += 4) {
+    record.registers.push_back(
+        RegisterValue{GetLittleEndian<uint16_t>(p), GetLittleEndian<uint16_t>(p + 2)});
+  }
+  auto byte_count = GetLittleEndian<uint32_t>(p);
+  p += 4;
+  if (static_cast<std::size_t>(end - p) != byte_count) {
+    throw Malformed("byte count does not match record size");
+  }
+  record.bytes.assign(p, end);
+  return record;
+}
+
+}  // namespace fujitsu::airstage
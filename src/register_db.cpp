@@ -1,5 +1,10 @@
 #include "fujitsu/register_db.h"
 
+#include "fujitsu/register_map.h"
+
+#include <array>
+#include <cstddef>
+
 namespace fujitsu::airstage {
 
 namespace {
@@ -9,24 +14,156 @@ struct Entry {
   RegisterInfo info;
 };
 
+constexpr EnumLabel kOperationModeLabels[] = {
+    {0, "Auto"}, {1, "Cool"}, {2, "Dry"}, {3, "Fan"}, {4, "Heat"},
+};
+
+constexpr EnumLabel kFanSpeedLabels[] = {
+    {0, "Auto"}, {2, "Quiet"}, {5, "Low"}, {8, "Medium"}, {11, "High"},
+};
+
+constexpr RegisterCodec kOperationModeCodec{.kind = ValueKind::kEnum,
+                                            .labels = kOperationModeLabels};
+constexpr RegisterCodec kFanSpeedCodec{.kind = ValueKind::kEnum, .labels = kFanSpeedLabels};
+constexpr RegisterCodec kSetpointCodec{
+    .kind = ValueKind::kScaled, .scale = 0.1, .unit = "C", .invalid = 0xFFFF};
+constexpr RegisterCodec kBooleanCodec{.kind = ValueKind::kBoolean};
+
 constexpr Entry kRegisterTable[] = {
-    {0x1000, {"PowerState", "Observed as 0x0001 when the system is running"}},
-    {0x1001, {"OperationMode", "0=Auto, 1=Cool, 2=Dry, 3=Fan, 4=Heat"}},
-    {0x1002, {"TemperatureSetpoint", "0x00C8 corresponds to 68°F (tentative scaling)"}},
-    {0x1003, {"FanSpeed", "0=Auto, 2=Quiet, 5=Low, 8=Medium, 11=High"}},
-    {0x1108, {"EnergySavingFan", "1 enables low-energy fan mode"}},
+    {0x1000, {"PowerState", "Observed as 0x0001 when the system is running", &kBooleanCodec,
+              RegisterAccess::kReadWrite}},
+    {0x1001, {"OperationMode", "0=Auto, 1=Cool, 2=Dry, 3=Fan, 4=Heat", &kOperationModeCodec,
+              RegisterAccess::kReadWrite}},
+    {0x1002, {"TemperatureSetpoint", "Tenths of a degree Celsius; 0x00C8 = 20.0 C (68 F)",
+              &kSetpointCodec, RegisterAccess::kReadWrite}},
+    {0x1003, {"FanSpeed", "0=Auto, 2=Quiet, 5=Low, 8=Medium, 11=High", &kFanSpeedCodec,
+              RegisterAccess::kReadWrite}},
+    {0x1108, {"EnergySavingFan", "1 enables low-energy fan mode", &kBooleanCodec,
+              RegisterAccess::kReadWrite}},
 };
 
-}  // namespace
+static_assert(std::size(kRegisterTable) < 255, "slot indices are stored in one byte");
 
-std::optional<RegisterInfo> LookupRegister(uint16_t address) {
+// Two-level table: the high byte of an address selects a 256-entry page (page 0 is shared by
+// every high byte without registers) and the low byte selects a slot holding the 1-based index
+// into kRegisterTable, 0 meaning unknown.
+consteval std::size_t CountPages() {
+  std::array<bool, 256> used{};
+  std::size_t pages = 1;
   for (const auto& entry : kRegisterTable) {
-    if (entry.address == address) {
-      return entry.info;
+    if (!used[entry.address >> 8]) {
+      used[entry.address >> 8] = true;
+      ++pages;
     }
   }
+  return pages;
+}
+
+struct PageTable {
+  std::array<uint8_t, 256> page_of{};
+  std::array<std::array<uint8_t, 256>, CountPages()> slots{};
+};
+
+consteval PageTable BuildPageTable() {
+  PageTable table;
+  uint8_t next_page = 1;
+  for (std::size_t i = 0; i < std::size(kRegisterTable); ++i) {
+    uint16_t address = kRegisterTable[i].address;
+    uint8_t& page = table.page_of[address >> 8];
+    if (page == 0) {
+      page = next_page++;
+    }
+    table.slots[page][address & 0xFF] = static_cast<uint8_t>(i + 1);
+  }
+  return table;
+}
+
+constexpr PageTable kPageTable = BuildPageTable();
+
+}  // namespace
+
+const char* ToString(OperationMode mode) {
+  switch (mode) {
+    case OperationMode::kAuto:
+      return "Auto";
+    case OperationMode::kCool:
+      return "Cool";
+    case OperationMode::kDry:
+      return "Dry";
+    case OperationMode::kFan:
+      return "Fan";
+    case OperationMode::kHeat:
+      return "Heat";
+  }
+  return "Unknown";
+}
+
+const char* ToString(FanSpeed speed) {
+  switch (speed) {
+    case FanSpeed::kAuto:
+      return "Auto";
+    case FanSpeed::kQuiet:
+      return "Quiet";
+    case FanSpeed::kLow:
+      return "Low";
+    case FanSpeed::kMedium:
+      return "Medium";
+    case FanSpeed::kHigh:
+      return "High";
+  }
+  return "Unknown";
+}
+
+std::optional<DecodedValue> DecodeValue(const RegisterCodec& codec, uint16_t raw) {
+  if (codec.invalid && raw == *codec.invalid) {
+    return std::nullopt;
+  }
+  switch (codec.kind) {
+    case ValueKind::kRaw:
+      return std::nullopt;
+    case ValueKind::kEnum:
+      for (const auto& label : codec.labels) {
+        if (label.value == raw) {
+          return DecodedValue{ValueKind::kEnum, label.label};
+        }
+      }
+      return std::nullopt;
+    case ValueKind::kScaled:
+      return DecodedValue{ValueKind::kScaled, nullptr, raw * codec.scale, codec.unit};
+    case ValueKind::kBoolean:
+      if (raw > 1) {
+        return std::nullopt;
+      }
+      return DecodedValue{ValueKind::kBoolean, raw ? "on" : "off"};
+  }
   return std::nullopt;
 }
 
-}  // namespace fujitsu::airstage
+const char* ToString(RegisterAccess access) {
+  switch (access) {
+    case RegisterAccess::kUnknown:
+      return "unknown";
+    case RegisterAccess::kReadOnly:
+      return "ro";
+    case RegisterAccess::kWriteOnly:
+      return "wo";
+    case RegisterAccess::kReadWrite:
+      return "rw";
+  }
+  return "unknown";
+}
 
+std::optional<RegisterInfo> LookupRegister(uint16_t address) {
+  if (const RegisterMap* map = ActiveRegisterMap()) {
+    if (auto info = map->Find(address)) {
+      return info;
+    }
+  }
+  uint8_t slot = kPageTable.slots[kPageTable.page_of[address >> 8]][address & 0xFF];
+  if (slot == 0) {
+    return std::nullopt;
+  }
+  return kRegisterTable[slot - 1].info;
+}
+
+}  // namespace fujitsu::airstage
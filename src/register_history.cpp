@@ -0,0 +1,360 @@
+#include "fujitsu/register_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+template <typename T>
+void PutLittleEndian(uint8_t* out, T value) {
+  auto bits = static_cast<uint64_t>(value);
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    out[i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+}
+
+template <typename T>
+T GetLittleEndian(const uint8_t* in) {
+  uint64_t bits = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    bits |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return static_cast<T>(bits);
+}
+
+void PutVarint(std::vector<uint8_t>* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+std::runtime_error Malformed(const char* what) {
+  return std::runtime_error(std::string("malformed register history: ") + what);
+}
+
+// Run data is decoded lazily, so every varint is bounds-checked as it is read.
+uint64_t GetVarint(const uint8_t** pos, const uint8_t* end) {
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (*pos == end) {
+      throw Malformed("truncated run data");
+    }
+    uint8_t byte = *(*pos)++;
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw Malformed("varint too long");
+}
+
+int64_t ToTicks(double time) {
+  return std::llround(time * static_cast<double>(kHistoryTicksPerSecond));
+}
+
+double ToSeconds(int64_t tick) {
+  return static_cast<double>(tick) / static_cast<double>(kHistoryTicksPerSecond);
+}
+
+}  // namespace
+
+RegisterHistoryWriter::RegisterHistoryWriter(const RegisterHistory& existing) {
+  for (const auto& entry : existing.entries_) {
+    auto& runs = runs_[entry.address];
+    runs.reserve(entry.runs);
+    existing.Scan(entry, 0, [&runs](int64_t start, int64_t last_seen, uint16_t value) {
+      runs.push_back(TickRun{start, last_seen, value});
+      return true;
+    });
+  }
+}
+
+void RegisterHistoryWriter::Apply(const Message& message, double time) {
+  if (const auto* response = std::get_if<ReadResponseView>(&message)) {
+    for (const auto entry : response->values) {
+      Record(entry.address, entry.value, time);
+    }
+  } else if (const auto* request = std::get_if<WriteRequestView>(&message)) {
+    for (const auto entry : request->values) {
+      Record(entry.address, entry.value, time);
+    }
+  }
+}
+
+void RegisterHistoryWriter::Record(uint16_t address, uint16_t value, double time) {
+  int64_t tick = ToTicks(time);
+  auto& runs = runs_[address];
+  if (!runs.empty()) {
+    TickRun& last = runs.back();
+    if (tick < last.last_seen) {
+      throw std::runtime_error("register history observations must be in time order");
+    }
+    if (last.value == value) {
+      last.last_seen = tick;
+      return;
+    }
+  }
+  runs.push_back(TickRun{tick, tick, value});
+}
+
+std::optional<double> RegisterHistoryWriter::end_time() const {
+  std::optional<int64_t> end;
+  for (const auto& [address, runs] : runs_) {
+    if (!runs.empty()) {
+      end = std::max(end.value_or(runs.back().last_seen), runs.back().last_seen);
+    }
+  }
+  if (!end) {
+    return std::nullopt;
+  }
+  return ToSeconds(*end);
+}
+
+void RegisterHistoryWriter::Write(const std::filesystem::path& path) const {
+  std::vector<uint8_t> directory(runs_.size() * kHistoryDirectoryEntryBytes);
+  std::vector<uint8_t> body;
+  uint64_t total_runs = 0;
+  uint64_t body_offset = kHistoryHeaderBytes + directory.size();
+
+  std::size_t slot = 0;
+  for (const auto& [address, runs] : runs_) {
+    std::size_t blocks = (runs.size() + kHistoryRunsPerBlock - 1) / kHistoryRunsPerBlock;
+    std::size_t index_offset = body.size();
+    body.resize(body.size() + blocks * kHistoryIndexEntryBytes);
+
+    std::vector<uint8_t> data;
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+      const TickRun& run = runs[i];
+      if (i % kHistoryRunsPerBlock == 0) {
+        std::size_t block = i / kHistoryRunsPerBlock;
+        uint8_t* entry = body.data() + index_offset + block * kHistoryIndexEntryBytes;
+        PutLittleEndian<int64_t>(entry, run.start);
+        PutLittleEndian<uint32_t>(entry + 8, static_cast<uint32_t>(data.size()));
+        PutVarint(&data, 0);
+      } else {
+        PutVarint(&data, static_cast<uint64_t>(run.start - runs[i - 1].start));
+      }
+      PutVarint(&data, static_cast<uint64_t>(run.last_seen - run.start));
+      PutVarint(&data, run.value);
+    }
+    std::size_t data_offset = body.size();
+    body.insert(body.end(), data.begin(), data.end());
+
+    uint8_t* entry = directory.data() + slot++ * kHistoryDirectoryEntryBytes;
+    PutLittleEndian<uint16_t>(entry, address);
+    PutLittleEndian<uint32_t>(entry + 4, static_cast<uint32_t>(runs.size()));
+    PutLittleEndian<uint64_t>(entry + 8, body_offset + index_offset);
+    PutLittleEndian<uint64_t>(entry + 16, body_offset + data_offset);
+    PutLittleEndian<uint64_t>(entry + 24, data.size());
+    total_runs += runs.size();
+  }
+
+  uint8_t header[kHistoryHeaderBytes] = {};
+  std::memcpy(header, kHistoryMagic, sizeof(kHistoryMagic));
+  PutLittleEndian<uint16_t>(header + 4, kHistoryVersion);
+  PutLittleEndian<uint32_t>(header + 8, static_cast<uint32_t>(runs_.size()));
+  PutLittleEndian<uint64_t>(header + 16, total_runs);
+  PutLittleEndian<uint64_t>(header + 24, kHistoryTicksPerSecond);
+
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  if (!output.is_open()) {
+    throw std::runtime_error("failed to create register history: " + path.string());
+  }
+  auto write = [&output](const uint8_t* data, std::size_t size) {
+    output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+  };
+  write(header, sizeof(header));
+  write(directory.data(), directory.size());
+  write(body.data(), body.size());
+  output.flush();
+  if (!output) {
+    throw std::runtime_error("failed to write register history: " + path.string());
+  }
+}
+
+RegisterHistory::RegisterHistory(const std::filesystem::path& path)
+    : RegisterHistory(MappedFile(path)) {}
+
+RegisterHistory::RegisterHistory(MappedFile file) : file_(std::move(file)) {
+  std::span<const uint8_t> bytes = file_.bytes();
+  if (bytes.size() < kHistoryHeaderBytes ||
+      std::memcmp(bytes.data(), kHistoryMagic, sizeof(kHistoryMagic)) != 0) {
+    throw Malformed("missing header");
+  }
+  if (GetLittleEndian<uint16_t>(bytes.data() + 4) != kHistoryVersion) {
+    throw Malformed("unsupported version");
+  }
+  if (GetLittleEndian<uint64_t>(bytes.data() + 24) != kHistoryTicksPerSecond) {
+    throw Malformed("unsupported time resolution");
+  }
+  auto count = GetLittleEndian<uint32_t>(bytes.data() + 8);
+  if ((bytes.size() - kHistoryHeaderBytes) / kHistoryDirectoryEntryBytes < count) {
+    throw Malformed("truncated directory");
+  }
+
+  entries_.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const uint8_t* p = bytes.data() + kHistoryHeaderBytes + i * kHistoryDirectoryEntryBytes;
+    Entry entry;
+    entry.address = GetLittleEndian<uint16_t>(p);
+    entry.runs = GetLittleEndian<uint32_t>(p + 4);
+    auto index_offset = GetLittleEndian<uint64_t>(p + 8);
+    auto data_offset = GetLittleEndian<uint64_t>(p + 16);
+    auto data_size = GetLittleEndian<uint64_t>(p + 24);
+    uint64_t blocks = (uint64_t{entry.runs} + kHistoryRunsPerBlock - 1) / kHistoryRunsPerBlock;
+    uint64_t index_size = blocks * kHistoryIndexEntryBytes;
+    if (index_offset > bytes.size() || bytes.size() - index_offset < index_size ||
+        data_offset > bytes.size() || bytes.size() - data_offset < data_size) {
+      throw Malformed("register data out of bounds");
+    }
+    if (!entries_.empty() && entries_.back().address >= entry.address) {
+      throw Malformed("directory not sorted");
+    }
+    entry.index = bytes.subspan(index_offset, index_size);
+    entry.data = bytes.subspan(data_offset, data_size);
+    for (std::size_t block = 0; block < blocks; ++block) {
+      if (GetLittleEndian<uint32_t>(entry.index.data() + block * kHistoryIndexEntryBytes + 8) >=
+          data_size) {
+        throw Malformed("block offset out of bounds");
+      }
+    }
+    total_runs_ += entry.runs;
+    entries_.push_back(entry);
+  }
+}
+
+std::vector<uint16_t> RegisterHistory::addresses() const {
+  std::vector<uint16_t> result;
+  result.reserve(entries_.size());
+  for (const auto& entry : entries_) {
+    result.push_back(entry.address);
+  }
+  return result;
+}
+
+std::size_t RegisterHistory::run_count(uint16_t address) const {
+  const Entry* entry = Find(address);
+  return entry ? entry->runs : 0;
+}
+
+const RegisterHistory::Entry* RegisterHistory::Find(uint16_t address) const {
+  auto it = std::lower_bound(entries_.begin(), entries_.end(), address,
+                             [](const Entry& entry, uint16_t key) { return entry.address < key; });
+  return it != entries_.end() && it->address == address ? &*it : nullptr;
+}
+
+std::optional<std::size_t> RegisterHistory::BlockAtOrBefore(const Entry& entry, int64_t tick) const {
+  std::size_t lo = 0;
+  std::size_t hi = entry.index.size() / kHistoryIndexEntryBytes;
+  // Invariant: blocks before `lo` start at or before `tick`, blocks from `hi` on after it.
+  while (lo < hi) {
+    std::size_t mid = lo + (hi - lo) / 2;
+    if (GetLittleEndian<int64_t>(entry.index.data() + mid * kHistoryIndexEntryBytes) <= tick) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0) {
+    return std::nullopt;
+  }
+  return lo - 1;
+}
+
+template <typename Visit>
+void RegisterHistory::Scan(const Entry& entry, std::size_t block, Visit&& visit) const {
+  std::size_t blocks = entry.index.size() / kHistoryIndexEntryBytes;
+  const uint8_t* end = entry.data.data() + entry.data.size();
+  for (; block < blocks; ++block) {
+    const uint8_t* index = entry.index.data() + block * kHistoryIndexEntryBytes;
+    int64_t start = GetLittleEndian<int64_t>(index);
+    const uint8_t* pos = entry.data.data() + GetLittleEndian<uint32_t>(index + 8);
+    std::size_t runs = std::min<std::size_t>(kHistoryRunsPerBlock,
+                                             entry.runs - block * kHistoryRunsPerBlock);
+    for (std::size_t i = 0; i < runs; ++i) {
+      start += static_cast<int64_t>(GetVarint(&pos, end));
+      int64_t last_seen = start + static_cast<int64_t>(GetVarint(&pos, end));
+      auto value = static_cast<uint16_t>(GetVarint(&pos, end));
+      if (!visit(start, last_seen, value)) {
+        return;
+      }
+    }
+  }
+}
+
+std::vector<HistoryRun> RegisterHistory::Range(uint16_t address, double from, double to) const {
+  std::vector<HistoryRun> result;
+  const Entry* entry = Find(address);
+  if (!entry || to < from) {
+    return result;
+  }
+  int64_t from_tick = ToTicks(from);
+  int64_t to_tick = ToTicks(to);
+  std::optional<HistoryRun> in_effect;
+  Scan(*entry, BlockAtOrBefore(*entry, from_tick).value_or(0),
+       [&](int64_t start, int64_t last_seen, uint16_t value) {
+         HistoryRun run{ToSeconds(start), ToSeconds(last_seen), value};
+         if (start <= from_tick) {
+           in_effect = run;
+           return true;
+         }
+         if (in_effect) {
+           result.push_back(*in_effect);
+           in_effect.reset();
+         }
+         if (start > to_tick) {
+           return false;
+         }
+         result.push_back(run);
+         return true;
+       });
+  if (in_effect) {
+    result.push_back(*in_effect);
+  }
+  return result;
+}
+
+std::optional<HistoryRun> RegisterHistory::AsOf(uint16_t address, double time) const {
+  const Entry* entry = Find(address);
+  if (!entry) {
+    return std::nullopt;
+  }
+  int64_t tick = ToTicks(time);
+  auto block = BlockAtOrBefore(*entry, tick);
+  if (!block) {
+    return std::nullopt;
+  }
+  std::optional<HistoryRun> result;
+  Scan(*entry, *block, [&](int64_t start, int64_t last_seen, uint16_t value) {
+    if (start > tick) {
+      return false;
+    }
+    result = HistoryRun{ToSeconds(start), ToSeconds(last_seen), value};
+    return true;
+  });
+  return result;
+}
+
+std::vector<HistoryRun> RegisterHistory::All(uint16_t address) const {
+  std::vector<HistoryRun> result;
+  if (const Entry* entry = Find(address)) {
+    result.reserve(entry->runs);
+    Scan(*entry, 0, [&result](int64_t start, int64_t last_seen, uint16_t value) {
+      result.push_back(HistoryRun{ToSeconds(start), ToSeconds(last_seen), value});
+      return true;
+    });
+  }
+  return result;
+}
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,276 @@
+#include "fujitsu/register_map.h"
+
+#include <atomic>
+#include <charconv>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+std::mutex g_install_mutex;
+std::shared_ptr<const RegisterMap> g_installed_map;  // guarded by g_install_mutex
+std::atomic<uint64_t> g_install_generation{0};      // bumped by every install
+
+// Each thread reads through its own reference to the map, refreshed when the generation moves
+// on, so a replaced map is freed once the last thread that used it looks up again (or exits).
+struct MapSnapshot {
+  uint64_t generation = 0;
+  std::shared_ptr<const RegisterMap> map;
+};
+thread_local MapSnapshot t_snapshot;
+
+std::runtime_error BadDefinition(const std::string& source, std::size_t line_number,
+                                 const std::string& what) {
+  return std::runtime_error(source + ":" + std::to_string(line_number) + ": " + what);
+}
+
+std::optional<uint16_t> ParseUnsigned16(std::string_view text) {
+  int base = 10;
+  if (text.starts_with("0x") || text.starts_with("0X")) {
+    text.remove_prefix(2);
+    base = 16;
+  }
+  unsigned value = 0;
+  auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+  if (ec != std::errc() || ptr != text.data() + text.size() || text.empty() || value > 0xFFFF) {
+    return std::nullopt;
+  }
+  return static_cast<uint16_t>(value);
+}
+
+std::optional<RegisterAccess> ParseAccess(std::string_view text) {
+  if (text == "ro") {
+    return RegisterAccess::kReadOnly;
+  }
+  if (text == "wo") {
+    return RegisterAccess::kWriteOnly;
+  }
+  if (text == "rw") {
+    return RegisterAccess::kReadWrite;
+  }
+  if (text == "-") {
+    return RegisterAccess::kUnknown;
+  }
+  return std::nullopt;
+}
+
+std::string_view Trim(std::string_view text) {
+  auto begin = text.find_first_not_of(" \t\r");
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  auto end = text.find_last_not_of(" \t\r");
+  return text.substr(begin, end - begin + 1);
+}
+
+}  // namespace
+
+std::unique_ptr<const RegisterMap> RegisterMap::Load(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Unable to open register map: " + path.string());
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return Parse(contents.str(), path.string());
+}
+
+std::unique_ptr<const RegisterMap> RegisterMap::Parse(std::string_view text,
+                                                      const std::string& source) {
+  std::unique_ptr<RegisterMap> map(new RegisterMap());
+  std::size_t line_number = 0;
+  while (!text.empty()) {
+    auto newline = text.find('\n');
+    std::string_view line = text.substr(0, newline);
+    text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+    ++line_number;
+
+    line = Trim(line);
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+
+    Entry entry;
+    if (auto separator = line.find(" -- "); separator != std::string_view::npos) {
+      entry.description = std::string(Trim(line.substr(separator + 4)));
+      line = line.substr(0, separator);
+    }
+
+    std::vector<std::string> fields;
+    std::istringstream tokens{std::string(line)};
+    for (std::string token; tokens >> token;) {
+      fields.push_back(std::move(token));
+    }
+    if (fields.size() < 4) {
+      throw BadDefinition(source, line_number, "expected <address> <name> <access> <codec>");
+    }
+
+    auto address = ParseUnsigned16(fields[0]);
+    if (!address) {
+      throw BadDefinition(source, line_number, "invalid address '" + fields[0] + "'");
+    }
+    entry.address = *address;
+    entry.name = fields[1];
+    auto access = ParseAccess(fields[2]);
+    if (!access) {
+      throw BadDefinition(source, line_number, "invalid access '" + fields[2] + "'");
+    }
+    entry.access = *access;
+
+    std::vector<std::string_view> arguments;
+    for (std::size_t i = 4; i < fields.size(); ++i) {
+      std::string_view argument = fields[i];
+      if (argument.starts_with("invalid=")) {
+        auto invalid = ParseUnsigned16(argument.substr(8));
+        if (!invalid) {
+          throw BadDefinition(source, line_number, "invalid raw value '" + fields[i] + "'");
+        }
+        entry.codec.invalid = *invalid;
+      } else {
+        arguments.push_back(argument);
+      }
+    }
+
+    const std::string& codec = fields[3];
+    if (codec == "raw" || codec == "bool") {
+      if (!arguments.empty()) {
+        throw BadDefinition(source, line_number, codec + " takes no arguments");
+      }
+      entry.codec.kind = codec == "raw" ? ValueKind::kRaw : ValueKind::kBoolean;
+    } else if (codec == "enum") {
+      entry.codec.kind = ValueKind::kEnum;
+      for (std::string_view argument : arguments) {
+        auto equals = argument.find('=');
+        auto value = ParseUnsigned16(argument.substr(0, equals));
+        if (equals == std::string_view::npos || !value || equals + 1 == argument.size()) {
+          throw BadDefinition(source, line_number,
+                              "invalid enum label '" + std::string(argument) + "'");
+        }
+        entry.labels.push_back(EnumLabel{*value, nullptr});
+        entry.label_text.emplace_back(argument.substr(equals + 1));
+      }
+    } else if (codec == "scale") {
+      double factor = 0.0;
+      bool valid = arguments.size() == 2;
+      if (valid) {
+        auto [ptr, ec] = std::from_chars(arguments[0].data(),
+                                         arguments[0].data() + arguments[0].size(), factor);
+        valid = ec == std::errc() && ptr == arguments[0].data() + arguments[0].size();
+      }
+      if (!valid) {
+        throw BadDefinition(source, line_number, "expected scale <factor> <unit>");
+      }
+      entry.codec.kind = ValueKind::kScaled;
+      entry.codec.scale = factor;
+      entry.unit = std::string(arguments[1]);
+    } else {
+      throw BadDefinition(source, line_number, "unknown codec '" + codec + "'");
+    }
+
+    if (map->Find(entry.address)) {
+      throw BadDefinition(source, line_number, "duplicate definition of " + fields[0]);
+    }
+    map->Add(std::move(entry));
+  }
+  return map;
+}
+
+void RegisterMap::Add(Entry entry) {
+  auto stored = std::make_unique<Entry>(std::move(entry));
+  // Point the codec at the entry's own storage now that its address is fixed.
+  for (std::size_t i = 0; i < stored->labels.size(); ++i) {
+    stored->labels[i].label = stored->label_text[i].c_str();
+  }
+  stored->codec.labels = stored->labels;
+  stored->codec.unit = stored->unit.c_str();
+
+  uint16_t& page = page_of_[stored->address >> 8];
+  if (page == 0) {
+    slots_.emplace_back();
+    page = static_cast<uint16_t>(slots_.size());
+  }
+  entries_.push_back(std::move(stored));
+  slots_[page - 1][entries_.back()->address & 0xFF] = static_cast<uint16_t>(entries_.size());
+}
+
+std::optional<RegisterInfo> RegisterMap::Find(uint16_t address) const {
+  uint16_t page = page_of_[address >> 8];
+  if (page == 0) {
+    return std::nullopt;
+  }
+  uint16_t slot = slots_[page - 1][address & 0xFF];
+  if (slot == 0) {
+    return std::nullopt;
+  }
+  const Entry& entry = *entries_[slot - 1];
+  return RegisterInfo{entry.name.c_str(), entry.description.c_str(), &entry.codec, entry.access};
+}
+
+void InstallRegisterMap(std::unique_ptr<const RegisterMap> map) {
+  std::shared_ptr<const RegisterMap> replaced;  // freed after the lock is released
+  std::lock_guard<std::mutex> lock(g_install_mutex);
+  replaced = std::exchange(g_installed_map, std::move(map));
+  g_install_generation.fetch_add(1, std::memory_order_release);
+}
+
+const RegisterMap* ActiveRegisterMap() {
+  uint64_t generation = g_install_generation.load(std::memory_order_acquire);
+  if (t_snapshot.generation != generation) {
+    std::shared_ptr<const RegisterMap> previous;
+    std::lock_guard<std::mutex> lock(g_install_mutex);
+    previous = std::exchange(t_snapshot.map, g_installed_map);
+    t_snapshot.generation = g_install_generation.load(std::memory_order_relaxed);
+  }
+  return t_snapshot.map.get();
+}
+
+RegisterMapWatcher::RegisterMapWatcher(std::filesystem::path path) : path_(std::move(path)) {
+  Stamp stamp = Current();
+  InstallRegisterMap(RegisterMap::Load(path_));
+  loaded_ = stamp;
+}
+
+bool RegisterMapWatcher::Poll(std::string* error) {
+  Stamp stamp;
+  try {
+    stamp = Current();
+  } catch (const std::exception& ex) {
+    // The file may be mid-replacement by an editor; try again on the next poll.
+    Report(ex.what(), error);
+    return false;
+  }
+  if (stamp == loaded_) {
+    reported_.clear();
+    return false;
+  }
+  loaded_ = stamp;
+  try {
+    InstallRegisterMap(RegisterMap::Load(path_));
+  } catch (const std::exception& ex) {
+    Report(ex.what(), error);
+    return false;
+  }
+  reported_.clear();
+  return true;
+}
+
+void RegisterMapWatcher::Report(const std::string& what, std::string* error) {
+  if (what == reported_) {
+    return;
+  }
+  reported_ = what;
+  if (error) {
+    *error = what;
+  }
+}
+
+RegisterMapWatcher::Stamp RegisterMapWatcher::Current() const {
+  return Stamp{std::filesystem::last_write_time(path_), std::filesystem::file_size(path_)};
+}
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,73 @@
+#include "fujitsu/register_mirror.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+const char* ToString(RegisterSource source) {
+  return source == RegisterSource::kRead ? "read" : "write";
+}
+
+RegisterMirror::RegisterMirror() : slots_(std::make_unique<Slot[]>(0x10000)) {}
+
+std::size_t RegisterMirror::Apply(const Message& message, double time) {
+  std::size_t changes = 0;
+  if (const auto* response = std::get_if<ReadResponseView>(&message)) {
+    for (const auto entry : response->values) {
+      changes += Update(entry.address, entry.value, time, RegisterSource::kRead) ? 1 : 0;
+    }
+  } else if (const auto* request = std::get_if<WriteRequestView>(&message)) {
+    for (const auto entry : request->values) {
+      changes += Update(entry.address, entry.value, time, RegisterSource::kWrite) ? 1 : 0;
+    }
+  }
+  return changes;
+}
+
+bool RegisterMirror::Update(uint16_t address, uint16_t value, double time, RegisterSource source) {
+  Slot& slot = slots_[address];
+  RegisterState& state = slot.state;
+  if (slot.known && state.value == value) {
+    state.updated = time;
+    state.source = source;
+    return false;
+  }
+
+  RegisterChange change{address, std::nullopt, value, time, source};
+  if (slot.known) {
+    change.previous = state.value;
+  } else {
+    slot.known = true;
+    addresses_.push_back(address);
+  }
+  state = RegisterState{value, time, time, source};
+  Publish(change);
+  return true;
+}
+
+std::optional<RegisterState> RegisterMirror::Get(uint16_t address) const {
+  const Slot& slot = slots_[address];
+  if (!slot.known) {
+    return std::nullopt;
+  }
+  return slot.state;
+}
+
+RegisterMirror::SubscriptionId RegisterMirror::Subscribe(RegisterChangeCallback callback) {
+  SubscriptionId id = next_subscription_++;
+  subscribers_.emplace_back(id, std::move(callback));
+  return id;
+}
+
+void RegisterMirror::Unsubscribe(SubscriptionId id) {
+  std::erase_if(subscribers_, [id](const auto& entry) { return entry.first == id; });
+}
+
+void RegisterMirror::Publish(const RegisterChange& change) {
+  for (const auto& [id, callback] : subscribers_) {
+    callback(change);
+  }
+}
+
+}  // namespace fujitsu::airstage
@@ -0,0 +1,241 @@
+// Consistency checks: vectorised code against its scalar reference, and encoders against the
+// readers of what they produce. Prints each failed expectation and exits nonzero if there was
+// one; run by ctest.
+
+#include "fujitsu/checksum.h"
+#include "fujitsu/correlator.h"
+#include "fujitsu/encoder.h"
+#include "fujitsu/framer.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+#include "fujitsu/records.h"
+#include "fujitsu/synthetic.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using fujitsu::airstage::AppendBinaryCaptureRecord;
+using fujitsu::airstage::AppendBinaryRecord;
+using fujitsu::airstage::AppendRecordStreamHeader;
+using fujitsu::airstage::BinaryRecordReader;
+using fujitsu::airstage::BusDirection;
+using fujitsu::airstage::ByteEvent;
+using fujitsu::airstage::ChecksumBackend;
+using fujitsu::airstage::ComputeChecksum;
+using fujitsu::airstage::EncodePacket;
+using fujitsu::airstage::EncodeReadRequest;
+using fujitsu::airstage::EncodeSetpoint;
+using fujitsu::airstage::FindPacketStarts;
+using fujitsu::airstage::Frame;
+using fujitsu::airstage::FrameBuffer;
+using fujitsu::airstage::GenerateTraffic;
+using fujitsu::airstage::IsSupported;
+using fujitsu::airstage::kPacketHeaderBytes;
+using fujitsu::airstage::kPacketTrailerBytes;
+using fujitsu::airstage::Record;
+using fujitsu::airstage::RecordMessage;
+using fujitsu::airstage::RecordType;
+using fujitsu::airstage::RegisterValue;
+using fujitsu::airstage::SyntheticTrafficOptions;
+using fujitsu::airstage::ToString;
+using fujitsu::airstage::Transaction;
+using fujitsu::airstage::ValidateFrame;
+
+namespace {
+
+int g_failures = 0;
+
+void Expect(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << "FAIL: " << what << '\n';
+    ++g_failures;
+  }
+}
+
+// Every vector backend the CPU supports agrees with the scalar sum for all lengths up to a few
+// vectors past the widest and every start alignment within a cache line, so that the tails
+// and unaligned loads are covered. Bytes near 0xFF push the 64-bit lanes hardest.
+void CheckChecksumBackends() {
+  constexpr std::size_t kMaxLength = 300;
+  constexpr std::size_t kAlignments = 64;
+  std::mt19937 rng(17);
+  std::uniform_int_distribution<int> high_byte(0xC0, 0xFF);
+  std::vector<uint8_t> buffer(kMaxLength + kAlignments);
+  for (auto& value : buffer) {
+    value = static_cast<uint8_t>(high_byte(rng));
+  }
+  for (auto backend : {ChecksumBackend::kSse2, ChecksumBackend::kAvx2}) {
+    if (!IsSupported(backend)) {
+      std::cout << "checksum backend " << ToString(backend) << " not supported, skipped\n";
+      continue;
+    }
+    for (std::size_t alignment = 0; alignment < kAlignments; ++alignment) {
+      for (std::size_t length = 0; length <= kMaxLength; ++length) {
+        std::span<const uint8_t> bytes(buffer.data() + alignment, length);
+        if (ComputeChecksum(bytes, backend) != ComputeChecksum(bytes, ChecksumBackend::kScalar)) {
+          Expect(false, std::string(ToString(backend)) + " checksum, length " +
+                            std::to_string(length) + ", alignment " + std::to_string(alignment));
+          return;
+        }
+      }
+    }
+  }
+  // A buffer larger than a 32-bit lane sum could hold without the 64-bit accumulation.
+  std::vector<uint8_t> large(std::size_t{1} << 25, 0xFF);
+  Expect(ComputeChecksum(large) == ComputeChecksum(large, ChecksumBackend::kScalar),
+         "active checksum backend on a 32 MiB buffer");
+}
+
+// FindPacketStarts reports exactly the offsets at which ValidateFrame accepts the frame that
+// the length byte there describes, on traffic with enough noise to produce false starts.
+void CheckPacketStarts() {
+  for (double noise : {0.0, 0.01, 0.05}) {
+    SyntheticTrafficOptions options;
+    options.bytes = 1 << 16;
+    options.noise = noise;
+    std::vector<uint8_t> bytes;
+    for (const ByteEvent& event : GenerateTraffic(options)) {
+      bytes.push_back(event.value);
+    }
+    std::vector<std::size_t> expected;
+    for (std::size_t offset = 0; offset + kPacketHeaderBytes <= bytes.size(); ++offset) {
+      std::size_t length = kPacketHeaderBytes + bytes[offset + 4] + kPacketTrailerBytes;
+      if (offset + length <= bytes.size() &&
+          ValidateFrame(std::span<const uint8_t>(bytes).subspan(offset, length))) {
+        expected.push_back(offset);
+      }
+    }
+    Expect(FindPacketStarts(bytes) == expected,
+           "FindPacketStarts against ValidateFrame, noise " + std::to_string(noise));
+  }
+}
+
+Frame MakeFrame(Frame::Type type, BusDirection direction, double time,
+                std::span<const uint8_t> bytes) {
+  return Frame{type, direction, time, time + 0.001, {bytes.begin(), bytes.end()}};
+}
+
+// Every record type written with AppendBinaryRecord comes back field for field from
+// BinaryRecordReader, and the stream ends exactly after the last one.
+void CheckRecordRoundTrip() {
+  FrameBuffer buffer{};
+  static constexpr uint16_t kAddresses[] = {0x1000, 0x1001, 0x1020};
+  Frame request = MakeFrame(Frame::Type::Packet, BusDirection::Rx, 1.5,
+                            std::span(buffer).first(EncodeReadRequest(kAddresses, buffer)));
+  static constexpr uint8_t kResponsePayload[] = {0x00, 0x10, 0x00, 0x00, 0x01,
+                                                 0x10, 0x01, 0x00, 0x02,
+                                                 0x10, 0x20, 0x01, 0x2C};
+  Frame response = MakeFrame(
+      Frame::Type::Packet, BusDirection::Tx, 1.6,
+      std::span(buffer).first(EncodePacket(0x00000003, kResponsePayload, buffer)));
+  Frame write = MakeFrame(Frame::Type::Packet, BusDirection::Rx, 2.0,
+                          std::span(buffer).first(EncodeSetpoint(215, buffer)));
+  static constexpr uint8_t kOpaquePayload[] = {0xDE, 0xAD};
+  Frame opaque = MakeFrame(
+      Frame::Type::Packet, BusDirection::Rx, 2.5,
+      std::span(buffer).first(EncodePacket(0x00000077, kOpaquePayload, buffer)));
+  std::vector<uint8_t> corrupt(opaque.bytes);
+  corrupt.back() ^= 0xFF;
+  Frame invalid = MakeFrame(Frame::Type::Packet, BusDirection::Tx, 3.0, corrupt);
+  static constexpr uint8_t kBreak[] = {0xFF, 0xFF, 0x00, 0x00};
+  Frame brk = MakeFrame(Frame::Type::Break, BusDirection::Rx, 3.5, kBreak);
+  static constexpr uint8_t kRaw[] = {0x42};
+  Frame raw = MakeFrame(Frame::Type::Raw, BusDirection::Tx, 4.0, kRaw);
+  Transaction transaction{0x00000003, 1.5, 1.6, 0.099};
+  const std::string path = "captures/example.csv";
+
+  std::vector<uint8_t> stream;
+  AppendRecordStreamHeader(stream);
+  AppendBinaryCaptureRecord(path, stream);
+  AppendBinaryRecord(request, nullptr, stream);
+  AppendBinaryRecord(response, &transaction, stream);
+  AppendBinaryRecord(write, nullptr, stream);
+  AppendBinaryRecord(opaque, nullptr, stream);
+  AppendBinaryRecord(invalid, nullptr, stream);
+  AppendBinaryRecord(brk, nullptr, stream);
+  AppendBinaryRecord(raw, nullptr, stream);
+
+  struct Expected {
+    RecordType type;
+    RecordMessage message;
+    double time;
+    BusDirection direction;
+    uint32_t command_id;
+    std::vector<RegisterValue> registers;
+    std::vector<uint8_t> bytes;
+    bool matched;
+  };
+  const std::vector<Expected> expected = {
+      {RecordType::kCapture, RecordMessage::kNone, 0.0, BusDirection::Rx, 0, {},
+       {path.begin(), path.end()}, false},
+      {RecordType::kPacket, RecordMessage::kReadRequest, 1.5, BusDirection::Rx, 3,
+       {{0x1000, 0}, {0x1001, 0}, {0x1020, 0}}, {}, false},
+      {RecordType::kPacket, RecordMessage::kReadResponse, 1.6, BusDirection::Tx, 3,
+       {{0x1000, 1}, {0x1001, 2}, {0x1020, 300}}, {}, true},
+      {RecordType::kPacket, RecordMessage::kWriteRequest, 2.0, BusDirection::Rx, 2,
+       {{0x1002, 215}}, {}, false},
+      {RecordType::kPacket, RecordMessage::kOpaque, 2.5, BusDirection::Rx, 0x77, {},
+       {std::begin(kOpaquePayload), std::end(kOpaquePayload)}, false},
+      {RecordType::kInvalid, RecordMessage::kNone, 3.0, BusDirection::Tx, 0, {}, corrupt, false},
+      {RecordType::kBreak, RecordMessage::kNone, 3.5, BusDirection::Rx, 0, {}, {}, false},
+      {RecordType::kRaw, RecordMessage::kNone, 4.0, BusDirection::Tx, 0, {},
+       {std::begin(kRaw), std::end(kRaw)}, false},
+  };
+
+  BinaryRecordReader reader(stream);
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    const std::string label = "record " + std::to_string(i) + ": ";
+    std::optional<Record> record = reader.Next();
+    if (!record) {
+      Expect(false, label + "missing");
+      return;
+    }
+    const Expected& want = expected[i];
+    Expect(record->type == want.type, label + "type");
+    Expect(record->message == want.message, label + "message");
+    Expect(record->time == want.time, label + "time");
+    Expect(record->direction == want.direction, label + "direction");
+    Expect(record->command_id == want.command_id, label + "command id");
+    Expect(record->bytes == want.bytes, label + "bytes");
+    Expect(record->registers.size() == want.registers.size(), label + "register count");
+    for (std::size_t r = 0; r < record->registers.size() && r < want.registers.size(); ++r) {
+      Expect(record->registers[r].address == want.registers[r].address &&
+                 record->registers[r].value == want.registers[r].value,
+             label + "register " + std::to_string(r));
+    }
+    Expect(record->transaction.has_value() == want.matched, label + "transaction");
+    if (record->transaction && want.matched) {
+      Expect(record->transaction->request_time == transaction.request_time &&
+                 record->transaction->latency == transaction.latency,
+             label + "transaction times");
+    }
+  }
+  Expect(!reader.Next().has_value(), "records after the last one");
+}
+
+}  // namespace
+
+int main() {
+  try {
+    CheckChecksumBackends();
+    CheckPacketStarts();
+    CheckRecordRoundTrip();
+  } catch (const std::exception& ex) {
+    std::cerr << "FAIL: " << ex.what() << '\n';
+    ++g_failures;
+  }
+  if (g_failures != 0) {
+    std::cerr << g_failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "all checks passed\n";
+  return 0;
+}
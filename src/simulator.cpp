@@ -0,0 +1,489 @@
+#include "fujitsu/async_client.h"
+#include "fujitsu/classifier.h"
+#include "fujitsu/encoder.h"
+#include "fujitsu/framer.h"
+#include "fujitsu/messages.h"
+#include "fujitsu/packet.h"
+#include "fujitsu/poll_scheduler.h"
+#include "fujitsu/task.h"
+#include "fujitsu/transport.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using fujitsu::airstage::AsyncClient;
+using fujitsu::airstage::AsyncClientOptions;
+using fujitsu::airstage::BusDirection;
+using fujitsu::airstage::BusMonitor;
+using fujitsu::airstage::Classify;
+using fujitsu::airstage::EncodeReadRequest;
+using fujitsu::airstage::CommandId;
+using fujitsu::airstage::Frame;
+using fujitsu::airstage::FrameBuffer;
+using fujitsu::airstage::Message;
+using fujitsu::airstage::MonotonicSeconds;
+using fujitsu::airstage::OpenPseudoTerminal;
+using fujitsu::airstage::Packet;
+using fujitsu::airstage::PacketView;
+using fujitsu::airstage::ParsePacket;
+using fujitsu::airstage::ParsePacketView;
+using fujitsu::airstage::PollScheduler;
+using fujitsu::airstage::ReadRequestView;
+using fujitsu::airstage::ReadResult;
+using fujitsu::airstage::ReadResponseView;
+using fujitsu::airstage::RequestOptions;
+using fujitsu::airstage::RequestOutcome;
+using fujitsu::airstage::RunClientLoop;
+using fujitsu::airstage::SerialPort;
+using fujitsu::airstage::Task;
+using fujitsu::airstage::WriteRequestView;
+
+namespace {
+
+// Registers not listed in the captures read back as 0xFFFF, like unused slots on the unit.
+constexpr uint16_t kUnsetRegister = 0xFFFF;
+
+// Status byte the unit uses for successful reads, writes and handshakes.
+constexpr uint8_t kStatusOk = 0x01;
+
+// Address list the adapter polls most often in the captures.
+constexpr uint16_t kDefaultPollAddresses[] = {0x1000, 0x1001, 0x1003, 0x1002, 0x0130, 0x1010,
+                                              0x1011, 0x1023, 0x1022, 0x1121, 0x1108, 0x1102,
+                                              0x1101, 0x1120, 0x1100, 0x1031, 0x1109, 0x1142};
+
+struct SimulatorOptions {
+  double byte_gap = 0.0;          // extra idle time between response bytes (seconds)
+  double response_latency = 0.02;  // delay from request to first response byte (seconds)
+  double noise = 0.0;              // probability that a sent byte is corrupted
+  uint32_t seed = 1;
+  std::optional<std::filesystem::path> link;
+};
+
+struct ClientOptions {
+  std::filesystem::path device;
+  std::size_t requests = 100;
+  double timeout = 0.5;  // seconds to wait for each response
+  std::optional<double> poll_duration;  // run the polling scheduler for this long instead
+  std::size_t batch = fujitsu::airstage::kMaxReadAddresses;
+  std::size_t concurrency = 0;  // coroutines sharing an AsyncClient; 0 = synchronous client
+};
+
+// Refresh intervals for the scheduled polling mode: the control registers the adapter shows
+// to the user are kept fresh every second, everything else every five.
+constexpr std::size_t kFastPollRegisters = 4;
+constexpr double kFastPollInterval = 1.0;
+constexpr double kSlowPollInterval = 5.0;
+
+std::atomic<bool> g_stop_requested{false};
+
+void RequestStop(int) {
+  g_stop_requested = true;
+}
+
+// In-memory register file of the simulated indoor unit, seeded with the state seen in the
+// captures (running, heat, 68 F, auto fan).
+class RegisterFile {
+ public:
+  RegisterFile() {
+    values_.fill(kUnsetRegister);
+    values_[0x1000] = 0x0001;  // PowerState
+    values_[0x1001] = 0x0004;  // OperationMode = Heat
+    values_[0x1002] = 0x00C8;  // TemperatureSetpoint = 68 F
+    values_[0x1003] = 0x0000;  // FanSpeed = Auto
+    values_[0x1108] = 0x0000;  // EnergySavingFan
+    values_[0x0001] = 0x0001;
+  }
+
+  [[nodiscard]] uint16_t Read(uint16_t address) const { return values_[address]; }
+  void Write(uint16_t address, uint16_t value) { values_[address] = value; }
+
+ private:
+  std::array<uint16_t, 0x10000> values_{};
+};
+
+void AppendBigEndian(std::vector<uint8_t>* out, uint16_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+// Builds the unit's reply to one request, applying writes to the register file. Returns
+// std::nullopt for traffic the unit does not answer (responses, unknown commands).
+std::optional<Packet> BuildResponse(const PacketView& request, RegisterFile& registers) {
+  Packet response;
+  response.command_id = request.command_id;
+  const Message message = Classify(request, BusDirection::Rx);
+  if (const auto* read = std::get_if<ReadRequestView>(&message)) {
+    response.payload.push_back(kStatusOk);
+    for (uint16_t address : read->addresses) {
+      AppendBigEndian(&response.payload, address);
+      AppendBigEndian(&response.payload, registers.Read(address));
+    }
+    return response;
+  }
+  if (const auto* write = std::get_if<WriteRequestView>(&message)) {
+    for (const auto entry : write->values) {
+      registers.Write(entry.address, entry.value);
+    }
+    response.payload = {kStatusOk};
+    return response;
+  }
+  if (request.command_id == static_cast<uint32_t>(CommandId::kHandshake0) ||
+      request.command_id == static_cast<uint32_t>(CommandId::kHandshake1)) {
+    response.payload = {kStatusOk};
+    return response;
+  }
+  return std::nullopt;
+}
+
+void PrintUsage(const char* program) {
+  std::cout << "Usage: " << program
+            << " [--latency <seconds>] [--byte-gap <seconds>] [--noise <p>] [--seed <n>]"
+               " [--link <path>]\n";
+  std::cout << "  Emulates the indoor unit on a pseudo-terminal and prints the device to open.\n";
+  std::cout << "  --latency   Delay before answering a request (default 0.02)\n";
+  std::cout << "  --byte-gap  Extra idle time between response bytes (default 0)\n";
+  std::cout << "  --noise     Probability of corrupting each response byte (default 0)\n";
+  std::cout << "  --link      Create a symlink to the pty device at <path>\n";
+  std::cout << "       " << program << " --client <device> [--requests <n>] [--timeout <seconds>]\n"
+            << "       [--poll <seconds> [--batch <n>] | --concurrency <n>]\n";
+  std::cout << "  Sends read requests to a unit (or simulator) and reports throughput and latency.\n";
+  std::cout << "  --poll   Instead poll the usual registers for <seconds> with the scheduler\n";
+  std::cout << "  --batch  Registers per scheduled request (default " << fujitsu::airstage::kMaxReadAddresses
+            << "; 1 = one per request)\n";
+  std::cout << "  --concurrency  Instead share the requests among <n> coroutines on an AsyncClient\n";
+}
+
+struct PendingResponse {
+  double due = 0.0;
+  std::vector<uint8_t> bytes;
+};
+
+int RunSimulator(const SimulatorOptions& options) {
+  auto pty = OpenPseudoTerminal();
+  if (options.link) {
+    std::filesystem::remove(*options.link);
+    std::filesystem::create_symlink(pty.slave_path, *options.link);
+  }
+  std::cout << pty.slave_path << std::endl;
+
+  RegisterFile registers;
+  std::mt19937 rng(options.seed);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+  std::uniform_int_distribution<int> any_byte(0, 255);
+  std::deque<PendingResponse> outbox;
+  std::size_t requests = 0;
+
+  auto on_frame = [&](Frame&& frame) {
+    if (frame.type != Frame::Type::Packet) {
+      return;
+    }
+    auto request = ParsePacketView(frame.bytes);
+    if (!request) {
+      return;
+    }
+    ++requests;
+    if (auto response = BuildResponse(*request, registers)) {
+      outbox.push_back(
+          PendingResponse{MonotonicSeconds() + options.response_latency, response->Serialize()});
+    }
+  };
+
+  std::signal(SIGINT, RequestStop);
+  std::signal(SIGTERM, RequestStop);
+  // One pass per client: once the client closes the slave the master reports a hang-up until
+  // the next one opens it, and the monitor stops reading from it.
+  while (!g_stop_requested) {
+    BusMonitor monitor(on_frame);
+    monitor.AddSource(pty.master, BusDirection::Rx);
+    bool attached = true;
+    while (attached && !g_stop_requested) {
+      double wait = 0.1;
+      if (!outbox.empty()) {
+        wait = std::clamp(outbox.front().due - MonotonicSeconds(), 0.0, wait);
+      }
+      attached = monitor.Poll(std::chrono::milliseconds(static_cast<int>(wait * 1000.0)));
+
+      while (attached && !outbox.empty() && outbox.front().due <= MonotonicSeconds()) {
+        std::vector<uint8_t> bytes = std::move(outbox.front().bytes);
+        outbox.pop_front();
+        for (auto& byte : bytes) {
+          if (options.noise > 0.0 && chance(rng) < options.noise) {
+            byte = static_cast<uint8_t>(any_byte(rng));
+          }
+        }
+        if (options.byte_gap <= 0.0) {
+          pty.master.WriteAll(bytes);
+          continue;
+        }
+        for (uint8_t byte : bytes) {
+          pty.master.WriteAll(std::span<const uint8_t>(&byte, 1));
+          std::this_thread::sleep_for(std::chrono::duration<double>(options.byte_gap));
+        }
+      }
+    }
+
+    // Answers still owed to the departed client would reach the next one as stale responses.
+    outbox.clear();
+    while (!g_stop_requested && pty.master.PeerClosed()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  }
+
+  std::cerr << requests << " requests served\n";
+  return 0;
+}
+
+int RunClient(const ClientOptions& options) {
+  SerialPort port(options.device);
+  std::size_t responses = 0;
+  std::size_t timeouts = 0;
+  std::size_t malformed = 0;
+  double total_rtt = 0.0;
+  double max_rtt = 0.0;
+  std::optional<double> answered_at;
+
+  BusMonitor monitor([&](Frame&& frame) {
+    auto message = Classify(frame);
+    if (message && std::holds_alternative<ReadResponseView>(*message)) {
+      answered_at = MonotonicSeconds();
+    } else {
+      ++malformed;
+    }
+  });
+  monitor.AddSource(port, BusDirection::Tx);
+
+  FrameBuffer request;
+  const std::span<const uint8_t> request_bytes(
+      request.data(), EncodeReadRequest(kDefaultPollAddresses, request));
+
+  double started = MonotonicSeconds();
+  for (std::size_t i = 0; i < options.requests && !g_stop_requested; ++i) {
+    answered_at.reset();
+    double sent_at = MonotonicSeconds();
+    port.WriteAll(request_bytes);
+    while (!answered_at && MonotonicSeconds() - sent_at < options.timeout) {
+      monitor.Poll(std::chrono::milliseconds(10));
+    }
+    if (!answered_at) {
+      ++timeouts;
+      continue;
+    }
+    double rtt = *answered_at - sent_at;
+    ++responses;
+    total_rtt += rtt;
+    max_rtt = std::max(max_rtt, rtt);
+  }
+  double elapsed = MonotonicSeconds() - started;
+  monitor.Finish();
+
+  const auto& latency = monitor.latency();
+  std::cout << responses << " responses, " << timeouts << " timeouts, " << malformed
+            << " unexpected frames in " << elapsed << " s ("
+            << (elapsed > 0 ? responses / elapsed : 0.0) << " req/s)\n";
+  std::cout << "round trip mean " << (responses ? total_rtt / responses * 1000.0 : 0.0)
+            << " ms, max " << max_rtt * 1000.0 << " ms\n";
+  std::cout << "decoder latency mean " << latency.mean_seconds() * 1000.0 << " ms, max "
+            << latency.max_seconds * 1000.0 << " ms\n";
+  return timeouts == 0 ? 0 : 3;
+}
+
+struct AsyncTally {
+  std::size_t issued = 0;
+  std::array<std::size_t, 4> outcomes{};  // by RequestOutcome
+  double total_seconds = 0.0;             // from co_await to result, queueing included
+  double max_seconds = 0.0;
+};
+
+// One of several coroutines issuing the client's reads until `options.requests` have gone out.
+Task<> ReadWorker(AsyncClient& client, const ClientOptions& options, std::stop_token stop,
+                  AsyncTally& tally) {
+  RequestOptions request;
+  request.stop = stop;
+  while (tally.issued < options.requests && !stop.stop_requested()) {
+    ++tally.issued;
+    double started = MonotonicSeconds();
+    ReadResult result = co_await client.Read(kDefaultPollAddresses, request);
+    ++tally.outcomes[static_cast<std::size_t>(result.outcome)];
+    if (result.ok()) {
+      double seconds = MonotonicSeconds() - started;
+      tally.total_seconds += seconds;
+      tally.max_seconds = std::max(tally.max_seconds, seconds);
+    }
+  }
+}
+
+// Same workload as RunClient, multiplexed over one AsyncClient by several coroutines.
+int RunAsyncClient(const ClientOptions& options) {
+  SerialPort port(options.device);
+  AsyncClientOptions client_options;
+  client_options.response_timeout = options.timeout;
+  AsyncClient client([&port](std::span<const uint8_t> frame) { port.WriteAll(frame); },
+                     client_options);
+
+  std::stop_source stop;
+  AsyncTally tally;
+  std::vector<Task<>> workers;
+  for (std::size_t i = 0; i < options.concurrency; ++i) {
+    workers.push_back(ReadWorker(client, options, stop.get_token(), tally));
+    workers.back().Start();
+  }
+  double started = MonotonicSeconds();
+  RunClientLoop(client, port, [&] {
+    if (g_stop_requested) {
+      stop.request_stop();
+    }
+    return std::all_of(workers.begin(), workers.end(), [](const Task<>& w) { return w.done(); });
+  });
+  double elapsed = MonotonicSeconds() - started;
+
+  const auto& stats = client.stats();
+  std::size_t ok = tally.outcomes[static_cast<std::size_t>(RequestOutcome::kOk)];
+  std::cout << ok << " responses, "
+            << tally.outcomes[static_cast<std::size_t>(RequestOutcome::kTimedOut)]
+            << " timeouts, " << tally.outcomes[static_cast<std::size_t>(RequestOutcome::kCorrupted)]
+            << " corrupted, " << tally.outcomes[static_cast<std::size_t>(RequestOutcome::kCancelled)]
+            << " cancelled in " << elapsed << " s (" << (elapsed > 0 ? ok / elapsed : 0.0)
+            << " req/s) from " << options.concurrency << " coroutines\n";
+  std::cout << stats.frames_sent << " frames sent, " << stats.retries << " retries, "
+            << stats.corrupt_responses << " corrupt responses, " << stats.stray_frames
+            << " stray frames\n";
+  std::cout << "read time mean " << (ok ? tally.total_seconds / ok * 1000.0 : 0.0)
+            << " ms, max " << tally.max_seconds * 1000.0 << " ms (queueing included)\n";
+  return ok == tally.issued ? 0 : 3;
+}
+
+// Keeps the usual registers fresh with a PollScheduler and reports how many frames that took.
+int RunPollClient(const ClientOptions& options) {
+  SerialPort port(options.device);
+  PollScheduler scheduler(0.02, options.batch);
+  std::optional<Packet> response;
+  BusMonitor monitor([&](Frame&& frame) {
+    if (frame.type == Frame::Type::Packet) {
+      response = ParsePacket(frame.bytes);
+    }
+  });
+  monitor.AddSource(port, BusDirection::Tx);
+
+  double started = MonotonicSeconds();
+  std::array<std::optional<double>, std::size(kDefaultPollAddresses)> last_refresh{};
+  double worst_staleness = 0.0;
+  for (std::size_t i = 0; i < std::size(kDefaultPollAddresses); ++i) {
+    double interval = i < kFastPollRegisters ? kFastPollInterval : kSlowPollInterval;
+    scheduler.Watch(kDefaultPollAddresses[i], interval, 0.0);
+  }
+
+  double sent_at = 0.0;
+  while (!g_stop_requested) {
+    double now = MonotonicSeconds() - started;
+    if (now >= *options.poll_duration) {
+      break;
+    }
+    if (auto request = scheduler.NextRequest(now)) {
+      port.WriteAll(request->Serialize());
+      sent_at = now;
+    }
+    double wait = scheduler.awaiting_response()
+                      ? scheduler.response_timeout() - (now - sent_at)
+                      : scheduler.NextDue().value_or(now + 0.1) - now;
+    monitor.Poll(std::chrono::milliseconds(std::clamp(static_cast<int>(wait * 1000.0), 0, 100)));
+    now = MonotonicSeconds() - started;
+    if (response) {
+      if (auto values = scheduler.OnResponse(*response, now)) {
+        for (const auto& entry : values->values) {
+          auto slot = std::find(std::begin(kDefaultPollAddresses), std::end(kDefaultPollAddresses),
+                                entry.address) -
+                      std::begin(kDefaultPollAddresses);
+          if (slot < static_cast<std::ptrdiff_t>(last_refresh.size())) {
+            if (last_refresh[slot]) {
+              worst_staleness = std::max(worst_staleness, now - *last_refresh[slot]);
+            }
+            last_refresh[slot] = now;
+          }
+        }
+      }
+      response.reset();
+    } else if (scheduler.awaiting_response() && now - sent_at > scheduler.response_timeout()) {
+      scheduler.OnTimeout(now);
+    }
+  }
+  double elapsed = MonotonicSeconds() - started;
+
+  const auto& stats = scheduler.stats();
+  std::cout << stats.requests << " requests (" << stats.requests / elapsed << " frames/s), "
+            << stats.registers_read << " registers read, " << stats.timeouts << " timeouts in "
+            << elapsed << " s\n";
+  std::cout << "smoothed latency " << scheduler.smoothed_latency() * 1000.0
+            << " ms, longest gap between refreshes " << worst_staleness << " s\n";
+  return stats.timeouts == 0 ? 0 : 3;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  SimulatorOptions simulator;
+  ClientOptions client;
+  bool client_mode = false;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+    bool has_value = i + 1 < argc;
+    if (arg == "--latency" && has_value) {
+      simulator.response_latency = std::stod(argv[++i]);
+    } else if (arg == "--byte-gap" && has_value) {
+      simulator.byte_gap = std::stod(argv[++i]);
+    } else if (arg == "--noise" && has_value) {
+      simulator.noise = std::stod(argv[++i]);
+    } else if (arg == "--seed" && has_value) {
+      simulator.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--link" && has_value) {
+      simulator.link = argv[++i];
+    } else if (arg == "--client" && has_value) {
+      client.device = argv[++i];
+      client_mode = true;
+    } else if (arg == "--requests" && has_value) {
+      client.requests = std::stoul(argv[++i]);
+    } else if (arg == "--poll" && has_value) {
+      client.poll_duration = std::stod(argv[++i]);
+    } else if (arg == "--concurrency" && has_value) {
+      client.concurrency = std::stoul(argv[++i]);
+    } else if (arg == "--batch" && has_value) {
+      client.batch = std::stoul(argv[++i]);
+    } else if (arg == "--timeout" && has_value) {
+      client.timeout = std::stod(argv[++i]);
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  try {
+    if (client_mode) {
+      if (client.poll_duration) {
+        return RunPollClient(client);
+      }
+      return client.concurrency > 0 ? RunAsyncClient(client) : RunClient(client);
+    }
+    return RunSimulator(simulator);
+  } catch (const std::exception& ex) {
+    std::cerr << "Error: " << ex.what() << '\n';
+    return 2;
+  }
+}
@@ -0,0 +1,73 @@
+#include "fujitsu/synthetic.h"
+
+#include "fujitsu/encoder.h"
+
+#include <array>
+#include <random>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+constexpr uint16_t kPolledAddresses[] = {0x1000, 0x1001, 0x1003, 0x1002, 0x0130, 0x1010,
+                                         0x1011, 0x1023, 0x1022, 0x1121, 0x1108, 0x1102,
+                                         0x1101, 0x1120, 0x1100, 0x1031, 0x1109, 0x1142};
+
+// One control write for every this many polls.
+constexpr unsigned kPollsPerWrite = 8;
+
+}  // namespace
+
+std::vector<ByteEvent> GenerateTraffic(const SyntheticTrafficOptions& options) {
+  std::mt19937 rng(options.seed);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+  std::uniform_int_distribution<int> any_byte(0, 255);
+  std::uniform_int_distribution<int> any_value(0, 4);
+
+  std::vector<ByteEvent> events;
+  events.reserve(options.bytes + kMaxPacketBytes * 2);
+  double time = 0.0;
+  auto emit = [&](std::span<const uint8_t> frame, BusDirection direction) {
+    for (uint8_t byte : frame) {
+      bool corrupt = options.noise > 0.0 && chance(rng) < options.noise;
+      events.push_back(ByteEvent{direction, time,
+                                 corrupt ? static_cast<uint8_t>(any_byte(rng)) : byte, corrupt});
+      time += options.byte_seconds;
+    }
+  };
+
+  FrameBuffer request;
+  FrameBuffer response;
+  for (unsigned transaction = 0; events.size() < options.bytes; ++transaction) {
+    if (transaction % kPollsPerWrite == kPollsPerWrite - 1) {
+      RegisterValue write{0x1001, static_cast<uint16_t>(any_value(rng))};
+      emit(std::span(request.data(), EncodeControlWrite(write, request)), BusDirection::Rx);
+      time += options.response_latency;
+      const uint8_t ack = 0x01;
+      emit(std::span(response.data(),
+                     EncodePacket(static_cast<uint32_t>(CommandId::kControlRegister),
+                                  std::span(&ack, 1), response)),
+           BusDirection::Tx);
+    } else {
+      emit(std::span(request.data(), EncodeReadRequest(kPolledAddresses, request)),
+           BusDirection::Rx);
+      time += options.response_latency;
+      std::array<uint8_t, 1 + std::size(kPolledAddresses) * 4> payload{0x01};
+      for (std::size_t i = 0; i < std::size(kPolledAddresses); ++i) {
+        uint16_t value = static_cast<uint16_t>(any_value(rng));
+        payload[1 + i * 4] = static_cast<uint8_t>(kPolledAddresses[i] >> 8);
+        payload[2 + i * 4] = static_cast<uint8_t>(kPolledAddresses[i] & 0xFF);
+        payload[3 + i * 4] = static_cast<uint8_t>(value >> 8);
+        payload[4 + i * 4] = static_cast<uint8_t>(value & 0xFF);
+      }
+      emit(std::span(response.data(),
+                     EncodePacket(static_cast<uint32_t>(CommandId::kReadRegisters), payload,
+                                  response)),
+           BusDirection::Tx);
+    }
+    time += options.poll_interval;
+  }
+  return events;
+}
+
+}  // namespace fujitsu::airstage
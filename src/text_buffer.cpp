@@ -0,0 +1,68 @@
+#include "fujitsu/text_buffer.h"
+
+#include <array>
+#include <charconv>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+// Two upper-case hex digits for every byte value.
+constexpr std::array<char, 512> kHexPairs = [] {
+  constexpr char kDigits[] = "0123456789ABCDEF";
+  std::array<char, 512> pairs{};
+  for (std::size_t i = 0; i < 256; ++i) {
+    pairs[2 * i] = kDigits[i >> 4];
+    pairs[2 * i + 1] = kDigits[i & 0xF];
+  }
+  return pairs;
+}();
+
+}  // namespace
+
+void TextBuffer::AppendHex(uint32_t value, int digits) {
+  std::size_t offset = text_.size();
+  text_.resize(offset + static_cast<std::size_t>(digits));
+  char* out = text_.data() + offset + digits;
+  for (int i = 0; i < digits; i += 2) {
+    const char* pair = &kHexPairs[2 * (value & 0xFF)];
+    *--out = pair[1];
+    *--out = pair[0];
+    value >>= 8;
+  }
+}
+
+void TextBuffer::AppendDecimal(uint64_t value) {
+  char digits[20];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  text_.append(digits, result.ptr);
+}
+
+void TextBuffer::AppendDouble(double value) {
+  char digits[32];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  text_.append(digits, result.ptr);
+}
+
+void TextBuffer::AppendFixed(double value, int precision, int width) {
+  char digits[64];
+  auto result =
+      std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+  if (result.ec != std::errc{}) {
+    // Only magnitudes beyond 1e50 or so overflow the scratch space; no timestamp or register
+    // value gets there, but fall back to the general form rather than printing nothing.
+    result = std::to_chars(digits, digits + sizeof(digits), value);
+  }
+  auto length = static_cast<int>(result.ptr - digits);
+  if (length < width) {
+    text_.append(static_cast<std::size_t>(width - length), ' ');
+  }
+  text_.append(digits, result.ptr);
+}
+
+void TextBuffer::WriteTo(std::ostream& os) {
+  os.write(text_.data(), static_cast<std::streamsize>(text_.size()));
+  text_.clear();
+}
+
+}  // namespace fujitsu::airstage
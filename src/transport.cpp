@@ -0,0 +1,302 @@
+#include "fujitsu/transport.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+// Bytes read per read() call; comfortably more than arrives between polls at 9600 baud.
+constexpr std::size_t kReadChunk = 256;
+
+std::runtime_error SystemError(const std::string& what) {
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+speed_t ToSpeed(uint32_t baud) {
+  switch (baud) {
+    case 1200:
+      return B1200;
+    case 2400:
+      return B2400;
+    case 4800:
+      return B4800;
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 115200:
+      return B115200;
+    default:
+      throw std::runtime_error("unsupported baud rate: " + std::to_string(baud));
+  }
+}
+
+}  // namespace
+
+SerialPort::SerialPort(const std::filesystem::path& device, const SerialSettings& settings)
+    : settings_(settings) {
+  fd_ = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd_ < 0) {
+    throw SystemError("failed to open serial device " + device.string());
+  }
+  try {
+    Configure();
+  } catch (...) {
+    Close();
+    throw;
+  }
+}
+
+SerialPort::SerialPort(int fd, const SerialSettings& settings) : fd_(fd), settings_(settings) {
+  try {
+    Configure();
+  } catch (...) {
+    Close();
+    throw;
+  }
+}
+
+SerialPort::~SerialPort() {
+  Close();
+}
+
+SerialPort::SerialPort(SerialPort&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)), settings_(other.settings_) {}
+
+SerialPort& SerialPort::operator=(SerialPort&& other) noexcept {
+  if (this != &other) {
+    Close();
+    fd_ = std::exchange(other.fd_, -1);
+    settings_ = other.settings_;
+  }
+  return *this;
+}
+
+void SerialPort::Configure() {
+  int flags = ::fcntl(fd_, F_GETFL);
+  if (flags < 0 || ::fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+    throw SystemError("failed to make serial device non-blocking");
+  }
+
+  termios tio {};
+  if (::tcgetattr(fd_, &tio) != 0) {
+    throw SystemError("failed to read serial line settings");
+  }
+  ::cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | PARENB | PARODD | CSIZE);
+  tio.c_cflag |= CS8;
+  if (settings_.parity != Parity::kNone) {
+    tio.c_cflag |= PARENB;
+    if (settings_.parity == Parity::kOdd) {
+      tio.c_cflag |= PARODD;
+    }
+  }
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  speed_t speed = ToSpeed(settings_.baud);
+  ::cfsetispeed(&tio, speed);
+  ::cfsetospeed(&tio, speed);
+  if (::tcsetattr(fd_, TCSANOW, &tio) != 0) {
+    throw SystemError("failed to apply serial line settings");
+  }
+}
+
+void SerialPort::Close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+std::size_t SerialPort::Read(std::span<uint8_t> buffer, bool* closed) {
+  for (;;) {
+    ssize_t n = ::read(fd_, buffer.data(), buffer.size());
+    if (n > 0) {
+      return static_cast<std::size_t>(n);
+    }
+    if (n == 0) {
+      // With VMIN = VTIME = 0 a terminal reports "no data" as a zero-length read, so hang-ups
+      // are detected through poll() (POLLHUP) or EIO instead.
+      return 0;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    if (errno == EIO) {
+      if (closed) {
+        *closed = true;
+      }
+      return 0;
+    }
+    throw SystemError("failed to read from serial device");
+  }
+}
+
+void SerialPort::WriteAll(std::span<const uint8_t> bytes) {
+  while (!bytes.empty()) {
+    ssize_t n = ::write(fd_, bytes.data(), bytes.size());
+    if (n > 0) {
+      bytes = bytes.subspan(static_cast<std::size_t>(n));
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      pollfd pfd{fd_, POLLOUT, 0};
+      ::poll(&pfd, 1, -1);
+      continue;
+    }
+    throw SystemError("failed to write to serial device");
+  }
+}
+
+bool SerialPort::PeerClosed() const {
+  pollfd pfd{fd_, POLLIN, 0};
+  if (::poll(&pfd, 1, 0) < 0 && errno != EINTR) {
+    throw SystemError("failed to poll serial device");
+  }
+  return (pfd.revents & POLLHUP) != 0;
+}
+
+PseudoTerminal OpenPseudoTerminal(const SerialSettings& settings) {
+  int master = ::posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (master < 0) {
+    throw SystemError("failed to allocate pseudo-terminal");
+  }
+  if (::grantpt(master) != 0 || ::unlockpt(master) != 0) {
+    ::close(master);
+    throw SystemError("failed to unlock pseudo-terminal");
+  }
+  std::array<char, 128> name{};
+  if (::ptsname_r(master, name.data(), name.size()) != 0) {
+    ::close(master);
+    throw SystemError("failed to name pseudo-terminal");
+  }
+  return PseudoTerminal{SerialPort(master, settings), std::string(name.data())};
+}
+
+double MonotonicSeconds() {
+  timespec ts {};
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+BusMonitor::BusMonitor(FrameCallback on_frame, double gap_threshold)
+    : on_frame_(std::move(on_frame)),
+      gap_threshold_(gap_threshold),
+      epoch_(MonotonicSeconds()),
+      sequencer_([this](Frame&& frame) { Deliver(std::move(frame)); }, gap_threshold) {}
+
+BusMonitor::BusMonitor(ByteBatchCallback on_bytes, double gap_threshold)
+    : on_bytes_(std::move(on_bytes)),
+      gap_threshold_(gap_threshold),
+      epoch_(MonotonicSeconds()),
+      sequencer_([](Frame&&) {}, gap_threshold) {}
+
+void BusMonitor::AddSource(SerialPort& port, BusDirection direction) {
+  sources_.push_back(Source{&port, direction, true});
+}
+
+bool BusMonitor::Poll(std::chrono::milliseconds timeout) {
+  std::vector<pollfd> fds;
+  std::vector<Source*> polled;
+  for (auto& source : sources_) {
+    if (source.open) {
+      fds.push_back(pollfd{source.port->fd(), POLLIN, 0});
+      polled.push_back(&source);
+    }
+  }
+  if (fds.empty()) {
+    return false;
+  }
+
+  // Wake up in time to expire a partial frame once the gap threshold has elapsed.
+  int timeout_ms = static_cast<int>(timeout.count());
+  bool partial_frame = on_bytes_ ? bytes_pending_ : sequencer_.pending_since().has_value();
+  if (partial_frame) {
+    double expire_in = last_byte_time_ + gap_threshold_ - Now();
+    timeout_ms = std::min(timeout_ms, std::max(0, static_cast<int>(std::ceil(expire_in * 1000.0))));
+  }
+
+  int ready = ::poll(fds.data(), fds.size(), timeout_ms);
+  if (ready < 0 && errno != EINTR) {
+    throw SystemError("failed to poll serial devices");
+  }
+
+  std::array<uint8_t, kReadChunk> buffer{};
+  batch_.clear();
+  for (std::size_t i = 0; ready > 0 && i < fds.size(); ++i) {
+    if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+      continue;
+    }
+    Source& source = *polled[i];
+    bool closed = false;
+    std::size_t n;
+    while ((n = source.port->Read(buffer, &closed)) > 0) {
+      // Bytes that arrive in one read are back-dated by their time on the wire so gaps inside
+      // a burst stay realistic; times never go backwards across sources.
+      double now = Now();
+      double byte_seconds = source.port->settings().byte_seconds();
+      for (std::size_t b = 0; b < n; ++b) {
+        double time = now - static_cast<double>(n - 1 - b) * byte_seconds;
+        floor_time_ = std::max(floor_time_, time);
+        ByteEvent event{source.direction, floor_time_, buffer[b], false};
+        if (on_bytes_) {
+          batch_.push_back(event);
+        } else {
+          sequencer_.Push(event);
+        }
+      }
+      last_byte_time_ = floor_time_;
+    }
+    if (closed || (fds[i].revents & (POLLIN | POLLHUP)) == POLLHUP) {
+      source.open = false;
+    }
+  }
+
+  floor_time_ = std::max(floor_time_, Now());
+  if (on_bytes_) {
+    bytes_pending_ = !batch_.empty() ||
+                     (bytes_pending_ && floor_time_ - last_byte_time_ <= gap_threshold_);
+    on_bytes_(batch_, floor_time_);
+  } else {
+    sequencer_.Advance(floor_time_);
+  }
+  return std::any_of(sources_.begin(), sources_.end(), [](const Source& s) { return s.open; });
+}
+
+void BusMonitor::Finish() {
+  sequencer_.Finish();
+}
+
+void BusMonitor::Deliver(Frame&& frame) {
+  double latency = Now() - frame.end_time;
+  ++latency_.frames;
+  latency_.total_seconds += latency;
+  latency_.max_seconds = std::max(latency_.max_seconds, latency);
+  on_frame_(std::move(frame));
+}
+
+}  // namespace fujitsu::airstage
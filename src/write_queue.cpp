@@ -0,0 +1,59 @@
+#include "fujitsu/write_queue.h"
+
+#include <algorithm>
+
+namespace fujitsu::airstage {
+
+WriteQueue::WriteQueue(double settle, double max_delay) : settle_(settle), max_delay_(max_delay) {
+  pending_.reserve(kMaxWriteValues);
+}
+
+void WriteQueue::Set(uint16_t address, uint16_t value, double now, CommandId single_command) {
+  ++stats_.writes;
+  if (pending_.empty()) {
+    first_queued_ = now;
+  }
+  last_changed_ = now;
+  auto it = std::find_if(pending_.begin(), pending_.end(),
+                         [address](const Pending& p) { return p.value.address == address; });
+  if (it != pending_.end()) {
+    it->value.value = value;
+    it->single_command = single_command;
+    ++stats_.coalesced;
+    return;
+  }
+  pending_.push_back(Pending{RegisterValue{address, value}, single_command});
+}
+
+std::optional<double> WriteQueue::ReadyAt() const {
+  if (pending_.empty()) {
+    return std::nullopt;
+  }
+  return std::min(last_changed_ + settle_, first_queued_ + max_delay_);
+}
+
+std::size_t WriteQueue::TakeFrame(double now, std::span<uint8_t> out) {
+  auto ready_at = ReadyAt();
+  if (!ready_at || now < *ready_at) {
+    return 0;
+  }
+
+  std::size_t count = std::min(pending_.size(), kMaxWriteValues);
+  std::array<RegisterValue, kMaxWriteValues> values;
+  for (std::size_t i = 0; i < count; ++i) {
+    values[i] = pending_[i].value;
+  }
+  CommandId command = count == 1 ? pending_.front().single_command : CommandId::kBulkWrite;
+  std::size_t length = EncodeWriteRequest(command, std::span(values.data(), count), out);
+  if (length == 0) {
+    return 0;
+  }
+
+  pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(count));
+  // Whatever did not fit has already waited; let it follow without a new settle period.
+  first_queued_ = now - max_delay_;
+  ++stats_.frames;
+  return length;
+}
+
+}  // namespace fujitsu::airstage
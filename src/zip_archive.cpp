@@ -0,0 +1,175 @@
+#include "fujitsu/zip_archive.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace fujitsu::airstage {
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr uint32_t kEndOfDirectorySignature = 0x06054b50;
+constexpr std::size_t kLocalHeaderBytes = 30;
+constexpr std::size_t kCentralHeaderBytes = 46;
+constexpr std::size_t kEndOfDirectoryBytes = 22;
+constexpr uint16_t kMethodStored = 0;
+constexpr uint16_t kMethodDeflated = 8;
+
+template <typename T>
+T GetLittleEndian(const uint8_t* in) {
+  uint64_t bits = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    bits |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return static_cast<T>(bits);
+}
+
+std::runtime_error Malformed(const std::string& what) {
+  return std::runtime_error("malformed zip archive: " + what);
+}
+
+std::vector<uint8_t> Inflate(std::span<const uint8_t> input, std::size_t size) {
+  std::vector<uint8_t> output(size);
+  z_stream stream{};
+  // Negative window bits: raw deflate data without a zlib header, as stored in zip members.
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+    throw std::runtime_error("failed to initialise zlib");
+  }
+  stream.next_in = const_cast<Bytef*>(input.data());
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = output.data();
+  stream.avail_out = static_cast<uInt>(output.size());
+  int status = inflate(&stream, Z_FINISH);
+  std::size_t produced = stream.total_out;
+  inflateEnd(&stream);
+  if (status != Z_STREAM_END || produced != size) {
+    throw Malformed("corrupt deflate stream");
+  }
+  return output;
+}
+
+}  // namespace
+
+bool IsZipArchive(std::span<const uint8_t> bytes) {
+  return bytes.size() >= 4 && GetLittleEndian<uint32_t>(bytes.data()) == kLocalHeaderSignature;
+}
+
+ZipArchive::ZipArchive(const std::filesystem::path& path) : ZipArchive(MappedFile(path)) {}
+
+ZipArchive::ZipArchive(MappedFile file) : file_(std::move(file)) {
+  std::span<const uint8_t> bytes = file_.bytes();
+  if (bytes.size() < kEndOfDirectoryBytes) {
+    throw Malformed("too short");
+  }
+  // The end-of-directory record sits at the very end, followed only by an optional comment.
+  std::size_t lowest = bytes.size() > kEndOfDirectoryBytes + 0xFFFF
+                           ? bytes.size() - kEndOfDirectoryBytes - 0xFFFF
+                           : 0;
+  std::optional<std::size_t> eocd;
+  for (std::size_t pos = bytes.size() - kEndOfDirectoryBytes + 1; pos-- > lowest;) {
+    if (GetLittleEndian<uint32_t>(bytes.data() + pos) == kEndOfDirectorySignature) {
+      eocd = pos;
+      break;
+    }
+  }
+  if (!eocd) {
+    throw Malformed("missing end of central directory");
+  }
+
+  const uint8_t* end_record = bytes.data() + *eocd;
+  auto count = GetLittleEndian<uint16_t>(end_record + 10);
+  auto directory_size = GetLittleEndian<uint32_t>(end_record + 12);
+  auto directory_offset = GetLittleEndian<uint32_t>(end_record + 16);
+  if (directory_offset > *eocd || *eocd - directory_offset < directory_size) {
+    throw Malformed("central directory out of bounds");
+  }
+
+  const uint8_t* pos = bytes.data() + directory_offset;
+  const uint8_t* const directory_end = pos + directory_size;
+  members_.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (directory_end - pos < static_cast<std::ptrdiff_t>(kCentralHeaderBytes) ||
+        GetLittleEndian<uint32_t>(pos) != kCentralHeaderSignature) {
+      throw Malformed("bad central directory entry");
+    }
+    Member member;
+    member.method = GetLittleEndian<uint16_t>(pos + 10);
+    member.crc = GetLittleEndian<uint32_t>(pos + 16);
+    member.compressed_size = GetLittleEndian<uint32_t>(pos + 20);
+    member.size = GetLittleEndian<uint32_t>(pos + 24);
+    auto name_length = GetLittleEndian<uint16_t>(pos + 28);
+    auto extra_length = GetLittleEndian<uint16_t>(pos + 30);
+    auto comment_length = GetLittleEndian<uint16_t>(pos + 32);
+    member.local_header_offset = GetLittleEndian<uint32_t>(pos + 42);
+    std::size_t entry_size = kCentralHeaderBytes + name_length + extra_length + comment_length;
+    if (directory_end - pos < static_cast<std::ptrdiff_t>(entry_size)) {
+      throw Malformed("bad central directory entry");
+    }
+    member.name.assign(reinterpret_cast<const char*>(pos + kCentralHeaderBytes), name_length);
+    members_.push_back(std::move(member));
+    pos += entry_size;
+  }
+}
+
+std::vector<std::string> ZipArchive::names() const {
+  std::vector<std::string> result;
+  result.reserve(members_.size());
+  for (const auto& member : members_) {
+    result.push_back(member.name);
+  }
+  return result;
+}
+
+std::optional<std::vector<uint8_t>> ZipArchive::Read(const std::string& name) const {
+  auto it = std::find_if(members_.begin(), members_.end(),
+                         [&name](const Member& member) { return member.name == name; });
+  if (it == members_.end()) {
+    return std::nullopt;
+  }
+
+  std::span<const uint8_t> bytes = file_.bytes();
+  if (it->local_header_offset > bytes.size() ||
+      bytes.size() - it->local_header_offset < kLocalHeaderBytes) {
+    throw Malformed(name + ": local header out of bounds");
+  }
+  const uint8_t* header = bytes.data() + it->local_header_offset;
+  if (GetLittleEndian<uint32_t>(header) != kLocalHeaderSignature) {
+    throw Malformed(name + ": bad local header");
+  }
+  // Sizes come from the central directory; the local copy may be zero when a data descriptor
+  // follows the member.
+  uint64_t data_offset = it->local_header_offset + kLocalHeaderBytes +
+                         GetLittleEndian<uint16_t>(header + 26) +
+                         GetLittleEndian<uint16_t>(header + 28);
+  if (data_offset > bytes.size() || bytes.size() - data_offset < it->compressed_size) {
+    throw Malformed(name + ": data out of bounds");
+  }
+  std::span<const uint8_t> data = bytes.subspan(data_offset, it->compressed_size);
+  if (it->size > std::numeric_limits<uInt>::max()) {
+    throw Malformed(name + ": member too large");
+  }
+
+  std::vector<uint8_t> contents;
+  if (it->method == kMethodStored) {
+    if (it->compressed_size != it->size) {
+      throw Malformed(name + ": stored size mismatch");
+    }
+    contents.assign(data.begin(), data.end());
+  } else if (it->method == kMethodDeflated) {
+    contents = Inflate(data, it->size);
+  } else {
+    throw Malformed(name + ": unsupported compression method " + std::to_string(it->method));
+  }
+  uLong crc = crc32(0L, contents.data(), static_cast<uInt>(contents.size()));
+  if (crc != it->crc) {
+    throw Malformed(name + ": CRC mismatch");
+  }
+  return contents;
+}
+
+}  // namespace fujitsu::airstage